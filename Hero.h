@@ -9,6 +9,23 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include "engine/FrameContext.h"
+#include "engine/StaticBatch.h"
+#include "engine/StreamBuffer.h"
+#include "engine/UniformBuffer.h"
+
+/// Uniform locations used to draw a hero baked into a single mesh.
+struct HeroUniformLocations {
+    /// Location of the per-vertex color flag.
+    GLint useVertexColor;
+
+    /// Location of the part palette flag.
+    GLint usePartPalette;
+
+    /// Location of the first entry of the part transform palette.
+    GLint partPalette;
+};
+
 
 class Hero {
 
@@ -16,29 +33,54 @@ public:
 
     virtual ~Hero() = default;
 
+    /**
+     * Hero preparation
+     * Computes everything that does not depend on the view, once per frame: the part palette,
+     * and streams the object block with the model and normal matrices.
+     * @param objectBlock : Model and normal matrices to go from object space to world space, cached by the scene graph
+     * @param frame : Time of the frame being drawn, animating the parts
+     */
+    virtual void prepareHero( const ObjectBlock& objectBlock, const FrameContext& frame ) = 0;
+
     /**
      * Hero Drawing function
-     * Using the three components of the MVP matrix, model, view and projection, executes all
-     * the drawing functions to create our hero.
-     * @param modelMtx : Model matrix to go from object space to world space
-     * @param viewMtx : View matrix to go from world space to view/eye/camera space.
-     * @param projMtx : Projection matrix to go from view space to clip space.
+     * Draws every part of our hero with the data of the last preparation,
+     * the view and projection come from the frame block.
+     * @param drawDetails : false to leave out the small facial details, too small to be seen.
+     */
+    virtual void drawHero(bool drawDetails) const = 0;
+
+    /**
+     * Hero bounds
+     * @return sphere enclosing the hero in every pose, in object space.
      */
-    virtual void drawHero( glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx ) const = 0;
+    virtual BoundingSphere getBounds() const = 0;
+
+    /**
+     * Details bounds
+     * @return sphere enclosing the facial details (pupils, nose, cheeks...), in object space.
+     */
+    virtual BoundingSphere getDetailBounds() const = 0;
 
 
     /**
      * Uniform loction setter
      * Sets all the uniform location for the shader passed as parameters.
      * @param shaderProgramHandle : Handle for the shader program (vertex + fragment)
-     * @param mvpMtxUniformLocation : Location of the MVP matrix uniform
-     * @param normalMtxUniformLocation : Location of the normal matrix uniform
-     * @param materialColorUniformLocation : Location of the material color uniform
+     * @param uniformLocations : Locations of the uniforms used by the baked mesh.
+     * @param streamBuffer : Ring buffer receiving the model and normal matrices.
      */
     virtual void setProgramUniformLocations( GLuint shaderProgramHandle,
-                                     GLint mvpMtxUniformLocation,
-                                     GLint normalMtxUniformLocation,
-                                     GLint materialColorUniformLocation ) = 0;
+                                     const HeroUniformLocations& uniformLocations,
+                                     StreamBuffer* streamBuffer ) = 0;
+
+    /**
+     * Parts baking
+     * Bakes every part of the hero into a single vertex buffer, with its color and the
+     * index of the palette transform that animates it, so drawHero is a single draw call.
+     * @param attributeLocations : Locations of the vertex attributes of the shader.
+     */
+    virtual void bakeParts( const MeshAttributeLocations& attributeLocations ) = 0;
 
     /**
      * Blinking flag setter
@@ -88,18 +130,8 @@ private:
     /// Handle for the shader program, used when drawing Daglas.
     GLuint _shaderProgramHandle;
 
-    /// Structure storing the uniform locations for the shader program.
-    struct ShaderProgramUniformLocations {
-        /// Location of the precomputed Model-View-Projection matrix.
-        GLint mvpMtx;
-
-        /// Location of the precomputed Normal matrix.
-        GLint normalMtx;
-
-        /// Location of the material color.
-        GLint materialColor;
-
-    } _shaderProgramUniformLocations;
+    /// Ring buffer receiving the model and normal matrices.
+    StreamBuffer* _streamBuffer;
 
 };
 
@@ -3,8 +3,12 @@
 #include <CSCI441/ArcballCam.hpp>
 #include <CSCI441/objects.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
+#include <limits>
 
 #include "Hero.h"
 #include "heroes/Daglas.h"
@@ -63,8 +67,7 @@ MPEngine::MPEngine()
       _darrow(nullptr),
       _petre(nullptr),
       _pModel( nullptr ), _objectIndex( 0 ),
-      _groundVAO(0),
-      _numGroundPoints(0),
+      sunPosition( {0.0f, 150.0f, 50.0f} ),
       _lightingShaderProgram(nullptr),
       _lightingShaderUniformLocations( {-1, -1} ),
       _lightingShaderAttributeLocations( {-1} )
@@ -114,12 +117,11 @@ void MPEngine::handleKeyEvent(const GLint KEY, const GLint ACTION) {
             case GLFW_KEY_R:
                 //mReloadShaders();
                 _setLightingParameters();
-                // Give the hero the normal matrix location.
+                // Give the hero the uniform locations and object buffer.
                 _hero->hero -> setProgramUniformLocations(
                     _lightingShaderProgram->getShaderProgramHandle(),
-                    _lightingShaderUniformLocations.mvpMatrix,
-                    _lightingShaderUniformLocations.normalMatrix,
-                    _lightingShaderUniformLocations.materialColor
+                    _heroUniformLocations(),
+                    &_streamBuffer
                 );
                 break;
             // Press P : change the hero controlled by the user
@@ -133,6 +135,68 @@ void MPEngine::handleKeyEvent(const GLint KEY, const GLint ACTION) {
             // Press V : enable picture-in-picture first person camera
             case GLFW_KEY_V:
                 _enableFPC = !_enableFPC;
+                _pipDirty = true;
+                break;
+            // Press B : change how often the picture-in-picture is rendered
+            case GLFW_KEY_B:
+                _pipUpdateRate = static_cast<PipUpdateRate>((_pipUpdateRate + 1) % PIP_UPDATE_RATE_COUNT);
+                _pipDirty = true;
+                break;
+            // Press O : toggle occlusion culling behind the hill and trees
+            case GLFW_KEY_O:
+                _enableOcclusion = !_enableOcclusion;
+                break;
+            // Press I : toggle the impostor cards of the far trees
+            case GLFW_KEY_I:
+                _enableImpostors = !_enableImpostors;
+                break;
+            // Press [ or ] : bring the impostor cards closer or push them further
+            case GLFW_KEY_LEFT_BRACKET:
+                _impostorDistance = std::max(IMPOSTOR_DISTANCE_STEP, _impostorDistance - IMPOSTOR_DISTANCE_STEP);
+                fprintf( stdout, "[INFO]: Trees drawn as impostors beyond %.0f\n", _impostorDistance );
+                break;
+            case GLFW_KEY_RIGHT_BRACKET:
+                _impostorDistance += IMPOSTOR_DISTANCE_STEP;
+                fprintf( stdout, "[INFO]: Trees drawn as impostors beyond %.0f\n", _impostorDistance );
+                break;
+            // Press - or = : lower or raise the smallest size drawn on screen
+            case GLFW_KEY_MINUS:
+                _contributionThreshold = std::max(0.0f, _contributionThreshold - 0.5f);
+                _renderQueue.setContributionThreshold(_contributionThreshold);
+                fprintf( stdout, "[INFO]: Objects smaller than %.1f pixels skipped\n", _contributionThreshold );
+                break;
+            case GLFW_KEY_EQUAL:
+                _contributionThreshold += 0.5f;
+                _renderQueue.setContributionThreshold(_contributionThreshold);
+                fprintf( stdout, "[INFO]: Objects smaller than %.1f pixels skipped\n", _contributionThreshold );
+                break;
+            // Press H : toggle drawing the grass and trees as merged chunks
+            case GLFW_KEY_H:
+                _enableChunks = !_enableChunks;
+                fprintf( stdout, "[INFO]: Environment drawn as %s\n", _enableChunks ? "merged chunks" : "instances" );
+                break;
+            // Press J : toggle swaying the grass on the CPU instead of the shader
+            case GLFW_KEY_J:
+                _swayGrassOnCpu = !_swayGrassOnCpu;
+                fprintf( stdout, "[INFO]: Grass swayed by the %s\n", _swayGrassOnCpu ? "CPU" : "shader" );
+                break;
+            // Press M : toggle simulating the next frame while this one is drawn
+            case GLFW_KEY_M:
+                _pipelineFrames = !_pipelineFrames;
+                fprintf( stdout, "[INFO]: Frames %s\n", _pipelineFrames ? "pipelined, simulated while the previous one is drawn" : "simulated then drawn in turns" );
+                break;
+            // Press N : time the CPU grass sway kernels, results on stdout
+            case GLFW_KEY_N:
+                _grassField.benchmark(100);
+                break;
+            // Press K : time the job system with 1 to one thread per core, results on stdout
+            case GLFW_KEY_K:
+                benchmarkJobSystem();
+                break;
+            // Press G : toggle the culling of the grass and trees on the GPU, when supported
+            case GLFW_KEY_G:
+                _enableGpuCulling = !_enableGpuCulling && _cullProgramHandle != 0;
+                fprintf( stdout, "[INFO]: GPU culling %s\n", _enableGpuCulling ? "enabled" : "disabled" );
                 break;
                 // Suppress CLion warning
             default: break;
@@ -201,8 +265,8 @@ void MPEngine::mSetupOpenGL() {
     glEnable( GL_DEPTH_TEST );                          // Enabling depth testing
     glDepthFunc( GL_LESS );                             // Using less than depth test
 
-    glEnable(GL_BLEND);                                 // Enable blending
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  // Using one minus blending equation
+    glDisable(GL_BLEND);                                // Everything is opaque, blending would only cost fill rate
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);  // Using one minus blending equation, if ever enabled
 
     glClearColor( 0.4f, 0.4f, 0.4f, 1.0f );             // Clearing the frame buffer to gray
 }
@@ -218,56 +282,69 @@ void MPEngine::mSetupShaders() {
 
     // --------------------------------------------- UNIFORMS ---------------------------------------------|
 
-    // ============ MATRICES ============|
-    // MVP matrix
-    _lightingShaderUniformLocations.mvpMatrix = _lightingShaderProgram->getUniformLocation("mvpMatrix");
-    // Model matrix
-    _lightingShaderUniformLocations.modelMatrix = _lightingShaderProgram->getUniformLocation("modelMatrix");
-    // Normal Matrix
-    _lightingShaderUniformLocations.normalMatrix = _lightingShaderProgram->getUniformLocation("normalMatrix");
+    // ============ UNIFORM BLOCKS ============|
+    // Camera and time, once per view
+    _lightingShaderProgram->setUniformBlockBinding("FrameData", FRAME_BLOCK_BINDING);
+    // Lights, only when they change
+    _lightingShaderProgram->setUniformBlockBinding("LightData", LIGHT_BLOCK_BINDING);
+    // Model and normal matrices, once per object
+    _lightingShaderProgram->setUniformBlockBinding("ObjectData", OBJECT_BLOCK_BINDING);
 
     // ============ MATERIAL ============|
     // Material Color
     _lightingShaderUniformLocations.materialColor = _lightingShaderProgram->getUniformLocation("materialColor");
 
-    // ============ DIRECTIONAL LIGHT ============|
-
-    // Directional light direction
-    _lightingShaderUniformLocations.dir_lightDirection = _lightingShaderProgram->getUniformLocation("directional_lightDirection");
-    // Directional light color
-    _lightingShaderUniformLocations.dir_lightColor = _lightingShaderProgram->getUniformLocation("directional_lightColor");
-
-    // ============ POINT LIGHT ============|
-
-    // Point light position
-    _lightingShaderUniformLocations.point_lightPosition = _lightingShaderProgram->getUniformLocation("point_lightPosition");
-    // Point light Color
-    _lightingShaderUniformLocations.point_lightColor = _lightingShaderProgram->getUniformLocation("point_lightColor");
-
-    // ============ SPOTLIGHT ============|
-
-    // Spotlight position
-    _lightingShaderUniformLocations.spot_lightPosition = _lightingShaderProgram->getUniformLocation("spot_lightPosition");
-    // Spotlight direction
-    _lightingShaderUniformLocations.spot_lightDirection = _lightingShaderProgram->getUniformLocation("spot_lightDirection");
-    // Spotlight color
-    _lightingShaderUniformLocations.spot_lightColor = _lightingShaderProgram->getUniformLocation("spot_lightColor");
-
-
-    // Camera Position
-    _lightingShaderUniformLocations.cameraPosition = _lightingShaderProgram->getUniformLocation("cameraPos");
-
+    // ============ INSTANCING ============|
+    // Instanced drawing flag
+    _lightingShaderUniformLocations.useInstancing = _lightingShaderProgram->getUniformLocation("useInstancing");
+    // Grass sway flag
+    _lightingShaderUniformLocations.swayGrass = _lightingShaderProgram->getUniformLocation("swayGrass");
+    // Per-vertex color flag
+    _lightingShaderUniformLocations.useVertexColor = _lightingShaderProgram->getUniformLocation("useVertexColor");
+    // Part palette flag
+    _lightingShaderUniformLocations.usePartPalette = _lightingShaderProgram->getUniformLocation("usePartPalette");
+    // Part transform palette
+    _lightingShaderUniformLocations.partPalette = _lightingShaderProgram->getUniformLocation("partPalette");
 
     // --------------------------------------------- ATTRIBUTES ---------------------------------------------|
     // Vertex Position
     _lightingShaderAttributeLocations.vPos = _lightingShaderProgram->getAttributeLocation("vPos");
     // Vertex Normal
     _lightingShaderAttributeLocations.vertexNormal = _lightingShaderProgram->getAttributeLocation("vertexNormal");
+    // Instance Model Matrix
+    _lightingShaderAttributeLocations.instanceModelMatrix = _lightingShaderProgram->getAttributeLocation("instanceModelMatrix");
+    // Instance Normal Matrix
+    _lightingShaderAttributeLocations.instanceNormalMatrix = _lightingShaderProgram->getAttributeLocation("instanceNormalMatrix");
+    // Instance Color
+    _lightingShaderAttributeLocations.instanceColor = _lightingShaderProgram->getAttributeLocation("instanceColor");
+    // Vertex Color
+    _lightingShaderAttributeLocations.vertexColor = _lightingShaderProgram->getAttributeLocation("vertexColor");
+    // Vertex Part Index
+    _lightingShaderAttributeLocations.partIndex = _lightingShaderProgram->getAttributeLocation("partIndex");
 
     // --------------------------- SKYBOX SHADER (new, separate program) ---------------------------
     _skyboxProg = new CSCI441::ShaderProgram("shaders/skybox.v.glsl", "shaders/skybox.f.glsl");
     _skyU.uVP   = _skyboxProg->getUniformLocation("uVP");
     _skyU.uCube = _skyboxProg->getUniformLocation("uCube");
+
+    // --------------------------- PICTURE-IN-PICTURE SHADER ---------------------------
+    _pipProg = new CSCI441::ShaderProgram("shaders/pip.v.glsl", "shaders/pip.f.glsl");
+    _pipImageLocation = _pipProg->getUniformLocation("uImage");
+
+    // --------------------------- OCCLUDER DEPTH SHADER ---------------------------
+    _occluderProg = new CSCI441::ShaderProgram("shaders/occluder.v.glsl", "shaders/occluder.f.glsl");
+    _occluderViewProjectionLocation = _occluderProg->getUniformLocation("viewProjectionMatrix");
+
+    // --------------------------- TREE IMPOSTOR SHADERS ---------------------------
+    _impostorBakeProg = new CSCI441::ShaderProgram("shaders/impostorBake.v.glsl", "shaders/impostorBake.f.glsl");
+    _impostorBakeViewProjectionLocation = _impostorBakeProg->getUniformLocation("viewProjectionMatrix");
+
+    _impostorProg = new CSCI441::ShaderProgram("shaders/impostor.v.glsl", "shaders/impostor.f.glsl");
+    _impostorProg->setUniformBlockBinding("FrameData", FRAME_BLOCK_BINDING);
+    _impostorProg->setUniformBlockBinding("LightData", LIGHT_BLOCK_BINDING);
+    _impostorAlbedoLocation = _impostorProg->getUniformLocation("albedoAtlas");
+    _impostorNormalLocation = _impostorProg->getUniformLocation("normalAtlas");
+    _impostorFramesPerSideLocation = _impostorProg->getUniformLocation("framesPerSide");
 }
 
 /**
@@ -278,75 +355,121 @@ void MPEngine::mSetupBuffers() {
     // Passing the vertex positions and vertex normal to our object library.
     CSCI441::setVertexAttributeLocations( _lightingShaderAttributeLocations.vPos, _lightingShaderAttributeLocations.vertexNormal);
 
-    // Giving the hero the normal matrix location.
-    _daglas = new Daglas(_lightingShaderProgram->getShaderProgramHandle(),
-                         _lightingShaderUniformLocations.mvpMatrix,
-                         _lightingShaderUniformLocations.normalMatrix,
-                         _lightingShaderUniformLocations.materialColor);
-
-    // Giving the hero the normal matrix location.
-    _paco = new Paco(_lightingShaderProgram->getShaderProgramHandle(),
-                         _lightingShaderUniformLocations.mvpMatrix,
-                         _lightingShaderUniformLocations.normalMatrix,
-                         _lightingShaderUniformLocations.materialColor);
-
-    _darrow = new Darrow(_lightingShaderProgram->getShaderProgramHandle(),
-                         _lightingShaderUniformLocations.mvpMatrix,
-                         _lightingShaderUniformLocations.normalMatrix,
-                         _lightingShaderUniformLocations.materialColor);   
-
-    _petre = new Petre(_lightingShaderProgram->getShaderProgramHandle(),
-                         _lightingShaderUniformLocations.mvpMatrix,
-                         _lightingShaderUniformLocations.normalMatrix,
-                         _lightingShaderUniformLocations.materialColor);
-
-    _createGroundBuffers();
+    // Lights buffer, attached once to its binding point.
+    _lightUniformBuffer.create(LIGHT_BLOCK_BINDING, sizeof(LightBlock));
+
+    // Giving the heroes the uniform locations and the stream buffer.
+    const HeroUniformLocations heroUniformLocations = _heroUniformLocations();
+    const GLuint lightingProgramHandle = _lightingShaderProgram->getShaderProgramHandle();
+    _daglas = new Daglas(lightingProgramHandle, heroUniformLocations, &_streamBuffer);
+    _paco = new Paco(lightingProgramHandle, heroUniformLocations, &_streamBuffer);
+    _darrow = new Darrow(lightingProgramHandle, heroUniformLocations, &_streamBuffer);
+    _petre = new Petre(lightingProgramHandle, heroUniformLocations, &_streamBuffer);
+
+    // Baking every hero into a single mesh, animated through the part palette.
+    for (Hero* hero : std::initializer_list<Hero*>{_daglas, _paco, _darrow, _petre}) {
+        hero->bakeParts(_meshAttributeLocations());
+    }
+
+    _createTerrain();
+    _createStaticBatch();
     _generateEnvironment();
+    _createGrassBuffers();
+    _createTreeBuffers();
+    _createTreeImpostors();
+    _createEnvironmentChunks();
+    _createOccluderBatch();
+
+    // Ring buffer sized for two views of every instance, plus the frame and object blocks.
+    const std::size_t instanceCount = _grassInstances.size() + _trunkInstances.size() + _leavesInstances.size()
+                                    + _impostorInstances.size();
+    _streamBuffer.create(static_cast<GLsizeiptr>(2 * instanceCount * sizeof(InstanceData) + 64 * 1024));
+
+    _setupRenderQueue();
+
+    // The picture-in-picture quad has no vertex data, but a VAO must be bound to draw.
+    glGenVertexArrays(1, &_pipVAO);
     
     // ---------- SKYBOX GEOMETRY (new) ----------
     _setupSkybox();
 }
 
 /**
- * Ground Buffers Creation
- * This function sets the ground position and normals, generates the VAO, VBO and IBO,
- * binds them, and enables the vertex position and normal attribute arrays.
+ * Static Batch Creation
+ * The ground, the hill, the sun and its beams never move, so they are merged once
+ * in world space with their colors baked in, and drawn later with a single call.
+ * The sun gets its own batch, far up in the sky it is out of most views.
  */
-void MPEngine::_createGroundBuffers() {
+void MPEngine::_createStaticBatch() {
 
-    struct Vertex {
-        glm::vec3 position;
-        glm::vec3 normal;
-    };
+    // Ground and hill
+    _addGroundToBatch(_staticBatch);
 
-    // Position and normals aligned with the positive Y axis (0, 1, 0)
-    constexpr Vertex groundQuad[4] = {
-            { {-1.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f} },
-            { { 1.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f} },
-            { {-1.0f, 0.0f,  1.0f}, {0.0f, 1.0f, 0.0f} },
-            { { 1.0f, 0.0f,  1.0f}, {0.0f, 1.0f, 0.0f} }
-    };
+    // Sun, far away most of the time, so coarser versions are baked too.
+    // The hill always covers much of the screen and keeps a single tessellation.
+    for (GLuint level = 0; level < LOD_LEVEL_COUNT; level++) {
+        _addSunToBatch(_sunBatches[level], LOD_TESSELLATION[level]);
+        _sunBatches[level].upload(_meshAttributeLocations());
+    }
 
-    constexpr GLushort indices[4] = {0,1,2,3};
+    _staticBatch.upload(_meshAttributeLocations());
+}
 
-    _numGroundPoints = 4;
+/**
+ * Terrain Generation
+ * The ground covers the world from -WORLD_SIZE to WORLD_SIZE. The hill is the top of a sphere of radius
+ * WORLD_SIZE / 2, centered WORLD_SIZE / 4 below the ground, sampled once into the heightfield so every
+ * later query is a lookup, however many hills are added here.
+ */
+void MPEngine::_createTerrain() {
+    const glm::vec2 hillCenter(WORLD_SIZE * 0.5f, WORLD_SIZE * 0.5f);
+    const GLfloat hillRadius = WORLD_SIZE * 0.5f;
+    const GLfloat hillDepth = WORLD_SIZE * 0.25f;
+
+    _terrain.generate(glm::vec2(-WORLD_SIZE), glm::vec2(2.0f * WORLD_SIZE), TERRAIN_CELLS,
+        [&](const GLfloat x, const GLfloat z) {
+            const glm::vec2 offset = glm::vec2(x, z) - hillCenter;
+            const GLfloat squaredRadius = hillRadius * hillRadius - glm::dot(offset, offset);
+            return squaredRadius > hillDepth * hillDepth ? std::sqrt(squaredRadius) - hillDepth : 0.0f;
+        });
+}
 
-    glGenVertexArrays(1, &_groundVAO);
-    glBindVertexArray(_groundVAO);
+/**
+ * Ground Baking
+ * Helper function to add the terrain, ground and hill, to a static batch.
+ * @param batch : Batch receiving the ground.
+ */
+void MPEngine::_addGroundToBatch(StaticBatch& batch) {
 
-    GLuint vbods[2]; // 0 : VBO, 1 : IBO
-    glGenBuffers(2, vbods);
-    glBindBuffer(GL_ARRAY_BUFFER, vbods[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(groundQuad), groundQuad, GL_STATIC_DRAW);
+    // Green ground made of grass.
+    constexpr glm::vec3 groundColor(0.161f, 0.522f, 0.024f);
 
-    glEnableVertexAttribArray(_lightingShaderAttributeLocations.vPos);
-    glVertexAttribPointer(_lightingShaderAttributeLocations.vPos, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)nullptr);
+    // Already in world space, normals included.
+    batch.add(_terrain.mesh(), glm::mat4(1.0f), groundColor);
+}
 
-    glEnableVertexAttribArray(_lightingShaderAttributeLocations.vertexNormal);
-    glVertexAttribPointer(_lightingShaderAttributeLocations.vertexNormal, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)(3 * sizeof(float)));
+/**
+ * Occluder Batch Creation
+ * The ground, the hill and the trees hide most of the world from low cameras. They are merged
+ * into a batch only drawn in depth, the trees with their coarsest tessellation, whose polygons
+ * stay inside the real shapes so they never hide more than the trees themselves.
+ */
+void MPEngine::_createOccluderBatch() {
+    _addGroundToBatch(_occluderBatch);
+
+    const GLint tessellation = LOD_TESSELLATION[LOD_LEVEL_COUNT - 1];
+    const MeshData trunkMesh = MeshData::cylinder(1.0f, 1.0f, 1.0f, tessellation, tessellation);
+    const MeshData leavesMesh = MeshData::cone(1.5f, 1.0f, tessellation, tessellation);
+    for (const InstanceData& trunk : _trunkInstances) {
+        _occluderBatch.add(trunkMesh, trunk.modelMatrix, trunk.color);
+    }
+    for (const InstanceData& leaves : _leavesInstances) {
+        _occluderBatch.add(leavesMesh, leaves.modelMatrix, leaves.color);
+    }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbods[1]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    // Only the position is read by the occluder shader.
+    _occluderBatch.upload({0, 1, -1, -1, -1, 2, 3});
+    _occlusionBuffer.create(OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
 }
 
 /**
@@ -377,8 +500,8 @@ void MPEngine::_generateEnvironment() {
 
             // ----------------------- GRASS GENERATION -----------------------
             if( i % 2 && j % 2 && getRand() < 0.05f ) {
-                // Move to random position
-                glm::mat4 positionMatrix = glm::translate( glm::mat4(1.0), glm::vec3(i, -0.35f, j) );
+                // Move to random position, a little into the ground
+                glm::mat4 positionMatrix = glm::translate( glm::mat4(1.0), glm::vec3(i, _terrain.heightAt(i, j) - 0.35f, j) );
                 // Fixed height
                 GLdouble height = 10.0;
                 // Scaling to grass size
@@ -389,20 +512,26 @@ void MPEngine::_generateEnvironment() {
                 glm::vec3 color( 0.275, 0.839, 0.122 );
 
                 // Storing grass properties
-                GrassData newGrass = {modelMatrix, modelMatrix, color};
+                GrassData newGrass = {modelMatrix, color};
                 _grass.emplace_back( newGrass );
             }
 
             // ----------------------- TREE GENERATION -----------------------
             if( i % 2 && j % 2 && getRand() < 0.01f ) {
-                // Moving to random position
-                glm::mat4 positionMatrix = glm::translate( glm::mat4(1.0), glm::vec3(j, 0.0f, i) );
+                // Random trunk thickness
+                float trunkThickness = 3.0f + getRand() * 1.0f;
+
+                // Moving to random position, sunk by the slope so the whole trunk base touches the ground
+                const glm::vec3 groundNormal = _terrain.normalAt(j, i);
+                const GLfloat trunkRadius = 0.3f * trunkThickness;
+                const GLfloat sink = trunkRadius * std::sqrt(1.0f - groundNormal.y * groundNormal.y) / groundNormal.y;
+                glm::mat4 positionMatrix = glm::translate( glm::mat4(1.0), glm::vec3(j, _terrain.heightAt(j, i) - sink, i) );
                 // Computing a random height
                 GLdouble height = powf(getRand(), 2.5) * 10 + 10;
                 // Scaling the tree size
                 glm::mat4 scaleMatrix = glm::scale( glm::mat4(1.0), glm::vec3(1, height, 1) );
-                // Computing the full model matrix
-                glm::mat4 modelMatrix = scaleMatrix * positionMatrix;
+                // Translation after the scale, so the ground height is not multiplied by the tree height
+                glm::mat4 modelMatrix = positionMatrix * scaleMatrix;
 
                 // Computing random colors
                 // Trunk dark brown shades (around RGB(0.4, 0.25, 0.1))
@@ -417,9 +546,6 @@ void MPEngine::_generateEnvironment() {
                 float leafB = 0.0f + getRand() * 0.1f;
                 glm::vec3 leavesColor(leafR, leafG, leafB);
 
-                // Random trunk thickness
-                float trunkThickness = 3.0f + getRand() * 1.0f;
-
                 // Storing tree properties
                 TreeData newTree = {modelMatrix, trunkColor, leavesColor, trunkThickness };
                 _trees.emplace_back( newTree );
@@ -428,6 +554,408 @@ void MPEngine::_generateEnvironment() {
     }
 }
 
+/**
+ * Grass Buffers Creation
+ * Builds the grass clump mesh (three cones, the middle one taller) once in the render queue
+ * and computes the static data of every clump generated by the environment.
+ */
+void MPEngine::_createGrassBuffers() {
+    // Three flat cones close together and the middle one is taller, at every level of detail.
+    MeshData clumpMeshes[LOD_LEVEL_COUNT];
+    for (GLuint level = 0; level < LOD_LEVEL_COUNT; level++) {
+        clumpMeshes[level] = _grassClumpMesh(LOD_TESSELLATION[level]);
+    }
+
+    // Per-clump position, scale and color, and bounds a little larger for the sway.
+    BoundingSphere clumpBounds = clumpMeshes[0].bounds();
+    clumpBounds.radius *= 1.1f;
+    _grassInstances.reserve(_grass.size());
+    _grassBounds.reserve(_grass.size());
+    for (const GrassData& grass : _grass) {
+        const glm::mat3 normalMatrix = AffineTransform(grass.modelMatrix).normalMatrix();
+        _grassInstances.push_back({grass.modelMatrix, normalMatrix, grass.color});
+        // Unrotated, the diagonal of the model matrix is the scale.
+        _grassField.add(glm::vec3(grass.modelMatrix[3]),
+                        glm::vec3(grass.modelMatrix[0][0], grass.modelMatrix[1][1], grass.modelMatrix[2][2]), grass.color);
+        _grassBounds.push_back(clumpBounds.transformed(grass.modelMatrix));
+    }
+    _grassGrid.build(_grassBounds, ENVIRONMENT_CELL_SIZE);
+    _grassLods.assign(_grass.size(), 0);
+    _swayedGrassInstances.resize(_grassInstances.size());
+    fprintf( stdout, "[INFO]: CPU grass sway uses the %s kernel\n", GrassField::kernelName(_grassField.getKernel()) );
+
+    for (GLuint level = 0; level < LOD_LEVEL_COUNT; level++) {
+        _grassMeshes[level] = _renderQueue.addMesh(clumpMeshes[level]);
+    }
+}
+
+/**
+ * Grass Clump Mesh
+ * Three flat cones close together, the middle one taller.
+ * @param tessellation : Slices and stacks of the level, the blades take half of them.
+ * @return mesh of a clump, before its model matrix.
+ */
+MeshData MPEngine::_grassClumpMesh(const GLint tessellation) {
+    MeshData clump;
+    const GLint bladeTessellation = std::max(3, tessellation / 2);
+    for (int i = 0 ; i < 3 ; i++) {
+        float grassHeight = 0.15f;
+        if (i == 1)
+            grassHeight = 0.20f;
+        const glm::mat4 bladeMtx = glm::translate(glm::mat4(1.0f), glm::vec3(0.15f * i, 0.0f, 0.0f));
+        clump.append(MeshData::cone(0.15f, grassHeight, bladeTessellation, bladeTessellation), bladeMtx);
+    }
+    return clump;
+}
+
+/**
+ * Tree Buffers Creation
+ * Trees never move, so the trunk and the three leaf tiers of every tree are computed once,
+ * and the trunk and leaf meshes are added to the render queue.
+ */
+void MPEngine::_createTreeBuffers() {
+    std::vector<InstanceData>& trunks = _trunkInstances;
+    std::vector<InstanceData>& leaves = _leavesInstances;
+    trunks.reserve(_trees.size());
+    leaves.reserve(_trees.size() * 3);
+    _trunkBounds.reserve(_trees.size());
+    _leavesBounds.reserve(_trees.size() * 3);
+
+    // Every level has the same extent, the finest gives the bounds.
+    const BoundingSphere trunkMeshBounds = MeshData::cylinder(1.0f, 1.0f, 1.0f, LOD_TESSELLATION[0], LOD_TESSELLATION[0]).bounds();
+    const BoundingSphere leavesMeshBounds = MeshData::cone(1.5f, 1.0f, LOD_TESSELLATION[0], LOD_TESSELLATION[0]).bounds();
+
+    std::vector<AffineTransform> trunkTransforms, leavesTransforms;
+    trunkTransforms.reserve(_trees.size());
+    leavesTransforms.reserve(_trees.size() * 3);
+    for (const TreeData& tree : _trees) {
+        const AffineTransform treeTransform(tree.modelMatrix);
+
+        // Tree trunk
+        trunkTransforms.push_back(_trunkTransform(treeTransform, tree.trunkThickness));
+        trunks.push_back({glm::mat4(1.0f), glm::mat3(1.0f), tree.trunkColor});
+
+        // Tree leaves (three stacked cones)
+        for(int i = 0; i < 3; i++) {
+            leavesTransforms.push_back(_leavesTransform(treeTransform, i));
+            leaves.push_back({glm::mat4(1.0f), glm::mat3(1.0f), tree.leavesColor});
+        }
+    }
+
+    // Model and normal matrices of every trunk and tier at once, the colors are kept.
+    AffineTransform::evaluate(trunkTransforms.data(), trunkTransforms.size(), trunks.data());
+    AffineTransform::evaluate(leavesTransforms.data(), leavesTransforms.size(), leaves.data());
+    for (const InstanceData& trunk : trunks) {
+        _trunkBounds.push_back(trunkMeshBounds.transformed(trunk.modelMatrix));
+    }
+    for (const InstanceData& tier : leaves) {
+        _leavesBounds.push_back(leavesMeshBounds.transformed(tier.modelMatrix));
+    }
+
+    // Indexing each tree as a whole, its leaves follow its trunk.
+    _treeBounds = _trunkBounds;
+    for (std::size_t i = 0; i < _treeBounds.size(); i++) {
+        for (std::size_t tier = 0; tier < 3; tier++) {
+            _treeBounds[i] = _treeBounds[i].merged(_leavesBounds[i * 3 + tier]);
+        }
+    }
+    _treeGrid.build(_treeBounds, ENVIRONMENT_CELL_SIZE);
+    _treeLods.assign(_trees.size(), 0);
+    fprintf( stdout, "[INFO]: Environment indexed in %d grass cells and %d tree cells\n",
+             _grassGrid.getOccupiedCellCount(), _treeGrid.getOccupiedCellCount() );
+
+    for (GLuint level = 0; level < LOD_LEVEL_COUNT; level++) {
+        const GLint tessellation = LOD_TESSELLATION[level];
+        _trunkMeshes[level] = _renderQueue.addMesh(MeshData::cylinder(1.0f, 1.0f, 1.0f, tessellation, tessellation));
+        _leavesMeshes[level] = _renderQueue.addMesh(MeshData::cone(1.5f, 1.0f, tessellation, tessellation));
+    }
+}
+
+/**
+ * Trunk Placement
+ * The random thickness scales a unit cylinder.
+ * @param treeTransform : Transform of the tree.
+ * @param trunkThickness : Thickness of the trunk.
+ * @return transform of the trunk.
+ */
+AffineTransform MPEngine::_trunkTransform(const AffineTransform& treeTransform, const float trunkThickness) {
+    return treeTransform.scale(glm::vec3(0.3f * trunkThickness, 3.0f, 0.3f * trunkThickness));
+}
+
+/**
+ * Leaf Tier Placement
+ * Three stacked cones, smaller as they go up.
+ * @param treeTransform : Transform of the tree.
+ * @param tier : Tier of the cone, from the bottom.
+ * @return transform of the leaf tier.
+ */
+AffineTransform MPEngine::_leavesTransform(const AffineTransform& treeTransform, const int tier) {
+    // Moving up for trunk height and cone stack.
+    const AffineTransform leavesTransform = treeTransform.translate(glm::vec3(0.0f, 3.0f + tier * 1.1f, 0.0f));
+    // Making smaller cones as we go up.
+    const float scale = 2.5f - tier * 0.5f;
+    return leavesTransform.scale(glm::vec3(scale, 2.0f, scale));
+}
+
+/**
+ * Tree Impostors Creation
+ * Trees only differ by their height, trunk thickness and colors. The heights and thicknesses are split
+ * into a few buckets, and the middle tree of every bucket is baked into the impostor atlas with its trunk
+ * and leaves as two material weights, so each card gets the colors of its own tree when drawn.
+ */
+void MPEngine::_createTreeImpostors() {
+    if (_trees.empty()) return;
+
+    // Range of the generated trees, the height is the vertical scale of their model matrix.
+    GLfloat minHeight = _trees.front().modelMatrix[1][1], maxHeight = minHeight;
+    GLfloat minThickness = _trees.front().trunkThickness, maxThickness = minThickness;
+    for (const TreeData& tree : _trees) {
+        minHeight = std::min(minHeight, tree.modelMatrix[1][1]);
+        maxHeight = std::max(maxHeight, tree.modelMatrix[1][1]);
+        minThickness = std::min(minThickness, tree.trunkThickness);
+        maxThickness = std::max(maxThickness, tree.trunkThickness);
+    }
+    const auto bucket = [](const GLfloat value, const GLfloat minValue, const GLfloat maxValue, const GLuint count) {
+        const GLfloat t = maxValue > minValue ? (value - minValue) / (maxValue - minValue) : 0.0f;
+        return std::min(static_cast<GLuint>(t * count), count - 1);
+    };
+
+    // Baking every variant around the origin, the trunk weighs on red and the leaves on green.
+    const GLint tessellation = LOD_TESSELLATION[0];
+    const MeshData trunkMesh = MeshData::cylinder(1.0f, 1.0f, 1.0f, tessellation, tessellation);
+    const MeshData leavesMesh = MeshData::cone(1.5f, 1.0f, tessellation, tessellation);
+    const GLuint variantCount = IMPOSTOR_HEIGHT_BUCKETS * IMPOSTOR_THICKNESS_BUCKETS;
+    std::vector<BoundingSphere> variantBounds(variantCount);
+    _impostorAtlas.create(IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAMES_PER_SIDE, variantCount);
+
+    _impostorBakeProg->useProgram();
+    for (GLuint heightBucket = 0; heightBucket < IMPOSTOR_HEIGHT_BUCKETS; heightBucket++) {
+        for (GLuint thicknessBucket = 0; thicknessBucket < IMPOSTOR_THICKNESS_BUCKETS; thicknessBucket++) {
+            const GLfloat height = minHeight + (maxHeight - minHeight) * (heightBucket + 0.5f) / IMPOSTOR_HEIGHT_BUCKETS;
+            const GLfloat thickness = minThickness + (maxThickness - minThickness) * (thicknessBucket + 0.5f) / IMPOSTOR_THICKNESS_BUCKETS;
+            const AffineTransform treeTransform = AffineTransform().scale(glm::vec3(1.0f, height, 1.0f));
+
+            StaticBatch variant;
+            variant.add(trunkMesh, _trunkTransform(treeTransform, thickness).toMat4(), glm::vec3(1.0f, 0.0f, 0.0f));
+            for (int tier = 0; tier < 3; tier++) {
+                variant.add(leavesMesh, _leavesTransform(treeTransform, tier).toMat4(), glm::vec3(0.0f, 1.0f, 0.0f));
+            }
+            variant.upload({0, 1, -1, -1, -1, 2, 3});
+
+            const GLuint layer = heightBucket * IMPOSTOR_THICKNESS_BUCKETS + thicknessBucket;
+            variantBounds[layer] = variant.getBounds();
+            _impostorAtlas.bake(layer, variantBounds[layer], [&](const glm::mat4& viewProjectionMtx) {
+                _impostorBakeProg->setProgramUniform(_impostorBakeViewProjectionLocation, viewProjectionMtx);
+                variant.draw();
+            });
+        }
+    }
+    _impostorAtlas.finish();
+
+    // A card per tree, over the bounds of its variant moved to the tree.
+    _impostorInstances.reserve(_trees.size());
+    _impostorBounds.reserve(_trees.size());
+    for (const TreeData& tree : _trees) {
+        const GLuint layer = bucket(tree.modelMatrix[1][1], minHeight, maxHeight, IMPOSTOR_HEIGHT_BUCKETS) * IMPOSTOR_THICKNESS_BUCKETS
+                           + bucket(tree.trunkThickness, minThickness, maxThickness, IMPOSTOR_THICKNESS_BUCKETS);
+        const BoundingSphere bounds{glm::vec3(tree.modelMatrix[3]) + variantBounds[layer].center, variantBounds[layer].radius};
+        const glm::mat4 cardMtx = glm::scale(glm::translate(glm::mat4(1.0f), bounds.center), glm::vec3(bounds.radius));
+        const glm::mat3 cardData(tree.leavesColor, glm::vec3(static_cast<GLfloat>(layer), 0.0f, 0.0f), glm::vec3(0.0f));
+        _impostorInstances.push_back({cardMtx, cardData, tree.trunkColor});
+        _impostorBounds.push_back(bounds);
+    }
+    fprintf( stdout, "[INFO]: %u tree variants baked into the impostor atlas\n", variantCount );
+
+    // Card corners in [-1, 1], turned towards the camera by the shader.
+    MeshData card;
+    card.vertices = {
+            { {-1.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f} },
+            { { 1.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f} },
+            { {-1.0f,  1.0f, 0.0f}, {0.0f, 0.0f, 1.0f} },
+            { { 1.0f,  1.0f, 0.0f}, {0.0f, 0.0f, 1.0f} }
+    };
+    card.indices = {0, 1, 2,   2, 1, 3};
+    _impostorMesh = _renderQueue.addMesh(card);
+}
+
+/**
+ * Environment Chunks Creation
+ * The grass and trees never move, so every square of CHUNK_SIZE units is merged once, in world
+ * space and with its colors baked, at every level of detail. A chunk is then a single draw,
+ * whatever the number of objects inside. The baked grass no longer sways, its pivot is lost.
+ */
+void MPEngine::_createEnvironmentChunks() {
+    if (_grassInstances.empty() && _trunkInstances.empty()) return;
+
+    // Chunk coordinates of a position, over the extent of every object.
+    glm::vec2 minCorner(std::numeric_limits<GLfloat>::max());
+    glm::vec2 maxCorner(-std::numeric_limits<GLfloat>::max());
+    for (const std::vector<InstanceData>* instances : {&_grassInstances, &_trunkInstances}) {
+        for (const InstanceData& instance : *instances) {
+            const glm::vec2 position(instance.modelMatrix[3].x, instance.modelMatrix[3].z);
+            minCorner = glm::min(minCorner, position);
+            maxCorner = glm::max(maxCorner, position);
+        }
+    }
+    const GLint columns = static_cast<GLint>((maxCorner.x - minCorner.x) / CHUNK_SIZE) + 1;
+    const GLint rows = static_cast<GLint>((maxCorner.y - minCorner.y) / CHUNK_SIZE) + 1;
+    const auto chunkOf = [&](const glm::mat4& modelMtx) {
+        const GLint column = std::min(static_cast<GLint>((modelMtx[3].x - minCorner.x) / CHUNK_SIZE), columns - 1);
+        const GLint row = std::min(static_cast<GLint>((modelMtx[3].z - minCorner.y) / CHUNK_SIZE), rows - 1);
+        return static_cast<std::size_t>(row * columns + column);
+    };
+
+    // Objects of every chunk, the trunk index also gives the leaf tiers.
+    std::vector<std::vector<GLuint>> chunkGrass(static_cast<std::size_t>(columns * rows));
+    std::vector<std::vector<GLuint>> chunkTrees(chunkGrass.size());
+    for (GLuint i = 0; i < _grassInstances.size(); i++) {
+        chunkGrass[chunkOf(_grassInstances[i].modelMatrix)].push_back(i);
+    }
+    for (GLuint i = 0; i < _trunkInstances.size(); i++) {
+        chunkTrees[chunkOf(_trunkInstances[i].modelMatrix)].push_back(i);
+    }
+
+    // Only the chunks holding something, sized once since the batches cannot move.
+    std::size_t chunkCount = 0;
+    for (std::size_t c = 0; c < chunkGrass.size(); c++) {
+        if (!chunkGrass[c].empty() || !chunkTrees[c].empty()) chunkCount++;
+    }
+    _chunks = std::vector<EnvironmentChunk>(chunkCount);
+
+    std::size_t chunkIndex = 0;
+    for (GLuint level = 0; level < LOD_LEVEL_COUNT; level++) {
+        const GLint tessellation = LOD_TESSELLATION[level];
+        const MeshData clumpMesh = _grassClumpMesh(tessellation);
+        const MeshData trunkMesh = MeshData::cylinder(1.0f, 1.0f, 1.0f, tessellation, tessellation);
+        const MeshData leavesMesh = MeshData::cone(1.5f, 1.0f, tessellation, tessellation);
+
+        chunkIndex = 0;
+        for (std::size_t c = 0; c < chunkGrass.size(); c++) {
+            if (chunkGrass[c].empty() && chunkTrees[c].empty()) continue;
+            EnvironmentChunk& chunk = _chunks[chunkIndex++];
+
+            StaticBatch& batch = chunk.levels[level];
+            for (const GLuint i : chunkGrass[c]) {
+                batch.add(clumpMesh, _grassInstances[i].modelMatrix, _grassInstances[i].color);
+            }
+            for (const GLuint i : chunkTrees[c]) {
+                batch.add(trunkMesh, _trunkInstances[i].modelMatrix, _trunkInstances[i].color);
+                for (GLuint tier = 0; tier < 3; tier++) {
+                    const InstanceData& leaves = _leavesInstances[i * 3 + tier];
+                    batch.add(leavesMesh, leaves.modelMatrix, leaves.color);
+                }
+            }
+            batch.upload(_meshAttributeLocations());
+            if (level == 0) chunk.bounds = batch.getBounds();
+        }
+    }
+    fprintf( stdout, "[INFO]: Environment merged into %zu chunks of %.0fx%.0f\n", _chunks.size(), CHUNK_SIZE, CHUNK_SIZE );
+}
+
+/**
+ * Render Queue Setup
+ * Registers the draw states of the instanced meshes and uploads the shared geometry.
+ * The instance attributes carry the model matrix, so the states only reset the object block.
+ */
+void MPEngine::_setupRenderQueue() {
+    const GLuint lightingProgram = _lightingShaderProgram->getShaderProgramHandle();
+
+    // Grass, swayed by the shader unless the CPU already did.
+    _grassState = _renderQueue.addState(lightingProgram,
+        [this](const glm::mat4&, const glm::mat4&) {
+            StreamBuffer::bindUniformRange(OBJECT_BLOCK_BINDING, _worldObjectRange);
+            _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.useInstancing, 1);
+            _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.swayGrass, _swayGrassOnCpu ? 0 : 1);
+        },
+        [this]() {
+            _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.useInstancing, 0);
+            _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.swayGrass, 0);
+        });
+
+    // Trunks and leaves.
+    _treeState = _renderQueue.addState(lightingProgram,
+        [this](const glm::mat4&, const glm::mat4&) {
+            StreamBuffer::bindUniformRange(OBJECT_BLOCK_BINDING, _worldObjectRange);
+            _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.useInstancing, 1);
+        },
+        [this]() {
+            _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.useInstancing, 0);
+        });
+
+    // Far trees, drawn as cards by their own shader.
+    _impostorState = _renderQueue.addState(_impostorProg->getShaderProgramHandle(),
+        [this](const glm::mat4&, const glm::mat4&) {
+            _impostorAtlas.bind(0);
+            _impostorProg->setProgramUniform(_impostorAlbedoLocation, 0);
+            _impostorProg->setProgramUniform(_impostorNormalLocation, 1);
+            _impostorProg->setProgramUniform(_impostorFramesPerSideLocation, static_cast<GLfloat>(_impostorAtlas.getFramesPerSide()));
+        },
+        []() {});
+
+    _renderQueue.upload(_meshAttributeLocations(), &_streamBuffer);
+    _renderQueue.setContributionThreshold(_contributionThreshold);
+    _setupGpuCulling();
+}
+
+/**
+ * GPU Culling Setup
+ * On OpenGL 4.3+, the grass, trunks and leaves are also sent to the GPU as static groups, culled and
+ * sorted into levels of detail by a compute shader for every view. Older contexts keep the CPU path.
+ */
+void MPEngine::_setupGpuCulling() {
+    if (!_renderQueue.isGpuCullingSupported()) {
+        fprintf( stdout, "[INFO]: GPU culling needs OpenGL 4.3, culling on the CPU\n" );
+        return;
+    }
+
+    const GLuint computeShader = CSCI441_INTERNAL::ShaderUtils::compileShader("shaders/cull.c.glsl", GL_COMPUTE_SHADER);
+    if (!computeShader) return;
+    _cullProgramHandle = glCreateProgram();
+    glAttachShader(_cullProgramHandle, computeShader);
+    glLinkProgram(_cullProgramHandle);
+    glDetachShader(_cullProgramHandle, computeShader);
+    glDeleteShader(computeShader);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(_cullProgramHandle, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        CSCI441_INTERNAL::ShaderUtils::printProgramLog(_cullProgramHandle);
+        fprintf( stderr, "[ERROR]: Could not link the culling shader, culling on the CPU\n" );
+        glDeleteProgram(_cullProgramHandle);
+        _cullProgramHandle = 0;
+        return;
+    }
+    _renderQueue.setCullProgram(_cullProgramHandle);
+
+    // Every level of detail of each mesh.
+    const std::vector<RenderQueue::MeshHandle> grassMeshes(std::begin(_grassMeshes), std::end(_grassMeshes));
+    const std::vector<RenderQueue::MeshHandle> trunkMeshes(std::begin(_trunkMeshes), std::end(_trunkMeshes));
+    const std::vector<RenderQueue::MeshHandle> leavesMeshes(std::begin(_leavesMeshes), std::end(_leavesMeshes));
+    _grassGroup = _renderQueue.addGpuGroup(_grassState, grassMeshes, _lodSelector, _grassInstances, _grassBounds);
+    _trunkGroup = _renderQueue.addGpuGroup(_treeState, trunkMeshes, _lodSelector, _trunkInstances, _trunkBounds);
+    _leavesGroup = _renderQueue.addGpuGroup(_treeState, leavesMeshes, _lodSelector, _leavesInstances, _leavesBounds);
+
+    _enableGpuCulling = true;
+    fprintf( stdout, "[INFO]: Grass and trees culled on the GPU\n" );
+}
+
+/**
+ * Mesh attribute locations
+ * Gathers the lighting shader attribute locations needed to create an instanced mesh.
+ * @return the vertex and instance attribute locations.
+ */
+MeshAttributeLocations MPEngine::_meshAttributeLocations() const {
+    return {
+        _lightingShaderAttributeLocations.vPos,
+        _lightingShaderAttributeLocations.vertexNormal,
+        _lightingShaderAttributeLocations.instanceModelMatrix,
+        _lightingShaderAttributeLocations.instanceNormalMatrix,
+        _lightingShaderAttributeLocations.instanceColor,
+        _lightingShaderAttributeLocations.vertexColor,
+        _lightingShaderAttributeLocations.partIndex
+    };
+}
+
 /**
  * Scene Setup
  * Sets the arc-ball camera and hero parameters before rendering.
@@ -473,7 +1001,6 @@ void MPEngine::mSetupScene() {
     _setLightingParameters();
 
     // Data of the current hero being controlled:
-    glm::mat4 heroModelMtx(1.0f);
     glm::vec3 initialPosition(0.0f, 0.0f, 0.0f);
     GLfloat yaw = 0.0f;
     GLfloat pitch = 0.0f;
@@ -481,19 +1008,19 @@ void MPEngine::mSetupScene() {
 
     // Inserting the heroes into the list.
     _heroes.reserve(NUMBER_OF_HEROES);
-    _heroes.push_back({_daglas, initialPosition, yaw, pitch, heroModelMtx, blinkTime});
-    _heroes.push_back({_paco, initialPosition, yaw, pitch, heroModelMtx, blinkTime});
-    _heroes.push_back({_darrow, initialPosition, yaw, pitch, heroModelMtx, blinkTime});
-    _heroes.push_back({_petre, initialPosition, yaw, pitch, heroModelMtx, blinkTime});
+    _heroes.push_back({_daglas, initialPosition, yaw, pitch, SceneGraph::ROOT, blinkTime});
+    _heroes.push_back({_paco, initialPosition, yaw, pitch, SceneGraph::ROOT, blinkTime});
+    _heroes.push_back({_darrow, initialPosition, yaw, pitch, SceneGraph::ROOT, blinkTime});
+    _heroes.push_back({_petre, initialPosition, yaw, pitch, SceneGraph::ROOT, blinkTime});
 
     // Initializing the position and size of the heroes.
     int i = 1;
     for (HeroData& hero : _heroes) {
-        glm::mat4 modelMatrix(1.0f);
         glm::vec3 position = {hero.heroPosition.x + (i * 7.0), hero.heroPosition.y, hero.heroPosition.z};
-        modelMatrix = glm::translate(modelMatrix, position);
-        modelMatrix = glm::scale(modelMatrix, glm::vec3(5.0f));
-        hero.modelMatrix = modelMatrix;
+        hero.modelTransform = AffineTransform().translate(position).scale(glm::vec3(5.0f));
+        // Spawned still, the first interpolated frame starts from the spawn pose.
+        hero.previousModelTransform = hero.modelTransform;
+        hero.node = _sceneGraph.addNode(SceneGraph::ROOT, hero.modelTransform);
         i++;
     }
 
@@ -508,57 +1035,23 @@ void MPEngine::mSetupScene() {
  */
 void MPEngine::_setLightingParameters() {
 
-    // ------- Lighting uniforms -------
+    // ------- Lighting block -------
 
     // Directional light
-    glm::vec3 dir_lightDirection = {-1, -1, -1}; // Normalized vector
-    glm::vec3 dir_lightColor = {1.0, 1.0, 1.0}; // White light
-
-    glProgramUniform3fv(_lightingShaderProgram->getShaderProgramHandle(),   // Program handle
-                        _lightingShaderUniformLocations.dir_lightDirection, // Uniform location
-                        1,                                                  // Number of elements
-                        glm::value_ptr(dir_lightDirection));             //  Start of the data
-
-    glProgramUniform3fv(_lightingShaderProgram->getShaderProgramHandle(),   // Program handle
-                        _lightingShaderUniformLocations.dir_lightColor,     // Uniform location
-                        1,                                                  // Number of elements
-                        glm::value_ptr(dir_lightColor));                 // Start of the data
+    _lights.directionalDirection = {-1, -1, -1}; // Normalized vector
+    _lights.directionalColor = {1.0, 1.0, 1.0}; // White light
 
     // Point light
-    sunPosition = {0.0f, 150.0f, 50.0f};
-    glm::vec3 point_lightPosition = sunPosition; // Position of our sun
-    glm::vec3 point_lightColor = {1, 0.882, 0.765}; // Orange light
-
-    glProgramUniform3fv(_lightingShaderProgram->getShaderProgramHandle(),    // Program handle
-                        _lightingShaderUniformLocations.point_lightPosition, // Uniform location
-                        1,                                                   // Number of elements
-                        glm::value_ptr(point_lightPosition));             //  Start of the data
-
-    glProgramUniform3fv(_lightingShaderProgram->getShaderProgramHandle(),    // Program handle
-                        _lightingShaderUniformLocations.point_lightColor,    // Uniform location
-                        1,                                                   // Number of elements
-                        glm::value_ptr(point_lightColor));                // Start of the data
+    _lights.pointPosition = sunPosition; // Position of our sun
+    _lights.pointColor = {1, 0.882, 0.765}; // Orange light
 
     // Spotlight
-    glm::vec3 spot_lightPosition = {0.0, 15.0, 0.0}; // initial position
-    glm::vec3 spot_lightDirection = {0, -1, 0};
-    glm::vec3 spot_lightColor = {1, 0.777, 0.777}; // Light red
-
-    glProgramUniform3fv(_lightingShaderProgram->getShaderProgramHandle(),    // Program handle
-                        _lightingShaderUniformLocations.spot_lightPosition,  // Uniform location
-                        1,                                                   // Number of elements
-                        glm::value_ptr(spot_lightPosition));             //  Start of the data
-
-    glProgramUniform3fv(_lightingShaderProgram->getShaderProgramHandle(),    // Program handle
-                        _lightingShaderUniformLocations.spot_lightDirection, // Uniform location
-                        1,                                                   // Number of elements
-                        glm::value_ptr(spot_lightDirection));             // Start of the data
-
-    glProgramUniform3fv(_lightingShaderProgram->getShaderProgramHandle(),    // Program handle
-                        _lightingShaderUniformLocations.spot_lightColor,     // Uniform location
-                        1,                                                   // Number of elements
-                        glm::value_ptr(spot_lightColor));                 // Start of the data
+    _lights.spotPosition = {0.0, 15.0, 0.0}; // initial position
+    _lights.spotDirection = {0, -1, 0};
+    _lights.spotColor = {1, 0.777, 0.777}; // Light red
 
+    // Sent once, the block is only written again when a light moves.
+    _lightUniformBuffer.update(_lights);
 }
 
 //**********************************************************************************
@@ -573,6 +1066,16 @@ void MPEngine::mCleanupShaders() {
     fprintf( stdout, "[INFO]: ...deleting Shaders.\n" );
     delete _lightingShaderProgram;
     _lightingShaderProgram = nullptr;
+    delete _pipProg;
+    _pipProg = nullptr;
+    delete _occluderProg;
+    _occluderProg = nullptr;
+    delete _impostorProg;
+    _impostorProg = nullptr;
+    delete _impostorBakeProg;
+    _impostorBakeProg = nullptr;
+    if (_cullProgramHandle) glDeleteProgram(_cullProgramHandle);
+    _cullProgramHandle = 0;
 }
 
 /**
@@ -582,8 +1085,24 @@ void MPEngine::mCleanupShaders() {
 void MPEngine::mCleanupBuffers() {
     fprintf( stdout, "[INFO]: ...deleting VAOs....\n" );
     CSCI441::deleteObjectVAOs();
-    glDeleteVertexArrays( 1, &_groundVAO );
-    _groundVAO = 0;
+    _staticBatch.destroy();
+    for (StaticBatch& sunBatch : _sunBatches) {
+        sunBatch.destroy();
+    }
+    _renderQueue.destroy();
+    _streamBuffer.destroy();
+    _lightUniformBuffer.destroy();
+    _pipTarget.destroy();
+    _occluderBatch.destroy();
+    _occlusionBuffer.destroy();
+    _impostorAtlas.destroy();
+    for (EnvironmentChunk& chunk : _chunks) {
+        for (StaticBatch& batch : chunk.levels) {
+            batch.destroy();
+        }
+    }
+    if (_pipVAO) glDeleteVertexArrays(1, &_pipVAO);
+    _pipVAO = 0;
 
     fprintf( stdout, "[INFO]: ...deleting VBOs....\n" );
     CSCI441::deleteObjectVBOs();
@@ -625,133 +1144,239 @@ void MPEngine::mCleanupScene() {
 //***************************************************************************************
 
 /**
- * Scene Rendering
- * This function does all the drawing in our scene: grid, world and hero.
- * @param viewMtx : View matrix used by the drawing functions to go from world space to eye space.
- * @param projMtx : Projection matrix used by the drawing functions to go from eye space to clip space.
+ * Frame preparation
+ * This function computes everything that does not depend on the view, once per frame, and submits all
+ * the drawing in our scene to the render queue: world, heroes and skybox, each with its bounds. The queue
+ * then sorts it by pass, shader, state and distance, ready to be culled and executed by every view.
  */
-void MPEngine::_renderScene(const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
-    // ---------------------- SKYBOX FIRST (new) ----------------------
-    _drawSkybox(viewMtx, projMtx);
-
-    // Using our lighting shader program
-    _lightingShaderProgram->useProgram();
-
-    /// ---------------------------- DRAWING GROUND ----------------------------
-    // Drawing the ground plane
-    const glm::mat4 groundModelMtx = glm::scale( glm::mat4(1.0f), glm::vec3(WORLD_SIZE, 1.0f, WORLD_SIZE));
-    _computeAndSendMatrixUniforms(groundModelMtx, viewMtx, projMtx);
-
-    // Green ground made of grass.
-    constexpr glm::vec3 groundColor(0.161f, 0.522f, 0.024f);
-    _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.materialColor, groundColor);
+void MPEngine::_prepareFrame(const FrameSnapshot& snapshot) {
+    const GLuint lightingProgram = _lightingShaderProgram->getShaderProgramHandle();
 
-    glBindVertexArray(_groundVAO);
-    glDrawElements(GL_TRIANGLE_STRIP, _numGroundPoints, GL_UNSIGNED_SHORT, (void*)0);
+    // Only the heroes that moved get new world matrices and bounds.
+    for (std::size_t i = 0; i < snapshot.heroTransforms.size(); i++) {
+        _sceneGraph.setLocal(_heroes[i].node, snapshot.heroTransforms[i]);
+    }
+    _sceneGraph.update();
 
-    // Drawing hill
-    const glm::mat4 hillModelMtx = glm::translate(glm::mat4(1.0f), glm::vec3(WORLD_SIZE * 0.5, -WORLD_SIZE*0.25f, WORLD_SIZE * 0.5));
-    _computeAndSendMatrixUniforms(hillModelMtx, viewMtx, projMtx);
-    _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.materialColor, groundColor);
-    
-    CSCI441::drawSolidDome(WORLD_SIZE * 0.5f, 20, 20);
+    // Only uploading the lights when the spotlight moved.
+    if (snapshot.spotlightPosition != _lights.spotPosition) {
+        _lights.spotPosition = snapshot.spotlightPosition;
+        _lightUniformBuffer.update(_lights);
+    }
 
+    // The static batch and the instances are already in world space.
+    _worldObjectRange = _streamBuffer.writeUniformBlock(_sceneGraph.getObjectBlock(SceneGraph::ROOT));
 
+    /// ---------------------------- DRAWING STATIC WORLD ----------------------------
+    // Ground and hill in a single draw call.
+    _renderQueue.submit(PASS_OPAQUE, lightingProgram,
+        [this](const glm::mat4&, const glm::mat4&) { drawStaticWorld(_staticBatch); },
+        RenderQueue::ALL_VIEWS, _staticBatch.getBounds());
 
     /// ---------------------------- DRAWING WORLD ----------------------------
 
-    // Drawing sun
-    drawSun(viewMtx, projMtx);
-
-    // Drawing grass
-    for( const GrassData& newGrass : _grass ) {
-        drawGrass(newGrass.color, newGrass.modelMatrix, viewMtx, projMtx);
+    // Every view drawn this frame, the environment outside all of them is not even submitted,
+    // and the rest is as detailed as the closest of them needs.
+    std::vector<Frustum> frustums;
+    std::vector<LodViewpoint> viewpoints;
+    frustums.emplace_back(snapshot.projectionMatrix * snapshot.viewMatrix);
+    viewpoints.emplace_back(snapshot.viewMatrix, snapshot.projectionMatrix);
+    if (_enableFPC) {
+        frustums.emplace_back(snapshot.firstPersonProjectionMatrix * snapshot.firstPersonViewMatrix);
+        viewpoints.emplace_back(snapshot.firstPersonViewMatrix, snapshot.firstPersonProjectionMatrix);
     }
 
-    // Drawing trees
-    for( const TreeData& newTree : _trees ) {
-         drawTree(newTree, viewMtx, projMtx);
+    // Drawing the sun
+    const BoundingSphere sunBounds = _sunBatches[0].getBounds();
+    _sunLod = _lodSelector.select(LodSelector::screenSize(sunBounds, viewpoints), _sunLod);
+    _renderQueue.submit(PASS_OPAQUE, lightingProgram,
+        [this](const glm::mat4&, const glm::mat4&) { drawStaticWorld(_sunBatches[_sunLod]); },
+        RenderQueue::ALL_VIEWS, sunBounds);
+
+    if (_enableChunks && !_chunks.empty()) {
+        // Grass and trees as a few merged chunks, a draw per visible chunk.
+        submitChunks(viewpoints);
+    } else if (_enableGpuCulling) {
+        // Grass and trees culled by the GPU for every view, the CPU does not touch a single instance.
+        // The instances of the group never change, grass swayed by the CPU goes through the CPU path.
+        if (_swayGrassOnCpu) {
+            _jobSystem.wait(_scheduleGrassSway(static_cast<GLfloat>(snapshot.frame.time)));
+            submitGrass(frustums, viewpoints);
+        } else {
+            _renderQueue.submitGroup(PASS_OPAQUE, _grassGroup);
+        }
+        _renderQueue.submitGroup(PASS_OPAQUE, _trunkGroup);
+        _renderQueue.submitGroup(PASS_OPAQUE, _leavesGroup);
+    } else {
+        // Swaying the grass on the workers when the shader does not, while the trees are submitted
+        const JobSystem::JobHandle grassSway = _swayGrassOnCpu ? _scheduleGrassSway(static_cast<GLfloat>(snapshot.frame.time)) : nullptr;
+
+        // Drawing trees
+        submitTrees(frustums, viewpoints);
+
+        // Drawing grass, once swayed
+        _jobSystem.wait(grassSway);
+        submitGrass(frustums, viewpoints);
     }
 
     /// ---------------------------- DRAWING HEROES ----------------------------
 
     // Drawing our models, the heroes!!!
     for (int i = 0 ; i < _heroes.size() ; i++) {
+        // Palette and matrices once, whatever the number of views.
+        HeroData& hero = _heroes[i];
+        if (_sceneGraph.wasUpdated(hero.node)) {
+            const glm::mat4 modelMtx = _sceneGraph.getObjectBlock(hero.node).modelMatrix;
+            hero.worldBounds = hero.hero -> getBounds().transformed(modelMtx);
+            hero.worldDetailBounds = hero.hero -> getDetailBounds().transformed(modelMtx);
+        }
+        hero.hero -> prepareHero(_sceneGraph.getObjectBlock(hero.node), snapshot.frame);
+
         // Hiding the hero in first-person camera view
-        if (_enableFPC && _firstPersonView && i == heroIndex) {
-            continue;
+        RenderQueue::ViewMask views = RenderQueue::ALL_VIEWS;
+        if (_enableFPC && i == snapshot.heroIndex) {
+            views &= ~(1u << FIRST_PERSON_VIEW);
         }
-        _heroes[i].hero -> drawHero(_heroes[i].modelMatrix, viewMtx, projMtx);
-        _heroes[i].hero -> setStop(true);
+        const BoundingSphere details = hero.worldDetailBounds;
+        _renderQueue.submit(PASS_OPAQUE, lightingProgram,
+            [this, i, details](const glm::mat4&, const glm::mat4&) {
+                // Pupils, nose and cheeks only once they cover a few pixels in this view.
+                _heroes[i].hero -> drawHero(_renderQueue.contributes(details));
+            },
+            views, hero.worldBounds);
+    }
+
+    /// ---------------------------- DRAWING SKYBOX ----------------------------
+    // Sky pass after the opaque one, at the far plane it only shades the pixels left uncovered.
+    if (_skyboxProg) {
+        _renderQueue.submit(PASS_SKY, _skyboxProg->getShaderProgramHandle(),
+            [this](const glm::mat4& view, const glm::mat4& proj) { _drawSkybox(view, proj); });
+    }
+
+    // Closest first from the main camera, the first-person view is nearby anyway.
+    _renderQueue.prepare(viewpoints.front().position);
+}
+
+/**
+ * View Rendering
+ * Draws the prepared frame from one camera, only the view-projection and visibility change between views.
+ * @param viewMtx : View matrix used by the drawing functions to go from world space to eye space.
+ * @param projMtx : Projection matrix used by the drawing functions to go from eye space to clip space.
+ * @param view : Which view is drawn, to skip what it must not see.
+ * @param frame : Time of the frame being drawn.
+ */
+void MPEngine::_renderView(const glm::mat4& viewMtx, const glm::mat4& projMtx, const SceneView view, const FrameContext& frame) {
+    // Camera and time of this view, shared by every draw of the lighting shader.
+    _sendFrameData(viewMtx, projMtx, frame);
+
+    // Depth of the big occluders first, the grass and trees hidden behind them are skipped.
+    const OcclusionBuffer* occlusion = nullptr;
+    if (_enableOcclusion) {
+        _renderOccluders(projMtx * viewMtx);
+        occlusion = &_occlusionBuffer;
     }
 
+    // Only what intersects the frustum of this view is streamed and drawn.
+    _renderQueue.execute(viewMtx, projMtx, 1u << view, occlusion);
+    _culledCounts[view] = _renderQueue.getCulledCount();
+    _occludedCounts[view] = _renderQueue.getOccludedCount();
+    _smallCounts[view] = _renderQueue.getSmallCount();
 }
 
 /**
- * Sun Drawing
- * Helper function to draw a beautiful sun to light our world
- * It draws a big sphere
- * @param viewMtx : View matrix from the scene rendering.
- * @param projMtx : Projection matrix from the scene rendering.
+ * Occluders Rendering
+ * Draws the ground, the hill and the trees in the low resolution occlusion buffer of the view,
+ * which reduces them into its depth pyramid.
+ * @param viewProjectionMtx : Projection times view matrix of the view.
  */
-void MPEngine::drawSun(const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void MPEngine::_renderOccluders(const glm::mat4& viewProjectionMtx) {
+    _occlusionBuffer.begin();
+
+    _occluderProg->useProgram();
+    _occluderProg->setProgramUniform(_occluderViewProjectionLocation, viewProjectionMtx);
+    _occluderBatch.draw();
+
+    _occlusionBuffer.end(viewProjectionMtx);
+}
+
+/**
+ * Culling report
+ * Shows how many objects each view skipped in the window title, twice per second so it stays readable.
+ * @param frame : Time of the frame.
+ */
+void MPEngine::_reportCulling(const FrameContext& frame) {
+    if (frame.time - _lastCullingReportTime < 0.5) return;
+    _lastCullingReportTime = frame.time;
+
+    char title[224];
+    if (_enableFPC) {
+        snprintf(title, sizeof(title), "MP (:-D) - culled: %d main, %d first person - occluded: %d main, %d first person - too small: %d main, %d first person",
+                 _culledCounts[MAIN_VIEW], _culledCounts[FIRST_PERSON_VIEW],
+                 _occludedCounts[MAIN_VIEW], _occludedCounts[FIRST_PERSON_VIEW],
+                 _smallCounts[MAIN_VIEW], _smallCounts[FIRST_PERSON_VIEW]);
+    } else {
+        snprintf(title, sizeof(title), "MP (:-D) - culled: %d - occluded: %d - too small: %d",
+                 _culledCounts[MAIN_VIEW], _occludedCounts[MAIN_VIEW], _smallCounts[MAIN_VIEW]);
+    }
+    glfwSetWindowTitle(mpWindow, title);
+}
+
+/**
+ * Sun Baking
+ * Helper function to add a beautiful sun to its own static batch to light our world
+ * It adds a big sphere and six beams around it
+ * @param batch : Batch receiving the sun.
+ * @param tessellation : Slices and stacks of the beams, the sphere gets twice as many.
+ */
+void MPEngine::_addSunToBatch(StaticBatch& batch, const GLint tessellation) {
 
     // Sun sphere:
     glm::mat4 sunModelMtx = glm::translate(glm::mat4(1.0f), sunPosition);
     sunModelMtx = glm::scale(sunModelMtx, glm::vec3(5.0f));
-    _computeAndSendMatrixUniforms(sunModelMtx, viewMtx, projMtx);
     glm::vec3 brightOrange(1.0f, 0.72f, 0.0f);
-    _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.materialColor, brightOrange);
-    CSCI441::drawSolidSphere(1.0f, 40, 40);
+    batch.add(MeshData::sphere(1.0f, 2 * tessellation, 2 * tessellation), sunModelMtx, brightOrange);
 
     // Bean in the +X axis
-    drawBeam(viewMtx, projMtx,
-             glm::vec3(1, 0, 0),
-             glm::vec3(0, 0, 1),
-             glm::radians(-90.0f));
+    _addBeamToBatch(batch, tessellation, glm::vec3(1, 0, 0),
+                    glm::vec3(0, 0, 1),
+                    glm::radians(-90.0f));
 
     // Bean in the -X axis
-    drawBeam(viewMtx, projMtx,
-             glm::vec3(-1, 0, 0),
-             glm::vec3(0, 0, 1),
-             glm::radians(90.0f));
+    _addBeamToBatch(batch, tessellation, glm::vec3(-1, 0, 0),
+                    glm::vec3(0, 0, 1),
+                    glm::radians(90.0f));
 
     // Bean in the +Y axis
-    drawBeam(viewMtx, projMtx,
-             glm::vec3(0, 1, 0),
-             glm::vec3(1, 0, 0),
-             glm::radians(0.0f));
+    _addBeamToBatch(batch, tessellation, glm::vec3(0, 1, 0),
+                    glm::vec3(1, 0, 0),
+                    glm::radians(0.0f));
 
     // Bean in the -Y axis
-    drawBeam(viewMtx, projMtx,
-             glm::vec3(0, -1, 0),
-             glm::vec3(1, 0, 0),
-             glm::radians(180.0f));
+    _addBeamToBatch(batch, tessellation, glm::vec3(0, -1, 0),
+                    glm::vec3(1, 0, 0),
+                    glm::radians(180.0f));
 
     // Bean in the +Z axis
-    drawBeam(viewMtx, projMtx,
-             glm::vec3(0, 0, 1),
-             glm::vec3(1, 0, 0),
-             glm::radians(90.0f));
+    _addBeamToBatch(batch, tessellation, glm::vec3(0, 0, 1),
+                    glm::vec3(1, 0, 0),
+                    glm::radians(90.0f));
 
     // Bean in the -Z axis
-    drawBeam(viewMtx, projMtx,
-             glm::vec3(0, 0, -1),
-             glm::vec3(1, 0, 0),
-             glm::radians(-90.0f));
+    _addBeamToBatch(batch, tessellation, glm::vec3(0, 0, -1),
+                    glm::vec3(1, 0, 0),
+                    glm::radians(-90.0f));
 
 }
 
 /**
- * Beam Drawing
- * @param viewMtx : View matrix from the scene rendering.
- * @param projMtx : Projection matrix from the scene rendering.
+ * Beam Baking
+ * @param batch : Batch receiving the beam.
+ * @param tessellation : Slices and stacks of the cone.
  * @param dirAxis : direction axis where the beam is facing.
  * @param rotAxis : rotation axis to orient the beam outwards.
  * @param rotAngle : rotation angle to rotate the cone.
  */
-void MPEngine::drawBeam(const glm::mat4 &viewMtx, const glm::mat4 &projMtx,
-                        glm::vec3 dirAxis, glm::vec3 rotAxis, float rotAngle) const {
+void MPEngine::_addBeamToBatch(StaticBatch& batch, const GLint tessellation, glm::vec3 dirAxis, glm::vec3 rotAxis, float rotAngle) {
     // Beam separation from the sphere.
     float beamOffset = 5.5;
 
@@ -760,158 +1385,248 @@ void MPEngine::drawBeam(const glm::mat4 &viewMtx, const glm::mat4 &projMtx,
     beamModelMtx = glm::rotate(beamModelMtx, rotAngle, rotAxis);
     beamModelMtx = glm::scale(beamModelMtx, glm::vec3(2.0f, 15.0f, 2.0f));
 
-    // Sending the cone to the shader and drawing.
-    _computeAndSendMatrixUniforms(beamModelMtx, viewMtx, projMtx);
+    // Baking the cone into the batch.
     glm::vec3 brightYellow(1.0f, 0.83f, 0.0f);
-    _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.materialColor, brightYellow);
-    CSCI441::drawSolidCone(0.5f, 0.3f, 20, 20);
+    batch.add(MeshData::cone(0.5f, 0.3f, tessellation, tessellation), beamModelMtx, brightYellow);
+}
+
+/**
+ * Static World Drawing
+ * Draws one of the static batches (ground and hill, or sun), the colors come from the vertices.
+ * @param batch : World space batch to draw.
+ */
+void MPEngine::drawStaticWorld(const StaticBatch& batch) {
+
+    // The batch is already in world space.
+    StreamBuffer::bindUniformRange(OBJECT_BLOCK_BINDING, _worldObjectRange);
+    _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.useVertexColor, 1);
+
+    batch.draw();
+
+    _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.useVertexColor, 0);
 }
 
 
 /**
- * Grass Drawing
- * Helper function to draw the grass generated previously.
- * It draws three green cones close together.
- * @param color : color of the grass.
- * @param modelMtx : Model matrix to perform transformations.
- * @param viewMtx : View matrix from the scene rendering.
- * @param projMtx : Projection matrix from the scene rendering.
+ * Grass Submission
+ * Helper function to submit the grass generated previously to the render queue.
+ * The queue merges all the clumps into one instanced draw per level of detail, the shader sways each one
+ * unless the CPU already swayed the instances.
+ * @param frustums : Frustums of the views drawn this frame, only their grid cells are visited.
+ * @param viewpoints : Cameras of the views, the level of each clump follows its size on screen.
  */
-void MPEngine::drawGrass(glm::vec3 color, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void MPEngine::submitGrass(const std::vector<Frustum>& frustums, const std::vector<LodViewpoint>& viewpoints) {
+    const std::vector<InstanceData>& instances = _swayGrassOnCpu ? _swayedGrassInstances : _grassInstances;
+    _queriedObjects.clear();
+    _grassGrid.queryFrustums(frustums, _queriedObjects);
+
+    // Levels selected on every worker, each clump only writes its own.
+    _jobSystem.parallelFor(_queriedObjects.size(), LOD_GRAIN, [this, &viewpoints](const std::size_t first, const std::size_t last) {
+        for (std::size_t k = first; k < last; k++) {
+            const GLuint i = _queriedObjects[k];
+            _grassLods[i] = static_cast<GLubyte>(_lodSelector.select(LodSelector::screenSize(_grassBounds[i], viewpoints), _grassLods[i]));
+        }
+    });
 
-    // Three flat cones close together and the middle one is taller.
-    for (int i = 0 ; i < 3 ; i++) {
-        _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-        _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.materialColor, color);
-        float grassHeight = 0.15f;
-        if (i == 1)
-            grassHeight = 0.20f;
-        CSCI441::drawSolidCone( 0.15f, grassHeight, 10, 10 );
-        modelMtx = glm::translate(modelMtx, glm::vec3(0.15f, 0.0f, 0.0f));
+    // The queue is only filled by this thread.
+    for (const GLuint i : _queriedObjects) {
+        _renderQueue.submit(PASS_OPAQUE, _grassState, _grassMeshes[_grassLods[i]], instances[i], _grassBounds[i]);
     }
+}
 
+/**
+ * Tree Submission
+ * Helper function to submit the trees, a trunk and three leaf tiers each, to the render queue.
+ * The queue merges them into one multi-draw of two instanced commands per level of detail.
+ * Trees far from every camera are submitted as a single impostor card instead.
+ * @param frustums : Frustums of the views drawn this frame, only their grid cells are visited.
+ * @param viewpoints : Cameras of the views, the level of each tree follows its size on screen.
+ */
+void MPEngine::submitTrees(const std::vector<Frustum>& frustums, const std::vector<LodViewpoint>& viewpoints) {
+    _queriedObjects.clear();
+    _treeGrid.queryFrustums(frustums, _queriedObjects);
+
+    // Levels selected on every worker, each tree only writes its own.
+    const bool impostors = _enableImpostors && !_impostorInstances.empty();
+    _jobSystem.parallelFor(_queriedObjects.size(), LOD_GRAIN, [this, &viewpoints, impostors](const std::size_t first, const std::size_t last) {
+        for (std::size_t k = first; k < last; k++) {
+            const GLuint i = _queriedObjects[k];
+
+            // Far from every camera, a single card. It must come a little closer before the real tree is back.
+            if (impostors) {
+                GLfloat distance = std::numeric_limits<GLfloat>::max();
+                for (const LodViewpoint& viewpoint : viewpoints) {
+                    distance = std::min(distance, glm::length(_treeBounds[i].center - viewpoint.position));
+                }
+                const bool impostor = _treeLods[i] == IMPOSTOR_LEVEL;
+                if (distance > _impostorDistance * (impostor ? 1.0f - _lodSelector.getHysteresis() : 1.0f)) {
+                    _treeLods[i] = IMPOSTOR_LEVEL;
+                    continue;
+                }
+            }
+            _treeLods[i] = static_cast<GLubyte>(_lodSelector.select(LodSelector::screenSize(_treeBounds[i], viewpoints), _treeLods[i]));
+        }
+    });
+
+    // The queue is only filled by this thread.
+    for (const GLuint i : _queriedObjects) {
+        if (_treeLods[i] == IMPOSTOR_LEVEL) {
+            _renderQueue.submit(PASS_OPAQUE, _impostorState, _impostorMesh, _impostorInstances[i], _impostorBounds[i]);
+            continue;
+        }
+        const GLuint level = _treeLods[i];
+
+        _renderQueue.submit(PASS_OPAQUE, _treeState, _trunkMeshes[level], _trunkInstances[i], _trunkBounds[i]);
+        for (GLuint tier = 0; tier < 3; tier++) {
+            _renderQueue.submit(PASS_OPAQUE, _treeState, _leavesMeshes[level], _leavesInstances[i * 3 + tier], _leavesBounds[i * 3 + tier]);
+        }
+    }
+}
+
+
+/**
+ * Chunk Submission
+ * Helper function to submit the merged grass and tree chunks to the render queue. Each chunk is a single
+ * draw, culled as a whole by the queue, with the level of detail its size on screen asks for.
+ * @param viewpoints : Cameras of the views, the level of each chunk follows its size on screen.
+ */
+void MPEngine::submitChunks(const std::vector<LodViewpoint>& viewpoints) {
+    const GLuint lightingProgram = _lightingShaderProgram->getShaderProgramHandle();
+    _jobSystem.parallelFor(_chunks.size(), LOD_GRAIN / 16, [this, &viewpoints](const std::size_t first, const std::size_t last) {
+        for (std::size_t c = first; c < last; c++) {
+            _chunks[c].lod = _lodSelector.select(LodSelector::screenSize(_chunks[c].bounds, viewpoints), _chunks[c].lod);
+        }
+    });
+
+    for (std::size_t c = 0; c < _chunks.size(); c++) {
+        const EnvironmentChunk& chunk = _chunks[c];
+        _renderQueue.submit(PASS_OPAQUE, lightingProgram,
+            [this, c](const glm::mat4&, const glm::mat4&) { drawStaticWorld(_chunks[c].levels[_chunks[c].lod]); },
+            RenderQueue::ALL_VIEWS, chunk.bounds);
+    }
 }
 
 /**
- * Tree Drawing
- * Helper function to draw trees with a trunk and leaves.
- * It draws a cylinder trunk with random thickness and three cones stacked as leaves.
- * @param tree : TreeData structure storing model, color and thickness.
- * @param viewMtx : View matrix from the scene rendering.
- * @param projMtx : Projection matrix from the scene rendering.
+ * Grass sway job
+ * The clumps are split in ranges swayed by every worker.
+ * @param time : Time of the snapshot being drawn.
+ * @return job finished once every swayed instance is written.
  */
-void MPEngine::drawTree(const TreeData& tree, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
-    // Drawing the tree trunk
-    glm::mat4 trunkMtx = tree.modelMatrix;
-    trunkMtx = glm::scale(trunkMtx, glm::vec3(0.3f, 3.0f, 0.3f));
-    _computeAndSendMatrixUniforms(trunkMtx, viewMtx, projMtx);
-    _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.materialColor, tree.trunkColor);
-    CSCI441::drawSolidCylinder(tree.trunkThickness, tree.trunkThickness, 1.0f, 20, 20);
-
-    // Drawing the tree leaves (three stacked cones)
-    for(int i = 0; i < 3; i++) {
-        glm::mat4 leavesMtx = tree.modelMatrix;
-        // Moving up for trunk height and cone stack.
-        leavesMtx = glm::translate(leavesMtx, glm::vec3(0.0f, 3.0f + i * 1.1f, 0.0f));
-        // Making smaller cones as we go up.
-        float scale = 2.5f - i * 0.5f;
-        leavesMtx = glm::scale(leavesMtx, glm::vec3(scale, 2.0f, scale));
-        _computeAndSendMatrixUniforms(leavesMtx, viewMtx, projMtx);
-        _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.materialColor, tree.leavesColor);
-        CSCI441::drawSolidCone(1.5f, 1.0f, 20, 20);
+JobSystem::JobHandle MPEngine::_scheduleGrassSway(const GLfloat time) {
+    return _jobSystem.schedule([this, time]() {
+        _jobSystem.parallelFor(_grassField.size(), GRASS_SWAY_GRAIN, [this, time](const std::size_t first, const std::size_t last) {
+            _grassField.sway(time, _swayedGrassInstances.data(), first, last);
+        });
+    });
+}
+
+/**
+ * Job system benchmark
+ * Sways a synthetic field of 512 x 512 clumps with 1 to one thread per core, results on stdout.
+ */
+void MPEngine::benchmarkJobSystem() {
+    GrassField field;
+    for (GLint i = 0; i < 512; i++) {
+        for (GLint j = 0; j < 512; j++) {
+            field.add(glm::vec3(i - 256.0f, 0.0f, j - 256.0f), glm::vec3(1.0f, 1.0f + (i + j) % 7 * 0.1f, 1.0f), glm::vec3(0.2f, 0.6f, 0.2f));
+        }
     }
+    std::vector<InstanceData> instances(field.size());
+    fprintf(stdout, "[INFO]: Swaying %zu grass clumps with the %s kernel\n", field.size(), GrassField::kernelName(field.getKernel()));
+    JobSystem::benchmark(0, field.size(), GRASS_SWAY_GRAIN, 50, [&field, &instances](const std::size_t first, const std::size_t last) {
+        field.sway(1.0f, instances.data(), first, last);
+    });
 }
 
 
 /**
  * Scene Update
+ * Simulates as many fixed steps as the time elapsed since the last update holds, at most
+ * MAX_SIMULATION_STEPS, then hands the state blended between the last two steps to the drawing.
+ * The simulation runs at the same pace and cost whatever the frame rate.
+ * @param frame : Time of the frame, sampled once by the run loop.
+ */
+void MPEngine::_updateScene(const FrameContext& frame) {
+    _simulationLag += frame.deltaTime;
+
+    GLuint steps = 0;
+    while (_simulationLag >= SIMULATION_STEP && steps < MAX_SIMULATION_STEPS) {
+        _simulateStep();
+        _simulationLag -= SIMULATION_STEP;
+        steps++;
+    }
+
+    // Too far behind, the time left is dropped rather than caught up in the next frames.
+    if (steps == MAX_SIMULATION_STEPS) {
+        _simulationLag = std::fmod(_simulationLag, SIMULATION_STEP);
+    }
+
+    // Handing the new state over to the drawing.
+    _publishSnapshot(frame);
+}
+
+/**
+ * Simulation Step
  * This function is where interaction and animation comes to life.
- * User interactions are implemented to allow to move the camera and hero.
- * Constant and moving animation is created based on current time.
+ * User interactions are implemented to allow to move the camera and hero, by a fixed amount per step.
+ * Constant and moving animation is created based on the simulation time.
  */
-void MPEngine::_updateScene() {
+void MPEngine::_simulateStep() {
+
+    // The state before this step, blended with the new one for the drawing.
+    for (HeroData& hero : _heroes) {
+        hero.previousModelTransform = hero.modelTransform;
+    }
+    _previousViewMatrix = _camera->getViewMatrix();
+    _previousFirstPersonViewMatrix = _firstPersonCam->getViewMatrix();
+    _simulationTime += SIMULATION_STEP;
+
+    // The heroes stand still unless they walk during this step.
+    for (HeroData& hero : _heroes) {
+        hero.hero -> setStop(true);
+    }
 
     // ----------------------------- HERO PARAMETERS -----------------------------|
 
     // Current hero being controlled by the player.
     HeroData& currentHero = _heroes[heroIndex];
-    glm::mat4 heroModelMatrix(1.0f);
-
-    heroModelMatrix = glm::translate(heroModelMatrix, currentHero.heroPosition);
-
-    /** Sphere math
-     *  75% of sphere under plane
-     *  intersections: anywhere y = 0
-     *      theta = 0 -> 2pi
-     *      phi = pi/2
-     *  so hill starts when phi = pi/2 and y = 0
-     *  if phi >= pi/2 and y >= 0: character needs to be at angle phi.
-     *  if hero coordinates are:
-     *      (x - WORLD_SIZE * 0.5)^2 + (z - WORLD_SIZE * 0.5) < (WORLD_SIZE * 0.5)^2 :
-     *          direction vector: <x - WORLD_SIZE*0.5, y - WORLD_SIZE*0.25, z - WORLD_SIZE*0.5>
-     *          change y elevation
-     * 
-     * 
-     *  Method pieced together from a unity forum combined with multiple stackoverflow threads
-     *  because I could not for the life of me get the rotation to work with pitch and yaw:
-     *       Rotate hero relative to surface of sphere:
-     *          Find vector from center of sphere to hero coordinates (position - center) -- Direction
-     *          Take direction vector of hero
-     *          Find forward vector tangential to the surface of the sphere -- forward - dot(forwars, direction) * direction
-     *          Find right vector -- cross(direction, forward)
-     *          Construct rotation matrix
-     * */ 
-    if(pow((currentHero.heroPosition.x - WORLD_SIZE * 0.5f), 2)
-        + pow((currentHero.heroPosition.z - WORLD_SIZE * 0.5f), 2)
-        < pow(WORLD_SIZE * 0.5f, 2)) {
-
-            currentHero.heroPosition.y = -WORLD_SIZE * 0.25f +
-            sqrt(pow(WORLD_SIZE * 0.5f, 2) -
-                (pow((currentHero.heroPosition.x - WORLD_SIZE * 0.5f), 2) +
-                pow((currentHero.heroPosition.z - WORLD_SIZE * 0.5f), 2)));
-            if(currentHero.heroPosition.y < 0.0f){
-                currentHero.heroPosition.y = 0.0f;
-            }
-            if(currentHero.heroPosition.y > 0.0f){
-                glm::vec3 up = glm::vec3(currentHero.heroPosition.x - WORLD_SIZE * 0.5f,
-                                                currentHero.heroPosition.y + WORLD_SIZE * 0.25f,
-                                                currentHero.heroPosition.z - WORLD_SIZE * 0.5f);
-                up = glm::normalize(up);
-                
-                glm::vec3 forwardVec = glm::vec3(sin(currentHero.heroYaw), 0.0f, cos(currentHero.heroYaw));
-                glm::vec3 tanVec = glm::normalize(forwardVec - glm::dot(forwardVec, up) * up);
-                glm::vec3 rightVec = glm::normalize(glm::cross(up, tanVec));
-
-                glm::mat4 rotationMat = glm::mat4(glm::vec4(rightVec, 0.0f),
-                                                glm::vec4(up, 0.0f),
-                                                glm::vec4(tanVec, 0.0f),
-                                                glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
-                
-                heroModelMatrix = heroModelMatrix * rotationMat;
-            }
-            else{
-                // Rotating our model in the Y-axis by the hero yaw (theta) in the arc-ball camera.
-                heroModelMatrix = glm::rotate(heroModelMatrix, currentHero.heroYaw, CSCI441::Y_AXIS );
 
-                // Rotating our model in the X-axis by the hero pitch (phi) in the arc-ball camera.
-                heroModelMatrix = glm::rotate(heroModelMatrix, currentHero.heroPitch, CSCI441::X_AXIS );
-                }
+    /** Terrain placement
+     *  The hero stands on the terrain, a lookup in the heightfield whatever the number of hills.
+     *  On a slope, the hero is rotated relative to the surface:
+     *      Take the terrain normal under the hero -- up
+     *      Take direction vector of hero
+     *      Find forward vector tangential to the surface -- forward - dot(forward, up) * up
+     *      Find right vector -- cross(up, forward)
+     *      Construct rotation matrix
+     * */
+    currentHero.heroPosition.y = _terrain.heightAt(currentHero.heroPosition.x, currentHero.heroPosition.z);
+    AffineTransform heroModelTransform = AffineTransform().translate(currentHero.heroPosition);
+
+    const glm::vec3 up = _terrain.normalAt(currentHero.heroPosition.x, currentHero.heroPosition.z);
+    if (up.y < 0.999f) {
+        glm::vec3 forwardVec = glm::vec3(sin(currentHero.heroYaw), 0.0f, cos(currentHero.heroYaw));
+        glm::vec3 tanVec = glm::normalize(forwardVec - glm::dot(forwardVec, up) * up);
+        glm::vec3 rightVec = glm::normalize(glm::cross(up, tanVec));
+
+        AffineTransform rotationTransform(glm::mat3(rightVec, up, tanVec), glm::vec3(0.0f));
+
+        heroModelTransform = heroModelTransform * rotationTransform;
     }
-    else{
-    // Rotating our model in the Y-axis by the hero yaw (theta) in the arc-ball camera.
-    heroModelMatrix = glm::rotate(heroModelMatrix, currentHero.heroYaw, CSCI441::Y_AXIS );
+    else {
+        // Rotating our model in the Y-axis by the hero yaw (theta) in the arc-ball camera.
+        heroModelTransform = heroModelTransform.rotate(currentHero.heroYaw, CSCI441::Y_AXIS );
 
-    // Rotating our model in the X-axis by the hero pitch (phi) in the arc-ball camera.
-    heroModelMatrix = glm::rotate(heroModelMatrix, currentHero.heroPitch, CSCI441::X_AXIS );
+        // Rotating our model in the X-axis by the hero pitch (phi) in the arc-ball camera.
+        heroModelTransform = heroModelTransform.rotate(currentHero.heroPitch, CSCI441::X_AXIS );
     }
 
 
     // Scaling our model to make it bigger.
-    heroModelMatrix = glm::scale(heroModelMatrix, glm::vec3(5.0f));
+    heroModelTransform = heroModelTransform.scale(glm::vec3(5.0f));
 
-    // Setting the new model matrix each frame.
-    currentHero.modelMatrix = heroModelMatrix;
-    _heroes[heroIndex] = currentHero;
+    // Setting the new transform each frame, the scene graph only computes it again when it changed.
+    currentHero.modelTransform = heroModelTransform;
 
 
     // ----------------------------- CAMERA CONTROLS -----------------------------|
@@ -954,12 +1669,12 @@ void MPEngine::_updateScene() {
     // Press W / up-arrow : Move forward and walk :)
     if( _keys[GLFW_KEY_W] || _keys[GLFW_KEY_UP] ) {
         _heroes[heroIndex].heroPosition += forward * 0.2f;
-        _walk();
+        _walk(_simulationTime);
     }
     // Press S / down-arrow : Move backward and walk, almost like moon-walking :o
     if( _keys[GLFW_KEY_S] || _keys[GLFW_KEY_DOWN] ) {
         _heroes[heroIndex].heroPosition -= forward * 0.2f;
-        _walk();
+        _walk(_simulationTime);
     }
     // Press A / left-arrow : Turn left
     if( _keys[GLFW_KEY_A] || _keys[GLFW_KEY_LEFT] ) {
@@ -974,24 +1689,14 @@ void MPEngine::_updateScene() {
     // [[[[[[[[[[[[[[[[[[[[[[[[[[[[[[ CONSTANT ANIMATIONS ]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]
 
     // [----------- blinking eyes ;-) -----------]
-    // All heroes in the world blink.
-    for(int i = 0 ; i < _heroes.size() ; i++) {
-        _blink(_heroes[i]);
-    }
-
-    // [----------- grass swaying -----------]
-    swayGrass();
-
-
-    glm::vec3 spotlightPosition = {_heroes[heroIndex].heroPosition.x,
-                                   _heroes[heroIndex].heroPosition.y + 10.0,
-                                   _heroes[heroIndex].heroPosition.z};
-    // Setting the spotlight above the hero position.
-    glProgramUniform3fv(_lightingShaderProgram->getShaderProgramHandle(),
-                        _lightingShaderUniformLocations.spot_lightPosition,
-                        1,
-                        glm::value_ptr(spotlightPosition));
+    // All heroes in the world blink, each one as a job.
+    _jobSystem.parallelFor(_heroes.size(), 1, [this](const std::size_t first, const std::size_t last) {
+        for (std::size_t i = first; i < last; i++) {
+            _blink(_heroes[i], _simulationTime);
+        }
+    });
 
+    // The grass sways in the vertex shader, using the time of the frame block.
 
     // Bound checking the hero position.
     _heroes[heroIndex].heroPosition.x = glm::clamp(_heroes[heroIndex].heroPosition.x, -WORLD_SIZE, WORLD_SIZE);
@@ -1002,6 +1707,40 @@ void MPEngine::_updateScene() {
         _arcballCam->setTarget(_heroes[heroIndex].heroPosition);
         _arcballCam->recomputeOrientation();
     }
+
+    // After a change of camera or hero, the cameras jump to it during this step.
+    if (_viewCut) {
+        _previousViewMatrix = _camera->getViewMatrix();
+        _previousFirstPersonViewMatrix = _firstPersonCam->getViewMatrix();
+        _viewCut = false;
+    }
+}
+
+/**
+ * Snapshot publication
+ * Copies the cameras, hero transforms, spotlight and time into the snapshot not being drawn. The simulation
+ * only writes that snapshot, and the drawing only reads the other one, so they never share state.
+ * The cameras, heroes and time are blended between the last two steps, by how far the frame is into the next one.
+ * @param frame : Time of the frame, sampled once by the run loop.
+ */
+void MPEngine::_publishSnapshot(const FrameContext& frame) {
+    FrameSnapshot& snapshot = _snapshots[1 - _renderedSnapshot];
+    const GLfloat blend = static_cast<GLfloat>(_simulationLag / SIMULATION_STEP);
+
+    snapshot.viewMatrix = AffineTransform::interpolate(AffineTransform(_previousViewMatrix), AffineTransform(_camera->getViewMatrix()), blend).toMat4();
+    snapshot.projectionMatrix = _camera->getProjectionMatrix();
+    snapshot.firstPersonViewMatrix = AffineTransform::interpolate(AffineTransform(_previousFirstPersonViewMatrix), AffineTransform(_firstPersonCam->getViewMatrix()), blend).toMat4();
+    snapshot.firstPersonProjectionMatrix = _firstPersonCam->getProjectionMatrix();
+    snapshot.heroTransforms.resize(_heroes.size());
+    for (std::size_t i = 0; i < _heroes.size(); i++) {
+        snapshot.heroTransforms[i] = AffineTransform::interpolate(_heroes[i].previousModelTransform, _heroes[i].modelTransform, blend);
+    }
+    snapshot.heroIndex = heroIndex;
+
+    // Spotlight above the hero being controlled.
+    snapshot.spotlightPosition = _heroes[heroIndex].heroPosition + glm::vec3(0.0f, 10.0f, 0.0f);
+    snapshot.frame.time = _simulationTime + (blend - 1.0) * SIMULATION_STEP;
+    snapshot.frame.deltaTime = frame.deltaTime;
 }
 
 /**
@@ -1022,6 +1761,8 @@ void MPEngine::changeHero() {
     // Setting the new hero and position.
     _hero = &_heroes[heroIndex];
     _heroes[heroIndex].heroPosition = _hero->heroPosition;
+
+    _cutInterpolation();
 }
 
 /**
@@ -1033,14 +1774,29 @@ void MPEngine::changeCamera() {
         _camera = _freeCam;
     else
         _camera = _arcballCam;
+
+    _cutInterpolation();
+}
+
+/**
+ * Interpolation cut
+ * Blending the views of two unrelated cameras, or the first-person view of two heroes, would sweep across
+ * the world. The frames until the next step show the current state as it is, and that step is not blended.
+ */
+void MPEngine::_cutInterpolation() {
+    _previousViewMatrix = _camera->getViewMatrix();
+    _previousFirstPersonViewMatrix = _firstPersonCam->getViewMatrix();
+    _hero->previousModelTransform = _hero->modelTransform;
+    _viewCut = true;
 }
 
 /**
  * Blinking animation
  * Using the current time and last time blinked, sets the blink flag to change the hero rendering.
+ * @param h : Hero blinking.
+ * @param currentTime : Simulation time.
  */
-void MPEngine::_blink(HeroData& h) {
-    double currentTime = glfwGetTime();
+void MPEngine::_blink(HeroData& h, const double currentTime) {
 
     // Blink eyes every 3 seconds
     if (!h.hero -> getBlink() && currentTime - h.lastBlinkTime > 3.0) {
@@ -1057,29 +1813,6 @@ void MPEngine::_blink(HeroData& h) {
     }
 }
 
-void MPEngine::swayGrass() {
-    float time = glfwGetTime();
-    for (GrassData& g : _grass) {
-        // Grass oscillating angle using a sine wave.
-        float angle = sin(time * 2.0f + g.baseMatrix[3].x + g.baseMatrix[3].z) * 5.0f;
-
-        // Sway matrix that pivots around the bottom.
-        glm::mat4 sway(1.0f);
-
-        // Translating down so the base is at the origin.
-        sway = glm::translate(sway, glm::vec3(0.0f, -1.0f, 0.0f)); // adjust -0.5f to match your blade height
-
-        // Rotating the grass by the angle.
-        sway = glm::rotate(sway, glm::radians(angle), glm::vec3(0,0,1));
-
-        // Translating back up.
-        sway = glm::translate(sway, glm::vec3(0.0f, 1.0f, 0.0f));
-
-        // Updating the model matrix with the animation.
-        g.modelMatrix = g.baseMatrix * sway;
-    }
-}
-
 /**
  * Walking animation
  * Using booleans and time, changes the hero legs position each 0.3 seconds,
@@ -1087,9 +1820,9 @@ void MPEngine::swayGrass() {
  * Stop : when the hero is not moving
  * Walk-left : to move hero's left leg.
  * Walk-right : to move hero's right leg.
+ * @param currentTime : Simulation time.
  */
-void MPEngine::_walk() {
-    double currentTime = glfwGetTime();
+void MPEngine::_walk(const double currentTime) {
     _hero->hero -> setStop(false);
 
     if (!_hero->hero -> getWalkLeft() && currentTime - lastWalkTime > 0.3) {
@@ -1108,12 +1841,28 @@ void MPEngine::_walk() {
 /**
  * Running Drawing LOOP
  * Executing loop that performs the rendering and update of all this program.
+ * Each frame is drawn from the snapshot of the last update. While pipelined, the next update runs
+ * on a worker as soon as the frame is prepared, so a frame takes about the longest of the update
+ * and the drawing instead of both.
  */
 void MPEngine::run() {
+    // The first step is simulated before any frame is drawn.
+    FrameContext frame;
+    frame.time = glfwGetTime();
+    frame.deltaTime = SIMULATION_STEP;
+    _updateScene(frame);
+    _renderedSnapshot = 1 - _renderedSnapshot;
+
     //  This is our draw loop - all rendering is done here.  We use a loop to keep the window open
     //	until the user decides to close the window and quit the program.  Without a loop, the
     //	window will display once and then the program exits.
     while( !glfwWindowShouldClose(mpWindow) ) {	                // Checking if the window was instructed to be closed
+        // Sampling the clock once, every system of this frame gets the same time.
+        const double now = glfwGetTime();
+        frame.deltaTime = now - frame.time;
+        frame.time = now;
+
+        _streamBuffer.beginFrame();                             // Waiting for the GPU to release this frame's region
         glDrawBuffer( GL_BACK );				                // Working with our back frame buffer
         glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );	// Clearing the current color contents and depth buffer in the window
 
@@ -1126,36 +1875,43 @@ void MPEngine::run() {
         // Updating the viewport - Telling OpenGL we want to render to the whole window.
         glViewport( 0, 0, framebufferWidth, framebufferHeight );
 
+        // Everything that does not depend on the camera, computed once for every view.
+        const FrameSnapshot& snapshot = _snapshots[_renderedSnapshot];
+        _prepareFrame(snapshot);
+
+        // Simulating the next frame into the other snapshot while this one is drawn.
+        const bool pipelined = _pipelineFrames;
+        const JobSystem::JobHandle update = pipelined ? _jobSystem.schedule([this, frame]() { _updateScene(frame); }) : nullptr;
+
         // Drawing everything to the window.
-        _renderScene(_camera->getViewMatrix(), _camera->getProjectionMatrix());
+        _renderView(snapshot.viewMatrix, snapshot.projectionMatrix, MAIN_VIEW, snapshot.frame);
 
         if (_enableFPC) {
-            // Updating the viewport for the picture-in-picture first person camera.
+            // Picture-in-picture area, in the bottom right corner of the window.
             int pipWidth  = framebufferWidth / 4;
             int pipHeight = framebufferHeight / 4;
             int pipX = framebufferWidth - pipWidth - 10;
             int pipY = 10;
-            glViewport(pipX, pipY, pipWidth, pipHeight);
 
-            // Clear the depth buffer just at the PiP location
-            glEnable(GL_SCISSOR_TEST);
-            
-            glScissor(pipX, pipY, pipWidth, pipHeight); // Set the scissor rectangle
+            // Rendering the first person view offscreen, only when it is due.
+            _updatePictureInPicture(pipWidth, pipHeight, snapshot);
 
-            // ASSUMING glDepthMask(GL_TRUE); has been restored any time it was disabled
-            glClear(GL_DEPTH_BUFFER_BIT); // Clear only the depth buffer in that region
-            
-            glDisable(GL_SCISSOR_TEST);
-
-            // Drawing everything to the small window, except the hero being controlled.
-            _firstPersonView = true;
-            _renderScene(_firstPersonCam->getViewMatrix(), _firstPersonCam->getProjectionMatrix());
+            // Showing the last render in the small window.
+            glViewport(pipX, pipY, pipWidth, pipHeight);
+            _compositePictureInPicture();
         }
-        // Flag to hide the controlled hero on the first-person viewport.
-        _firstPersonView = false;
+        _renderQueue.clear();
+        _reportCulling(frame);
 
-        _updateScene();
+        // The next frame is drawn from the snapshot just simulated.
+        if (pipelined) {
+            _jobSystem.wait(update);
+        } else {
+            _updateScene(frame);
+        }
+        _renderedSnapshot = 1 - _renderedSnapshot;
 
+        _streamBuffer.endFrame();                               // Fencing what this frame wrote
         glfwSwapBuffers(mpWindow);      // flush the OpenGL commands and make sure they get rendered!
         glfwPollEvents();               // check for any events and signal to redraw screen
     }
@@ -1249,7 +2005,7 @@ void MPEngine::_drawSkybox(const glm::mat4& viewMtx, const glm::mat4& projMtx) c
     glm::mat4 V = glm::mat4(glm::mat3(viewMtx));
     glm::mat4 VP = projMtx*V;
 
-    // Depth state for skybox
+    // Depth state for skybox, drawn last at the far plane where the cleared depth is left
     glDepthFunc(GL_LEQUAL);
     glDepthMask(GL_FALSE);
 
@@ -1267,33 +2023,96 @@ void MPEngine::_drawSkybox(const glm::mat4& viewMtx, const glm::mat4& projMtx) c
     glDepthMask(GL_TRUE);
 }
 
+/**
+ * Picture-in-picture update
+ * Renders the first person view into its offscreen target, at a fraction of its size on screen,
+ * when the current update rate says so. Otherwise the last render is shown again.
+ * @param width : Width of the picture-in-picture on screen.
+ * @param height : Height of the picture-in-picture on screen.
+ * @param snapshot : State of the frame being drawn.
+ */
+void MPEngine::_updatePictureInPicture(const GLsizei width, const GLsizei height, const FrameSnapshot& snapshot) {
+    const GLsizei targetWidth = std::max(1, static_cast<GLsizei>(width * PIP_RESOLUTION_SCALE));
+    const GLsizei targetHeight = std::max(1, static_cast<GLsizei>(height * PIP_RESOLUTION_SCALE));
+    if (_pipTarget.resize(targetWidth, targetHeight)) {
+        _pipDirty = true;
+    }
+
+    const glm::mat4& viewMtx = snapshot.firstPersonViewMatrix;
+    _pipFramesSinceUpdate++;
+
+    bool due = _pipDirty;
+    switch (_pipUpdateRate) {
+        case PIP_EVERY_FRAME:       due = true; break;
+        case PIP_EVERY_OTHER_FRAME: due = due || _pipFramesSinceUpdate >= 2; break;
+        case PIP_WHEN_MOVED:        due = due || viewMtx != _pipViewMatrix; break;
+        default: break;
+    }
+    if (!due) return;
+
+    // Drawing everything to the target, except the hero being controlled.
+    _pipTarget.bind();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    _renderView(viewMtx, snapshot.firstPersonProjectionMatrix, FIRST_PERSON_VIEW, snapshot.frame);
+    RenderTarget::unbind();
+
+    _pipViewMatrix = viewMtx;
+    _pipFramesSinceUpdate = 0;
+    _pipDirty = false;
+}
+
+/**
+ * Picture-in-picture compositing
+ * Draws the picture-in-picture target over the current viewport with a single textured quad.
+ */
+void MPEngine::_compositePictureInPicture() const {
+    // Always on top of the main view.
+    glDisable(GL_DEPTH_TEST);
+
+    _pipProg->useProgram();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, _pipTarget.getColorTexture());
+    _pipProg->setProgramUniform(_pipImageLocation, 0);
+
+    glBindVertexArray(_pipVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    glEnable(GL_DEPTH_TEST);
+}
+
 //**********************************************************************************
 //============================ Private Helper Functions ============================
 //**********************************************************************************
 
 /**
- * Matrix uniforms maker
- * Precomputes the MVP matrix, normal matrix, camera position and model matrix and sends them to the shader.
- * @param modelMtx : Current model matrix to compute the MVP matrix.
- * @param viewMtx : Current view matrix to compute the MVP matrix.
- * @param projMtx : Current projection matrix to compute the MVP matrix.
+ * Frame data sender
+ * Streams the frame block once per view: view-projection matrix, camera position and time.
+ * @param viewMtx : Current view matrix.
+ * @param projMtx : Current projection matrix.
+ * @param frame : Time of the frame being drawn.
  */
-void MPEngine::_computeAndSendMatrixUniforms(const glm::mat4& modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
-    // Precomputing and sending the MVP matrix.
-    const glm::mat4 mvpMtx = projMtx * viewMtx * modelMtx;
-    _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.mvpMatrix, mvpMtx);
-
-    // Precomputing and sending the normal matrix.
-    glm::mat3 normalMatrix = glm::mat3( glm::transpose( glm::inverse(modelMtx) ) );
-    _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.normalMatrix, normalMatrix);
+void MPEngine::_sendFrameData(const glm::mat4& viewMtx, const glm::mat4& projMtx, const FrameContext& frame) {
+    FrameBlock frameBlock;
+    frameBlock.viewProjectionMatrix = projMtx * viewMtx;
 
-    // Precomputing and sending the arc-ball camera position.
-    glm::vec3 cameraPosition = _camera->getPosition();
-    _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.cameraPosition, cameraPosition);
+    // The camera of the view being drawn, so the picture-in-picture gets its own speculars.
+    frameBlock.cameraPosition = AffineTransform(viewMtx).inverse().getTranslation();
 
-    // Sending the model matrix.
-    _lightingShaderProgram->setProgramUniform(_lightingShaderUniformLocations.modelMatrix, modelMtx);
+    frameBlock.time = static_cast<GLfloat>( frame.time );
+    _streamBuffer.bindUniformBlock(FRAME_BLOCK_BINDING, frameBlock);
+}
 
+/**
+ * Hero uniform locations
+ * Gathers the lighting shader uniform locations the heroes need to draw their baked mesh.
+ * @return the hero uniform locations.
+ */
+HeroUniformLocations MPEngine::_heroUniformLocations() const {
+    return {
+        _lightingShaderUniformLocations.useVertexColor,
+        _lightingShaderUniformLocations.usePartPalette,
+        _lightingShaderUniformLocations.partPalette
+    };
 }
 
 //*****************************************************************************
@@ -12,6 +12,22 @@
 #include "heroes/Daglas.h"
 #include "heroes/Paco.h"
 #include "heroes/Darrow.h"
+#include "engine/AffineTransform.h"
+#include "engine/FrameContext.h"
+#include "engine/GrassField.h"
+#include "engine/Heightfield.h"
+#include "engine/ImpostorAtlas.h"
+#include "engine/JobSystem.h"
+#include "engine/LevelOfDetail.h"
+#include "engine/Mesh.h"
+#include "engine/OcclusionBuffer.h"
+#include "engine/StaticBatch.h"
+#include "engine/RenderQueue.h"
+#include "engine/RenderTarget.h"
+#include "engine/SceneGraph.h"
+#include "engine/SpatialGrid.h"
+#include "engine/StreamBuffer.h"
+#include "engine/UniformBuffer.h"
 
 #include <vector>
 
@@ -60,6 +76,9 @@ public:
 
     const int NUMBER_OF_HEROES = 4;
 
+    // Job system scaling benchmark on a synthetic grass field, needs no window
+    static void benchmarkJobSystem();
+
 private:
 
     // ----- Setup functions -----
@@ -74,11 +93,95 @@ private:
     void mCleanupBuffers() override;
     void mCleanupShaders() override;
 
-    // Scene rendering
-    void _renderScene(const glm::mat4& viewMtx, const glm::mat4& projMtx) const;
+    /// Views drawn every frame, one bit each in the render queue view masks.
+    enum SceneView : GLuint {
+        /// Arc-ball or free camera, whole window.
+        MAIN_VIEW = 0,
+        /// First-person picture-in-picture.
+        FIRST_PERSON_VIEW
+    };
+
+    /**
+     * Frame Snapshot
+     * Everything the simulation hands over to the drawing of a frame, never changed once published,
+     * so the next frame can be simulated while this one is drawn.
+     */
+    struct FrameSnapshot {
+        /// View and projection matrices of the main camera.
+        glm::mat4 viewMatrix{1.0f}, projectionMatrix{1.0f};
+        /// View and projection matrices of the first-person camera.
+        glm::mat4 firstPersonViewMatrix{1.0f}, firstPersonProjectionMatrix{1.0f};
+        /// Transform of every hero relative to the world, in the order of the list of heroes.
+        std::vector<AffineTransform> heroTransforms;
+        /// Hero being controlled, hidden from the first-person view.
+        GLint heroIndex = 0;
+        /// Position of the spotlight above the hero being controlled.
+        glm::vec3 spotlightPosition{0.0f};
+        /// Time of the frame, the interpolated simulation time, for the grass sway and the hero parts.
+        FrameContext frame;
+    };
+
+    /// Snapshots written by the simulation in turns, one being drawn while the other is simulated.
+    FrameSnapshot _snapshots[2];
+
+    /// Snapshot drawn this frame, the other one receives the next simulation.
+    GLuint _renderedSnapshot = 0;
+
+    /// Pipelining flag, toggled with M. The next frame is simulated on a worker while this one is drawn.
+    bool _pipelineFrames = true;
+
+    // Publishes the simulated state into the snapshot not being drawn
+    void _publishSnapshot(const FrameContext& frame);
+
+    // Frame preparation, everything that does not depend on the view
+    void _prepareFrame(const FrameSnapshot& snapshot);
+
+    // View rendering, from the prepared frame
+    void _renderView(const glm::mat4& viewMtx, const glm::mat4& projMtx, SceneView view, const FrameContext& frame);
+
+    /// Packets outside the frustum in the last render of each view.
+    GLsizei _culledCounts[2] = {0, 0};
+
+    /// Packets hidden by the occluders in the last render of each view.
+    GLsizei _occludedCounts[2] = {0, 0};
+
+    /// Packets and hero details too small on screen in the last render of each view.
+    GLsizei _smallCounts[2] = {0, 0};
+
+    /// Smallest radius on screen, in pixels, of the objects and hero details drawn, changed with - and =.
+    GLfloat _contributionThreshold = 1.0f;
+
+    /// Time the culling counters were last shown.
+    double _lastCullingReportTime = 0.0;
 
-    // Scene update (animation and interaction)
-    void _updateScene();
+    // Shows the culling counters in the window title, twice per second
+    void _reportCulling(const FrameContext& frame);
+
+    // Scene update, as many fixed steps as the elapsed time holds
+    void _updateScene(const FrameContext& frame);
+
+    // ========================= FIXED TIMESTEP =========================
+
+    /// Duration of a simulation step, in seconds. The hero and camera speeds are given per step.
+    static constexpr double SIMULATION_STEP = 1.0 / 60.0;
+
+    /// Most steps simulated per update, the time beyond is dropped so a slow frame cannot snowball.
+    static constexpr GLuint MAX_SIMULATION_STEPS = 5;
+
+    /// Time simulated so far, a whole number of steps from zero whatever the frame rate.
+    double _simulationTime = 0.0;
+
+    /// Time elapsed but not simulated yet, less than a step after each update.
+    double _simulationLag = 0.0;
+
+    /// View matrices of the cameras before the last step, blended with the current ones for the drawing.
+    glm::mat4 _previousViewMatrix{1.0f}, _previousFirstPersonViewMatrix{1.0f};
+
+    /// Set by a change of camera or hero, the next step moves the cameras without blending them.
+    bool _viewCut = false;
+
+    // Single simulation step (animation and interaction)
+    void _simulateStep();
 
     /// Number of different keys that can be present as determined by GLFW
     static constexpr GLuint NUM_KEYS = GLFW_KEY_LAST;
@@ -117,8 +220,146 @@ private:
     /// First person camera enabling flag
     bool _enableFPC;
 
-    /// First-person viewport render flag
-    bool _firstPersonView;
+    // ========================= PICTURE-IN-PICTURE =========================
+
+    /// How often the first-person picture-in-picture is rendered again.
+    enum PipUpdateRate : GLuint {
+        PIP_EVERY_FRAME = 0,
+        PIP_EVERY_OTHER_FRAME,
+        /// Only when the first-person camera moved, the rest of the scene freezes in the PiP.
+        PIP_WHEN_MOVED,
+        PIP_UPDATE_RATE_COUNT
+    };
+
+    /// Resolution of the PiP target relative to its area on screen.
+    static constexpr GLfloat PIP_RESOLUTION_SCALE = 0.5f;
+
+    /// Current PiP update rate, cycled with B.
+    PipUpdateRate _pipUpdateRate = PIP_EVERY_OTHER_FRAME;
+
+    /// Offscreen target the PiP is rendered into.
+    RenderTarget _pipTarget;
+
+    /// Shader drawing the PiP target as a textured quad.
+    CSCI441::ShaderProgram* _pipProg = nullptr;
+    /// Location of the PiP texture sampler.
+    GLint _pipImageLocation = -1;
+    /// Empty VAO, the quad is built in the vertex shader.
+    GLuint _pipVAO = 0;
+
+    /// Frames since the PiP target was last rendered.
+    GLuint _pipFramesSinceUpdate = 0;
+    /// View matrix of the last PiP render, to know if the camera moved.
+    glm::mat4 _pipViewMatrix{0.0f};
+    /// True when the target content is outdated whatever the rate (just enabled, resized).
+    bool _pipDirty = true;
+
+    // Renders the PiP into its target from the first-person camera of the snapshot, if it is due this frame
+    void _updatePictureInPicture(GLsizei width, GLsizei height, const FrameSnapshot& snapshot);
+
+    // Draws the PiP target in the current viewport
+    void _compositePictureInPicture() const;
+
+    // ========================= OCCLUSION CULLING =========================
+
+    /// Resolution of the occluder depth, whatever the size of the view.
+    static constexpr GLsizei OCCLUSION_WIDTH = 256;
+    static constexpr GLsizei OCCLUSION_HEIGHT = 128;
+
+    /// Occlusion culling flag, toggled with O.
+    bool _enableOcclusion = true;
+
+    /// Depth pyramid of the occluders of the view being drawn.
+    OcclusionBuffer _occlusionBuffer;
+
+    /// Ground, hill and coarsest trees merged in world space, positions only matter.
+    StaticBatch _occluderBatch;
+
+    /// Depth-only shader of the occluders.
+    CSCI441::ShaderProgram* _occluderProg = nullptr;
+    /// Location of the occluder view-projection matrix.
+    GLint _occluderViewProjectionLocation = -1;
+
+    // Occluder batch creation, once the trees are generated
+    void _createOccluderBatch();
+
+    // Draws the occluders of a view and builds its depth pyramid
+    void _renderOccluders(const glm::mat4& viewProjectionMtx);
+
+    // ========================= GPU CULLING =========================
+
+    /// GPU culling flag, toggled with G when the context supports it (OpenGL 4.3+).
+    bool _enableGpuCulling = false;
+
+    /// Compute program culling the grass and tree groups, 0 when not supported.
+    GLuint _cullProgramHandle = 0;
+
+    /// Grass clumps culled on the GPU.
+    RenderQueue::GroupHandle _grassGroup = 0;
+
+    /// Tree trunks culled on the GPU.
+    RenderQueue::GroupHandle _trunkGroup = 0;
+
+    /// Tree leaf tiers culled on the GPU.
+    RenderQueue::GroupHandle _leavesGroup = 0;
+
+    // Culling program and groups creation, when the context supports them
+    void _setupGpuCulling();
+
+    // ========================= TREE IMPOSTORS =========================
+
+    /// Impostor flag, toggled with I.
+    bool _enableImpostors = true;
+
+    /// Trees further than this from every camera are drawn as a card, changed with [ and ].
+    GLfloat _impostorDistance = 80.0f;
+    /// Change of the impostor distance per key press.
+    static constexpr GLfloat IMPOSTOR_DISTANCE_STEP = 10.0f;
+
+    /// Tree variants baked, by height and by trunk thickness.
+    static constexpr GLuint IMPOSTOR_HEIGHT_BUCKETS = 4;
+    static constexpr GLuint IMPOSTOR_THICKNESS_BUCKETS = 2;
+
+    /// Size of an atlas frame in pixels, and number of frames along each side of the grid.
+    static constexpr GLsizei IMPOSTOR_FRAME_SIZE = 64;
+    static constexpr GLuint IMPOSTOR_FRAMES_PER_SIDE = 8;
+
+    /// Value of the tree levels while they are drawn as impostors.
+    static constexpr GLubyte IMPOSTOR_LEVEL = 0xFF;
+
+    /// Pictures of every tree variant.
+    ImpostorAtlas _impostorAtlas;
+
+    /// Shader drawing the impostor cards.
+    CSCI441::ShaderProgram* _impostorProg = nullptr;
+    /// Locations of the atlas samplers and grid size.
+    GLint _impostorAlbedoLocation = -1;
+    GLint _impostorNormalLocation = -1;
+    GLint _impostorFramesPerSideLocation = -1;
+
+    /// Shader baking the tree variants into the atlas.
+    CSCI441::ShaderProgram* _impostorBakeProg = nullptr;
+    /// Location of the bake view-projection matrix.
+    GLint _impostorBakeViewProjectionLocation = -1;
+
+    /// Card mesh in the render queue.
+    RenderQueue::MeshHandle _impostorMesh;
+
+    /// Render queue state of the impostor cards.
+    RenderQueue::StateHandle _impostorState;
+
+    /**
+     * Card of every tree. The InstanceData layout is reused: the model matrix moves and scales the
+     * card, the color is the trunk color, and the first two columns of the normal matrix carry the
+     * leaves color and the atlas layer.
+     */
+    std::vector<InstanceData> _impostorInstances;
+
+    /// World space bounds of every card.
+    std::vector<BoundingSphere> _impostorBounds;
+
+    // Tree variants baking and cards creation, once the trees are generated
+    void _createTreeImpostors();
 
     /// OUR HERO Models
     Hero* _daglas;
@@ -129,7 +370,8 @@ private:
     CSCI441::ModelLoader* _pModel;
     GLuint _objectIndex;
 
-    /// Information for each hero
+    /// Information for each hero. The update only writes the position, yaw, transforms and blink time,
+    /// the other fields are read by the drawing while the next frame is simulated.
     struct HeroData {
         // The hero class instance.
         Hero* hero;
@@ -139,12 +381,23 @@ private:
         GLfloat heroYaw = 0.0f;
         // Current hero pitch along the Y-axis.
         GLfloat heroPitch = 0.0f;
-        // Model matrix of hero with all transformations.
-        glm::mat4 modelMatrix;
+        // Scene graph node holding the transform of the hero with all transformations.
+        SceneGraph::NodeHandle node;
         // Time since last time hero blinked.
         double lastBlinkTime;
+        // Transform of the hero with all transformations, set by the simulation and published with the snapshot.
+        AffineTransform modelTransform{};
+        // Transform of the hero before the last simulation step.
+        AffineTransform previousModelTransform{};
+        // World space bounds of the hero, computed again only when its node moves.
+        BoundingSphere worldBounds{glm::vec3(0.0f), 0.0f};
+        // World space bounds of the facial details of the hero.
+        BoundingSphere worldDetailBounds{glm::vec3(0.0f), 0.0f};
     };
 
+    /// Transforms of the heroes, their world matrices only computed again when they move.
+    SceneGraph _sceneGraph;
+
     /// Current hero being controlled by the player.
     HeroData* _hero;
 
@@ -163,32 +416,54 @@ private:
     // Change the current camera view
     void changeCamera();
 
-    // Blinking animation
-    void _blink(HeroData& hero);
+    // Drops the previous state of the cameras and the controlled hero after a change
+    void _cutInterpolation();
 
-    // Walking animation
-    void _walk();
+    // Blinking animation, at the given simulation time
+    void _blink(HeroData& hero, double time);
 
-    // Grass animation
-    void swayGrass();
+    // Walking animation, at the given simulation time
+    void _walk(double time);
 
     /// Size of the world (controls the ground size and locations of objects)
     static constexpr GLfloat WORLD_SIZE = 100.0f;
 
-    /// VAO for our ground
-    GLuint _groundVAO;
+    /// Static world geometry (ground and hill) merged in world space.
+    StaticBatch _staticBatch;
+
+    /// Ground and hill as a grid of heights, where the heroes, grass and trees stand.
+    Heightfield _terrain;
+
+    /// Cells along each side of the terrain.
+    static constexpr GLuint TERRAIN_CELLS = 128;
+
+    // Terrain generation, the hill raised from the flat ground
+    void _createTerrain();
+
+    /// Number of tessellations generated for the grass, trees and sun.
+    static constexpr GLuint LOD_LEVEL_COUNT = 3;
+
+    /// Base slices and stacks of each level, the finest matching the original meshes.
+    static constexpr GLint LOD_TESSELLATION[LOD_LEVEL_COUNT] = {20, 10, 5};
+
+    /// Picks the level of every object from its size on screen.
+    LodSelector _lodSelector{std::vector<GLfloat>{0.1f, 0.04f}};
 
-    /// Number of points that make up our ground object
-    GLsizei _numGroundPoints;
+    /// Sun and beams merged in world space, apart from the ground so it can be culled on its own, one per level.
+    StaticBatch _sunBatches[LOD_LEVEL_COUNT];
 
-    // Ground buffer creation
-    void _createGroundBuffers();
+    /// Level the sun is drawn with.
+    GLuint _sunLod = 0;
+
+    // Static world batch creation
+    void _createStaticBatch();
+
+    // Ground and hill baking function
+    void _addGroundToBatch(StaticBatch& batch);
 
     /// Grass drawing information
     struct GrassData {
-        /// Fixed position matrix of the grass.
-        glm::mat4 baseMatrix;
-        /// Model matrix to translate and scale the grass.
+        /// Model matrix to translate and scale the grass (the sway is added by the shader).
         glm::mat4 modelMatrix;
         /// Color of the grass.
         glm::vec3 color;
@@ -215,57 +490,173 @@ private:
     // Environment generation
     void _generateEnvironment();
 
+    /// Every draw of a frame goes through this queue, sorted and batched.
+    RenderQueue _renderQueue;
+
+    /// Grass clump mesh in the render queue, one per level.
+    RenderQueue::MeshHandle _grassMeshes[LOD_LEVEL_COUNT];
+
+    /// Tree trunk mesh in the render queue, one per level.
+    RenderQueue::MeshHandle _trunkMeshes[LOD_LEVEL_COUNT];
+
+    /// Tree leaf tier mesh in the render queue, one per level.
+    RenderQueue::MeshHandle _leavesMeshes[LOD_LEVEL_COUNT];
+
+    /// Render queue state of the swaying grass.
+    RenderQueue::StateHandle _grassState;
+
+    /// Render queue state of the trees.
+    RenderQueue::StateHandle _treeState;
+
+    /// Per-clump transform and color of the grass.
+    std::vector<InstanceData> _grassInstances;
+
+    /// Per-tree transform and color of the trunks.
+    std::vector<InstanceData> _trunkInstances;
+
+    /// Per-tier transform and color of the leaves (three per tree).
+    std::vector<InstanceData> _leavesInstances;
+
+    /// World space bounds of every grass clump, in the same order as the instances.
+    std::vector<BoundingSphere> _grassBounds;
+
+    /// World space bounds of every trunk.
+    std::vector<BoundingSphere> _trunkBounds;
+
+    /// World space bounds of every leaf tier.
+    std::vector<BoundingSphere> _leavesBounds;
+
+    /// World space bounds of every whole tree.
+    std::vector<BoundingSphere> _treeBounds;
+
+    /// Level every grass clump is drawn with.
+    std::vector<GLubyte> _grassLods;
+
+    /// Level every tree is drawn with, trunk and leaves alike.
+    std::vector<GLubyte> _treeLods;
+
+    /// Side of the spatial grid cells over the environment.
+    static constexpr GLfloat ENVIRONMENT_CELL_SIZE = 10.0f;
+
+    /// Grass clumps indexed by position.
+    SpatialGrid _grassGrid;
+
+    /// Whole trees (trunk and leaves) indexed by position.
+    SpatialGrid _treeGrid;
+
+    /// Objects returned by the last grid query, kept to reuse its memory.
+    std::vector<GLuint> _queriedObjects;
+
+    // ========================= ENVIRONMENT CHUNKS =========================
+
+    /// Side of the square chunks the grass and trees are merged into.
+    static constexpr GLfloat CHUNK_SIZE = 16.0f;
+
+    /// Chunk flag, toggled with H. The chunks are drawn instead of the grass and tree instances.
+    bool _enableChunks = false;
+
+    /// Grass and trees of a square of the world merged in world space, drawn and culled as a whole.
+    struct EnvironmentChunk {
+        /// Merged geometry, one batch per level of detail.
+        StaticBatch levels[LOD_LEVEL_COUNT];
+        /// Sphere enclosing every object of the chunk.
+        BoundingSphere bounds;
+        /// Level the chunk is drawn with.
+        GLuint lod = 0;
+    };
+
+    /// Chunks holding at least one object, created once and never resized.
+    std::vector<EnvironmentChunk> _chunks;
+
+    // Chunk baking, once the grass and trees are generated
+    void _createEnvironmentChunks();
+
+    // Chunk submission to the render queue, each one a single draw culled by its bounds
+    void submitChunks(const std::vector<LodViewpoint>& viewpoints);
+
+    // ========================= JOBS =========================
+
+    /// Worker threads (one per core, the main thread included) sharing the update and submission loops.
+    JobSystem _jobSystem;
+
+    /// Clumps swayed per job, a few hundred kilobytes of instances.
+    static constexpr std::size_t GRASS_SWAY_GRAIN = 4096;
+
+    /// Objects whose level of detail is selected per job.
+    static constexpr std::size_t LOD_GRAIN = 1024;
+
+    // Sways the grass on the workers, the swayed instances are ready once the job is finished
+    JobSystem::JobHandle _scheduleGrassSway(GLfloat time);
+
+    // ========================= CPU GRASS SWAY =========================
+
+    /// CPU sway flag, toggled with J. The grass is swayed by the CPU instead of the shader.
+    bool _swayGrassOnCpu = false;
+
+    /// Grass clumps as packed arrays, swayed every frame while the CPU sways the grass.
+    GrassField _grassField;
+
+    /// Swayed copy of the grass instances, written by the grass field.
+    std::vector<InstanceData> _swayedGrassInstances;
+
+    // Grass mesh and instances creation
+    void _createGrassBuffers();
+
+    // Grass clump mesh, three blades
+    static MeshData _grassClumpMesh(GLint tessellation);
+
+    // Tree meshes and instances creation
+    void _createTreeBuffers();
+
+    // Trunk placement inside a tree
+    static AffineTransform _trunkTransform(const AffineTransform& treeTransform, float trunkThickness);
+
+    // Leaf tier placement inside a tree
+    static AffineTransform _leavesTransform(const AffineTransform& treeTransform, int tier);
+
+    // Render queue states and buffers creation
+    void _setupRenderQueue();
+
+    // Attribute locations of the lighting shader, used to create the meshes.
+    MeshAttributeLocations _meshAttributeLocations() const;
+
     /// Sun coordinates in our world
     glm::vec3 sunPosition;
 
-    // Sun drawing function
-    void drawSun(const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const;
+    // Sun baking function
+    void _addSunToBatch(StaticBatch& batch, GLint tessellation);
+
+    // Sun beam baking function
+    void _addBeamToBatch(StaticBatch& batch, GLint tessellation, glm::vec3 dirAxis, glm::vec3 rotAxis, float rotAngle);
 
-    void drawBeam(const glm::mat4 &viewMtx, const glm::mat4 &projMtx,
-                  glm::vec3 dirAxis, glm::vec3 rotAxis, float rotAngle) const;
+    // Static world drawing function
+    void drawStaticWorld(const StaticBatch& batch);
 
 
-    // Grass drawing function
-    void drawGrass(glm::vec3 color, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const;
+    // Grass submission to the render queue, only the clumps seen by one of the views
+    void submitGrass(const std::vector<Frustum>& frustums, const std::vector<LodViewpoint>& viewpoints);
 
-    // Tree drawing function
-    void drawTree(const TreeData& tree, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const;
+    // Tree submission to the render queue, only the trees seen by one of the views
+    void submitTrees(const std::vector<Frustum>& frustums, const std::vector<LodViewpoint>& viewpoints);
 
     /// Shader program that performs lighting
     CSCI441::ShaderProgram* _lightingShaderProgram ;   // the wrapper for our shader program
 
     /// Shader program uniform locations
     struct LightingShaderUniformLocations {
-        /// Precomputed MVP matrix location
-        GLint mvpMatrix;
-        /// Model matrix location
-        GLint modelMatrix;
-        /// Normal matrix location
-        GLint normalMatrix;
-
         /// Material diffuse color location
         GLint materialColor;
 
-        /// Directional light direction location
-        GLint dir_lightDirection;
-        /// Directional light color location
-        GLint dir_lightColor;
-
-        /// Point light position location
-        GLint point_lightPosition;
-        /// Point light color location
-        GLint point_lightColor;
-
-        /// Spotlight position location
-        GLint spot_lightPosition;
-        /// Spotlight direction location
-        GLint spot_lightDirection;
-        /// Spotlight color location
-        GLint spot_lightColor;
-
-        /// Camera position location
-        GLint cameraPosition;
-
+        /// Instanced drawing flag location
+        GLint useInstancing;
+        /// Grass sway flag location
+        GLint swayGrass;
+        /// Per-vertex color flag location
+        GLint useVertexColor;
+        /// Part palette flag location
+        GLint usePartPalette;
+        /// Part transform palette location
+        GLint partPalette;
 
     } _lightingShaderUniformLocations;
 
@@ -275,14 +666,39 @@ private:
         GLint vPos;
         /// Vertex normal location
         GLint vertexNormal;
+        /// Instance model matrix location
+        GLint instanceModelMatrix;
+        /// Instance normal matrix location
+        GLint instanceNormalMatrix;
+        /// Instance color location
+        GLint instanceColor;
+        /// Vertex color location
+        GLint vertexColor;
+        /// Vertex part index location
+        GLint partIndex;
 
     } _lightingShaderAttributeLocations;
 
+    /// Ring buffer streaming the FrameData and ObjectData blocks and the render queue per-draw data.
+    StreamBuffer _streamBuffer;
+
+    /// Lights of the scene (LightData block).
+    UniformBuffer _lightUniformBuffer;
+
+    /// CPU copy of the lights, to only upload them when they change.
+    LightBlock _lights;
+
     // Lighting setup
     void _setLightingParameters();
 
-    // Matrix uniform computation and sending to the shader program.
-    void _computeAndSendMatrixUniforms(const glm::mat4& modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const;
+    // Frame data computation and upload, once per view.
+    void _sendFrameData(const glm::mat4& viewMtx, const glm::mat4& projMtx, const FrameContext& frame);
+
+    /// Object block of the geometry already in world space (static batch, instances), streamed once per frame.
+    StreamBuffer::Range _worldObjectRange{};
+
+    // Uniform locations of the lighting shader, used by the heroes.
+    HeroUniformLocations _heroUniformLocations() const;
 
 
     // ========================= SKYBOX ADDITIONS (new) =========================
@@ -0,0 +1,159 @@
+/**
+ * Engine helper class : AffineTransform
+ *
+ * Translation, rotation and scale of an object kept as a 3x4 matrix, cheaper to
+ * compose than a 4x4 one and with a normal matrix that needs no general inverse.
+ */
+
+#include "AffineTransform.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <cmath>
+#include <cstring>
+
+// SSE2 is part of every x86-64 processor.
+#if defined(__x86_64__) || defined(_M_X64)
+#define MP_AFFINE_SIMD
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(AffineTransform) == 12 * sizeof(GLfloat), "AffineTransform must be tightly packed");
+static_assert(sizeof(InstanceData) == 28 * sizeof(GLfloat), "InstanceData must be tightly packed");
+
+
+AffineTransform::AffineTransform() : _linear(1.0f), _translation(0.0f) {}
+
+AffineTransform::AffineTransform(const glm::mat3& linear, const glm::vec3& translation)
+    : _linear(linear), _translation(translation) {}
+
+AffineTransform::AffineTransform(const glm::mat4& modelMtx)
+    : _linear(modelMtx), _translation(modelMtx[3]) {}
+
+AffineTransform AffineTransform::translate(const glm::vec3& offset) const {
+    return {_linear, _linear * offset + _translation};
+}
+
+AffineTransform AffineTransform::rotate(const GLfloat angle, const glm::vec3& axis) const {
+    // Same rotation as glm::rotate, only its 3x3 part.
+    const GLfloat c = std::cos(angle);
+    const GLfloat s = std::sin(angle);
+    const glm::vec3 a = glm::normalize(axis);
+    const glm::vec3 t = a * (1.0f - c);
+    const glm::mat3 rotation(glm::vec3(c + t.x * a.x, t.x * a.y + s * a.z, t.x * a.z - s * a.y),
+                             glm::vec3(t.y * a.x - s * a.z, c + t.y * a.y, t.y * a.z + s * a.x),
+                             glm::vec3(t.z * a.x + s * a.y, t.z * a.y - s * a.x, c + t.z * a.z));
+    return {_linear * rotation, _translation};
+}
+
+AffineTransform AffineTransform::scale(const glm::vec3& factors) const {
+    return {glm::mat3(_linear[0] * factors.x, _linear[1] * factors.y, _linear[2] * factors.z), _translation};
+}
+
+AffineTransform AffineTransform::operator*(const AffineTransform& other) const {
+    return {_linear * other._linear, _linear * other._translation + _translation};
+}
+
+AffineTransform AffineTransform::inverse() const {
+    const glm::mat3 inverseLinear = glm::transpose(normalMatrix());
+    return {inverseLinear, -(inverseLinear * _translation)};
+}
+
+AffineTransform AffineTransform::interpolate(const AffineTransform& from, const AffineTransform& to, const GLfloat t) {
+    // The ends as they are, so a still object keeps its transform bit for bit.
+    if (t <= 0.0f || std::memcmp(&from, &to, sizeof(AffineTransform)) == 0) return from;
+    if (t >= 1.0f) return to;
+
+    // Rotation and scale apart, a blend of two rotation matrices is not a rotation.
+    const glm::vec3 fromScale(glm::length(from._linear[0]), glm::length(from._linear[1]), glm::length(from._linear[2]));
+    const glm::vec3 toScale(glm::length(to._linear[0]), glm::length(to._linear[1]), glm::length(to._linear[2]));
+    const glm::quat fromRotation = glm::quat_cast(glm::mat3(from._linear[0] / fromScale.x, from._linear[1] / fromScale.y, from._linear[2] / fromScale.z));
+    const glm::quat toRotation = glm::quat_cast(glm::mat3(to._linear[0] / toScale.x, to._linear[1] / toScale.y, to._linear[2] / toScale.z));
+
+    const glm::mat3 rotation = glm::mat3_cast(glm::slerp(fromRotation, toRotation, t));
+    const glm::vec3 scale = fromScale + (toScale - fromScale) * t;
+    return {glm::mat3(rotation[0] * scale.x, rotation[1] * scale.y, rotation[2] * scale.z),
+            from._translation + (to._translation - from._translation) * t};
+}
+
+glm::mat4 AffineTransform::toMat4() const {
+    return glm::mat4(glm::vec4(_linear[0], 0.0f), glm::vec4(_linear[1], 0.0f),
+                     glm::vec4(_linear[2], 0.0f), glm::vec4(_translation, 1.0f));
+}
+
+glm::mat3 AffineTransform::normalMatrix() const {
+    // Each column of the inverse transpose is orthogonal to the two other columns of the linear part.
+    const glm::vec3 n0 = glm::cross(_linear[1], _linear[2]);
+    const glm::vec3 n1 = glm::cross(_linear[2], _linear[0]);
+    const glm::vec3 n2 = glm::cross(_linear[0], _linear[1]);
+    const GLfloat inverseDeterminant = 1.0f / glm::dot(_linear[0], n0);
+    return glm::mat3(n0 * inverseDeterminant, n1 * inverseDeterminant, n2 * inverseDeterminant);
+}
+
+#ifdef MP_AFFINE_SIMD
+
+/// Cross product of four pairs of vectors, one register per coordinate.
+static void cross4(const __m128 a[3], const __m128 b[3], __m128 result[3]) {
+    result[0] = _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1]));
+    result[1] = _mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2]));
+    result[2] = _mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0]));
+}
+
+#endif
+
+void AffineTransform::evaluate(const AffineTransform* transforms, const std::size_t count, InstanceData* instances) {
+    std::size_t evaluated = 0;
+#ifdef MP_AFFINE_SIMD
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; evaluated + 4 <= count; evaluated += 4) {
+        // Four transforms of 12 floats, transposed so each register holds one float of the four.
+        const GLfloat* in = reinterpret_cast<const GLfloat*>(transforms + evaluated);
+        __m128 t[12];
+        for (std::size_t f = 0; f < 12; f += 4) {
+            __m128 r0 = _mm_loadu_ps(in + f), r1 = _mm_loadu_ps(in + 12 + f);
+            __m128 r2 = _mm_loadu_ps(in + 24 + f), r3 = _mm_loadu_ps(in + 36 + f);
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            t[f] = r0; t[f + 1] = r1; t[f + 2] = r2; t[f + 3] = r3;
+        }
+
+        // Same cofactors as normalMatrix.
+        __m128 n0[3], n1[3], n2[3];
+        cross4(t + 3, t + 6, n0);
+        cross4(t + 6, t, n1);
+        cross4(t, t + 3, n2);
+        const __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(t[0], n0[0]), _mm_mul_ps(t[1], n0[1])), _mm_mul_ps(t[2], n0[2]));
+        const __m128 inverseDeterminant = _mm_div_ps(one, determinant);
+
+        // The first 25 floats of InstanceData: model matrix then normal matrix, the color is kept.
+        __m128 components[25] = {
+            t[0], t[1], t[2], zero,
+            t[3], t[4], t[5], zero,
+            t[6], t[7], t[8], zero,
+            t[9], t[10], t[11], one,
+            _mm_mul_ps(n0[0], inverseDeterminant), _mm_mul_ps(n0[1], inverseDeterminant), _mm_mul_ps(n0[2], inverseDeterminant),
+            _mm_mul_ps(n1[0], inverseDeterminant), _mm_mul_ps(n1[1], inverseDeterminant), _mm_mul_ps(n1[2], inverseDeterminant),
+            _mm_mul_ps(n2[0], inverseDeterminant), _mm_mul_ps(n2[1], inverseDeterminant), _mm_mul_ps(n2[2], inverseDeterminant)
+        };
+        GLfloat* out = reinterpret_cast<GLfloat*>(instances + evaluated);
+        for (std::size_t f = 0; f < 24; f += 4) {
+            __m128 r0 = components[f], r1 = components[f + 1], r2 = components[f + 2], r3 = components[f + 3];
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(out + f, r0);
+            _mm_storeu_ps(out + 28 + f, r1);
+            _mm_storeu_ps(out + 56 + f, r2);
+            _mm_storeu_ps(out + 84 + f, r3);
+        }
+        GLfloat last[4];
+        _mm_storeu_ps(last, components[24]);
+        for (std::size_t i = 0; i < 4; i++) {
+            out[i * 28 + 24] = last[i];
+        }
+    }
+#endif
+    // The last few transforms, or all of them without SIMD.
+    for (; evaluated < count; evaluated++) {
+        instances[evaluated].modelMatrix = transforms[evaluated].toMat4();
+        instances[evaluated].normalMatrix = transforms[evaluated].normalMatrix();
+    }
+}
@@ -0,0 +1,107 @@
+/**
+ * Engine helper header file : AffineTransform
+ *
+ * Translation, rotation and scale of an object kept as a 3x4 matrix, cheaper to
+ * compose than a 4x4 one and with a normal matrix that needs no general inverse.
+ */
+
+#ifndef MP_AFFINE_TRANSFORM_H
+#define MP_AFFINE_TRANSFORM_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+#include "Mesh.h"
+
+/**
+ * Affine Transform
+ * A linear part (rotation and scale, possibly non-uniform) followed by a translation, the last row of
+ * the 4x4 matrix being always (0, 0, 0, 1). Built like glm matrices: translate, rotate and scale apply
+ * the new transformation first, in object space. Composing two transforms is 36 multiplies instead of 64,
+ * and the normal matrix is the cofactor matrix of the linear part over its determinant.
+ */
+class AffineTransform {
+public:
+
+    /// Identity transform.
+    AffineTransform();
+
+    /**
+     * Transform from its parts
+     * @param linear : Rotation and scale.
+     * @param translation : Translation applied after the linear part.
+     */
+    AffineTransform(const glm::mat3& linear, const glm::vec3& translation);
+
+    /**
+     * Transform from a model matrix
+     * @param modelMtx : Affine 4x4 matrix, its last row is dropped.
+     */
+    explicit AffineTransform(const glm::mat4& modelMtx);
+
+    /// Same transform, translated by offset in object space first.
+    AffineTransform translate(const glm::vec3& offset) const;
+
+    /// Same transform, rotated by angle (radians) about a unit axis in object space first.
+    AffineTransform rotate(GLfloat angle, const glm::vec3& axis) const;
+
+    /// Same transform, scaled along each axis in object space first.
+    AffineTransform scale(const glm::vec3& factors) const;
+
+    /// This transform applied after other.
+    AffineTransform operator*(const AffineTransform& other) const;
+
+    /// Inverse transform, the linear part must not be singular.
+    AffineTransform inverse() const;
+
+    /**
+     * Interpolation
+     * Slerps the rotations as quaternions and blends the scales and translations linearly. The linear parts
+     * must be a rotation times a positive scale along each axis, without shear. Equal transforms, and the
+     * ends t = 0 and t = 1, give back the same transform bit for bit.
+     * @param from : Transform at t = 0.
+     * @param to : Transform at t = 1.
+     * @param t : Blend factor, between 0 and 1.
+     * @return blended transform.
+     */
+    static AffineTransform interpolate(const AffineTransform& from, const AffineTransform& to, GLfloat t);
+
+    /// Transformed position.
+    glm::vec3 transformPoint(const glm::vec3& point) const { return _linear * point + _translation; }
+
+    /// Transformed direction, without the translation.
+    glm::vec3 transformDirection(const glm::vec3& direction) const { return _linear * direction; }
+
+    /// Matrix to upload, with the (0, 0, 0, 1) last row.
+    glm::mat4 toMat4() const;
+
+    /// Inverse transpose of the linear part, to transform normals.
+    glm::mat3 normalMatrix() const;
+
+    /// Rotation and scale.
+    const glm::mat3& getLinear() const { return _linear; }
+
+    /// Translation.
+    const glm::vec3& getTranslation() const { return _translation; }
+
+    /**
+     * Batched evaluation
+     * Writes the model and normal matrices of many transforms into instances, four at a time with SSE2
+     * on x86-64 processors. The colors of the instances are left untouched.
+     * @param transforms : Transforms to evaluate.
+     * @param count : Number of transforms.
+     * @param instances : Output of at least count instances.
+     */
+    static void evaluate(const AffineTransform* transforms, std::size_t count, InstanceData* instances);
+
+private:
+
+    /// Rotation and scale.
+    glm::mat3 _linear;
+    /// Translation applied after the linear part.
+    glm::vec3 _translation;
+};
+
+#endif //MP_AFFINE_TRANSFORM_H
@@ -0,0 +1,23 @@
+/**
+ * Engine helper header file : FrameContext
+ *
+ * Time of a frame, sampled once and handed to every system animating something,
+ * so they all agree on it.
+ */
+
+#ifndef MP_FRAME_CONTEXT_H
+#define MP_FRAME_CONTEXT_H
+
+/**
+ * Frame Context
+ * The run loop samples the clock once per frame into a context. The simulation consumes its elapsed
+ * time in fixed steps, and the drawing gets a context at the interpolated simulation time instead.
+ */
+struct FrameContext {
+    /// Time of the frame, in seconds.
+    double time = 0.0;
+    /// Time elapsed since the previous frame, in seconds.
+    double deltaTime = 0.0;
+};
+
+#endif //MP_FRAME_CONTEXT_H
@@ -0,0 +1,80 @@
+/**
+ * Engine helper class : Frustum
+ *
+ * Bounding spheres of the renderables and the six planes of a camera frustum,
+ * used to skip everything a view cannot see before it is drawn.
+ */
+
+#include "Frustum.h"
+
+#include <algorithm>
+#include <limits>
+
+
+// -------------------------------- BOUNDING SPHERE --------------------------------
+
+BoundingSphere BoundingSphere::transformed(const glm::mat4& transform) const {
+    const GLfloat scale = std::max({glm::length(glm::vec3(transform[0])),
+                                    glm::length(glm::vec3(transform[1])),
+                                    glm::length(glm::vec3(transform[2]))});
+    return {glm::vec3(transform * glm::vec4(center, 1.0f)), radius * scale};
+}
+
+BoundingSphere BoundingSphere::merged(const BoundingSphere& other) const {
+    const GLfloat distance = glm::length(other.center - center);
+    if (distance + other.radius <= radius) return *this;
+    if (distance + radius <= other.radius) return other;
+
+    // Both spheres touch the merged one on the line between their centers.
+    const GLfloat mergedRadius = (distance + radius + other.radius) * 0.5f;
+    return {center + (other.center - center) * ((mergedRadius - radius) / distance), mergedRadius};
+}
+
+BoundingSphere BoundingSphere::enclosing(const glm::vec3& minCorner, const glm::vec3& maxCorner) {
+    return {(minCorner + maxCorner) * 0.5f, glm::length(maxCorner - minCorner) * 0.5f};
+}
+
+BoundingSphere BoundingSphere::everywhere() {
+    return {glm::vec3(0.0f), std::numeric_limits<GLfloat>::infinity()};
+}
+
+
+// -------------------------------- FRUSTUM --------------------------------
+
+Frustum::Frustum(const glm::mat4& viewProjectionMtx) {
+    // Each plane is the last row of the matrix plus or minus one of the others (Gribb & Hartmann).
+    const glm::mat4 rows = glm::transpose(viewProjectionMtx);
+    _planes[0] = rows[3] + rows[0];
+    _planes[1] = rows[3] - rows[0];
+    _planes[2] = rows[3] + rows[1];
+    _planes[3] = rows[3] - rows[1];
+    _planes[4] = rows[3] + rows[2];
+    _planes[5] = rows[3] - rows[2];
+
+    // Normalized, so the distances can be compared to radii.
+    for (glm::vec4& plane : _planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+bool Frustum::intersects(const BoundingSphere& sphere) const {
+    for (const glm::vec4& plane : _planes) {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::intersects(const glm::vec3& minCorner, const glm::vec3& maxCorner) const {
+    for (const glm::vec4& plane : _planes) {
+        // The corner furthest along the plane normal is the last one to leave.
+        const glm::vec3 corner(plane.x >= 0.0f ? maxCorner.x : minCorner.x,
+                               plane.y >= 0.0f ? maxCorner.y : minCorner.y,
+                               plane.z >= 0.0f ? maxCorner.z : minCorner.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+/**
+ * Engine helper header file : Frustum
+ *
+ * Bounding spheres of the renderables and the six planes of a camera frustum,
+ * used to skip everything a view cannot see before it is drawn.
+ */
+
+#ifndef MP_FRUSTUM_H
+#define MP_FRUSTUM_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+/// Sphere enclosing a renderable.
+struct BoundingSphere {
+    glm::vec3 center;
+    GLfloat radius;
+
+    /**
+     * Sphere transformation
+     * @param transform : Model matrix, its largest axis scale grows the radius.
+     * @return a sphere enclosing this one once transformed.
+     */
+    BoundingSphere transformed(const glm::mat4& transform) const;
+
+    /// Sphere enclosing both this sphere and the other one.
+    BoundingSphere merged(const BoundingSphere& other) const;
+
+    /// Sphere enclosing the axis aligned box between the two corners.
+    static BoundingSphere enclosing(const glm::vec3& minCorner, const glm::vec3& maxCorner);
+
+    /// Sphere containing everything, for what must never be culled.
+    static BoundingSphere everywhere();
+};
+
+/**
+ * Frustum
+ * The six planes of a view-projection matrix, normals pointing inside.
+ */
+class Frustum {
+public:
+
+    /**
+     * Frustum extraction
+     * @param viewProjectionMtx : Projection times view matrix of the camera.
+     */
+    explicit Frustum(const glm::mat4& viewProjectionMtx);
+
+    /**
+     * Sphere test
+     * @param sphere : World space bounding sphere.
+     * @return false only when the sphere is completely outside one of the planes.
+     */
+    bool intersects(const BoundingSphere& sphere) const;
+
+    /**
+     * Box test
+     * @param minCorner : Smallest corner of a world space axis aligned box.
+     * @param maxCorner : Largest corner of the box.
+     * @return false only when the box is completely outside one of the planes.
+     */
+    bool intersects(const glm::vec3& minCorner, const glm::vec3& maxCorner) const;
+
+    /// Left, right, bottom, top, near and far planes, to send them to a shader.
+    const glm::vec4* getPlanes() const { return _planes; }
+
+private:
+
+    /// Left, right, bottom, top, near and far planes (normal, distance).
+    glm::vec4 _planes[6];
+};
+
+#endif //MP_FRUSTUM_H
@@ -0,0 +1,375 @@
+/**
+ * Engine helper class : GrassField
+ *
+ * Grass clumps kept as separate packed arrays (structure of arrays), swayed on the CPU
+ * by a SIMD kernel writing the instance transforms, for when the shader cannot do it.
+ */
+
+#include "GrassField.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+// SSE2 is part of every x86-64 processor, AVX2 is checked when the field is created.
+#if defined(__x86_64__) || defined(_M_X64)
+#define MP_GRASS_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only compile the AVX2 kernel for AVX2, the rest of the engine keeps its flags.
+#if defined(MP_GRASS_SIMD) && (defined(__GNUC__) || defined(__clang__))
+#define MP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define MP_TARGET_AVX2
+#endif
+
+/// Number of floats of an instance, the kernels write them as a flat array.
+static constexpr std::size_t INSTANCE_FLOATS = 28;
+static_assert(sizeof(InstanceData) == INSTANCE_FLOATS * sizeof(GLfloat), "InstanceData must be tightly packed");
+
+/// Largest sway angle, 5 degrees in radians.
+static constexpr GLfloat MAX_SWAY_ANGLE = 5.0f * 3.14159265f / 180.0f;
+
+#ifdef MP_GRASS_SIMD
+
+/// True when the processor and the operating system both support AVX2 and FMA.
+static bool cpuSupportsAvx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    const bool osSavesYmm = (info[2] & (1 << 27)) != 0;
+    const bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osSavesYmm || !fma || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+/**
+ * Packed instance stores
+ * Every register holds one float of four clumps, in the order of InstanceData. Each group of four
+ * registers is transposed so each clump gets its four consecutive floats in a single store.
+ * @param components : The 28 floats of the four clumps.
+ * @param instances : First of the four clumps.
+ */
+static void storeInstances(__m128 components[INSTANCE_FLOATS], InstanceData* instances) {
+    GLfloat* out = reinterpret_cast<GLfloat*>(instances);
+    for (std::size_t f = 0; f < INSTANCE_FLOATS; f += 4) {
+        __m128 r0 = components[f], r1 = components[f + 1], r2 = components[f + 2], r3 = components[f + 3];
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(out + f, r0);
+        _mm_storeu_ps(out + INSTANCE_FLOATS + f, r1);
+        _mm_storeu_ps(out + 2 * INSTANCE_FLOATS + f, r2);
+        _mm_storeu_ps(out + 3 * INSTANCE_FLOATS + f, r3);
+    }
+}
+
+/// Sine of four angles, within 1e-6 of std::sin for the angles of a float time.
+static __m128 sinSse2(__m128 x) {
+    // Down to [-pi, pi], rounding to the nearest turn.
+    const __m128 turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.159154943f))));
+    x = _mm_sub_ps(x, _mm_mul_ps(turns, _mm_set1_ps(6.28318531f)));
+
+    // Then [-pi/2, pi/2], as sin(x) = sin(pi - x) = sin(-pi - x).
+    const __m128 pi = _mm_set1_ps(3.14159265f);
+    const __m128 halfPi = _mm_set1_ps(1.57079633f);
+    const __m128 above = _mm_cmpgt_ps(x, halfPi);
+    const __m128 below = _mm_cmplt_ps(x, _mm_sub_ps(_mm_setzero_ps(), halfPi));
+    x = _mm_or_ps(_mm_and_ps(above, _mm_sub_ps(pi, x)), _mm_andnot_ps(above, x));
+    x = _mm_or_ps(_mm_and_ps(below, _mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), pi), x)), _mm_andnot_ps(below, x));
+
+    // Taylor series up to the ninth power.
+    const __m128 x2 = _mm_mul_ps(x, x);
+    __m128 p = _mm_set1_ps(1.0f / 362880.0f);
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 5040.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f / 120.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(-1.0f / 6.0f));
+    p = _mm_add_ps(_mm_mul_ps(p, x2), _mm_set1_ps(1.0f));
+    return _mm_mul_ps(p, x);
+}
+
+/**
+ * Packed instance stores of eight clumps
+ * Same transposes as storeInstances within each half of the registers, the low half holding
+ * clumps 0 to 3 and the high half clumps 4 to 7. Kept in AVX2 to avoid mixing in SSE instructions.
+ * @param components : The 28 floats of the eight clumps.
+ * @param instances : First of the eight clumps.
+ */
+MP_TARGET_AVX2 static void storeInstancesAvx2(const __m256 components[INSTANCE_FLOATS], InstanceData* instances) {
+    GLfloat* out = reinterpret_cast<GLfloat*>(instances);
+    for (std::size_t f = 0; f < INSTANCE_FLOATS; f += 4) {
+        const __m256 t0 = _mm256_unpacklo_ps(components[f], components[f + 1]);
+        const __m256 t1 = _mm256_unpacklo_ps(components[f + 2], components[f + 3]);
+        const __m256 t2 = _mm256_unpackhi_ps(components[f], components[f + 1]);
+        const __m256 t3 = _mm256_unpackhi_ps(components[f + 2], components[f + 3]);
+        const __m256 clumps[4] = {_mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2)),
+                                  _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0)), _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2))};
+        for (std::size_t c = 0; c < 4; c++) {
+            _mm_storeu_ps(out + c * INSTANCE_FLOATS + f, _mm256_castps256_ps128(clumps[c]));
+            _mm_storeu_ps(out + (c + 4) * INSTANCE_FLOATS + f, _mm256_extractf128_ps(clumps[c], 1));
+        }
+    }
+}
+
+/// Sine of eight angles, same approximation as sinSse2.
+MP_TARGET_AVX2 static __m256 sinAvx2(__m256 x) {
+    const __m256 turns = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(0.159154943f)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    x = _mm256_fnmadd_ps(turns, _mm256_set1_ps(6.28318531f), x);
+
+    const __m256 pi = _mm256_set1_ps(3.14159265f);
+    const __m256 halfPi = _mm256_set1_ps(1.57079633f);
+    x = _mm256_blendv_ps(x, _mm256_sub_ps(pi, x), _mm256_cmp_ps(x, halfPi, _CMP_GT_OQ));
+    x = _mm256_blendv_ps(x, _mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), pi), x),
+                         _mm256_cmp_ps(x, _mm256_sub_ps(_mm256_setzero_ps(), halfPi), _CMP_LT_OQ));
+
+    const __m256 x2 = _mm256_mul_ps(x, x);
+    __m256 p = _mm256_set1_ps(1.0f / 362880.0f);
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(-1.0f / 5040.0f));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(1.0f / 120.0f));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(-1.0f / 6.0f));
+    p = _mm256_fmadd_ps(p, x2, _mm256_set1_ps(1.0f));
+    return _mm256_mul_ps(p, x);
+}
+
+#endif
+
+GrassField::GrassField() : _kernel(KERNEL_SCALAR) {
+#ifdef MP_GRASS_SIMD
+    _kernel = cpuSupportsAvx2() ? KERNEL_AVX2 : KERNEL_SSE2;
+#endif
+}
+
+void GrassField::add(const glm::vec3& position, const glm::vec3& scale, const glm::vec3& color) {
+    _positionX.push_back(position.x);
+    _positionY.push_back(position.y);
+    _positionZ.push_back(position.z);
+    _scaleX.push_back(scale.x);
+    _scaleY.push_back(scale.y);
+    _scaleZ.push_back(scale.z);
+    _inverseScaleX.push_back(1.0f / scale.x);
+    _inverseScaleY.push_back(1.0f / scale.y);
+    _inverseScaleZ.push_back(1.0f / scale.z);
+    // Same shift as the shader, from the translation of the model matrix.
+    _phase.push_back(position.x + position.z);
+    _red.push_back(color.x);
+    _green.push_back(color.y);
+    _blue.push_back(color.z);
+}
+
+void GrassField::clear() {
+    for (std::vector<GLfloat>* array : {&_positionX, &_positionY, &_positionZ, &_scaleX, &_scaleY, &_scaleZ,
+                                        &_inverseScaleX, &_inverseScaleY, &_inverseScaleZ, &_phase, &_red, &_green, &_blue}) {
+        array->clear();
+    }
+}
+
+void GrassField::sway(const GLfloat time, InstanceData* instances, const Kernel kernel) const {
+    _sway(time, instances, 0, size(), kernel);
+}
+
+void GrassField::sway(const GLfloat time, InstanceData* instances, const std::size_t first, const std::size_t last) const {
+    _sway(time, instances, first, last, _kernel);
+}
+
+void GrassField::_sway(const GLfloat time, InstanceData* instances, const std::size_t first, const std::size_t last, const Kernel kernel) const {
+    std::size_t swayed = first;
+#ifdef MP_GRASS_SIMD
+    if (kernel == KERNEL_AVX2) {
+        swayed = first + ((last - first) & ~static_cast<std::size_t>(7));
+        _swayAvx2(time, instances, first, swayed);
+    } else if (kernel == KERNEL_SSE2) {
+        swayed = first + ((last - first) & ~static_cast<std::size_t>(3));
+        _swaySse2(time, instances, first, swayed);
+    }
+#endif
+    // The last few clumps, or all of them without SIMD.
+    _swayScalar(time, instances, swayed, last);
+}
+
+const char* GrassField::kernelName(const Kernel kernel) {
+    switch (kernel) {
+        case KERNEL_AVX2: return "AVX2";
+        case KERNEL_SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
+
+/*
+ * The shader rotates the clump about Z around its bottom (object point (0, -1, 0)), then applies
+ * the model matrix T(p) S(s). Written out, the swayed model matrix has the columns
+ *     (sx c, sy s, 0, 0), (-sx s, sy c, 0, 0), (0, 0, sz, 0), (px - sx s, py + sy (c - 1), pz, 1)
+ * and its normal matrix, the inverse transpose S^-1 R, the columns
+ *     (c / sx, s / sy, 0), (-s / sx, c / sy, 0), (0, 0, 1 / sz).
+ * Every kernel writes these, only the number of clumps at a time changes.
+ */
+
+void GrassField::_swayScalar(const GLfloat time, InstanceData* instances, const std::size_t first, const std::size_t last) const {
+    for (std::size_t i = first; i < last; i++) {
+        const GLfloat angle = std::sin(time * 2.0f + _phase[i]) * MAX_SWAY_ANGLE;
+        const GLfloat c = std::cos(angle);
+        const GLfloat s = std::sin(angle);
+
+        InstanceData& instance = instances[i];
+        instance.modelMatrix = glm::mat4(glm::vec4(_scaleX[i] * c, _scaleY[i] * s, 0.0f, 0.0f),
+                                         glm::vec4(-_scaleX[i] * s, _scaleY[i] * c, 0.0f, 0.0f),
+                                         glm::vec4(0.0f, 0.0f, _scaleZ[i], 0.0f),
+                                         glm::vec4(_positionX[i] - _scaleX[i] * s, _positionY[i] + _scaleY[i] * (c - 1.0f), _positionZ[i], 1.0f));
+        instance.normalMatrix = glm::mat3(glm::vec3(c * _inverseScaleX[i], s * _inverseScaleY[i], 0.0f),
+                                          glm::vec3(-s * _inverseScaleX[i], c * _inverseScaleY[i], 0.0f),
+                                          glm::vec3(0.0f, 0.0f, _inverseScaleZ[i]));
+        instance.color = glm::vec3(_red[i], _green[i], _blue[i]);
+    }
+}
+
+#ifdef MP_GRASS_SIMD
+
+void GrassField::_swaySse2(const GLfloat time, InstanceData* instances, const std::size_t first, const std::size_t last) const {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 wave = _mm_set1_ps(time * 2.0f);
+    for (std::size_t i = first; i < last; i += 4) {
+        // The angle stays under 5 degrees, a few terms of the series are exact in float.
+        const __m128 angle = _mm_mul_ps(sinSse2(_mm_add_ps(wave, _mm_loadu_ps(&_phase[i]))), _mm_set1_ps(MAX_SWAY_ANGLE));
+        const __m128 angle2 = _mm_mul_ps(angle, angle);
+        const __m128 s = _mm_mul_ps(angle, _mm_sub_ps(one, _mm_mul_ps(_mm_mul_ps(angle2, _mm_set1_ps(1.0f / 6.0f)),
+                                                                     _mm_sub_ps(one, _mm_mul_ps(angle2, _mm_set1_ps(1.0f / 20.0f))))));
+        const __m128 c = _mm_sub_ps(one, _mm_mul_ps(_mm_mul_ps(angle2, _mm_set1_ps(0.5f)),
+                                                    _mm_sub_ps(one, _mm_mul_ps(angle2, _mm_set1_ps(1.0f / 12.0f)))));
+
+        const __m128 sx = _mm_loadu_ps(&_scaleX[i]);
+        const __m128 sy = _mm_loadu_ps(&_scaleY[i]);
+        const __m128 isx = _mm_loadu_ps(&_inverseScaleX[i]);
+        const __m128 isy = _mm_loadu_ps(&_inverseScaleY[i]);
+        const __m128 sxs = _mm_mul_ps(sx, s);
+        const __m128 isxs = _mm_mul_ps(isx, s);
+
+        __m128 components[INSTANCE_FLOATS] = {
+            _mm_mul_ps(sx, c), _mm_mul_ps(sy, s), zero, zero,
+            _mm_sub_ps(zero, sxs), _mm_mul_ps(sy, c), zero, zero,
+            zero, zero, _mm_loadu_ps(&_scaleZ[i]), zero,
+            _mm_sub_ps(_mm_loadu_ps(&_positionX[i]), sxs), _mm_add_ps(_mm_loadu_ps(&_positionY[i]), _mm_mul_ps(sy, _mm_sub_ps(c, one))),
+            _mm_loadu_ps(&_positionZ[i]), one,
+            _mm_mul_ps(isx, c), _mm_mul_ps(isy, s), zero,
+            _mm_sub_ps(zero, isxs), _mm_mul_ps(isy, c), zero,
+            zero, zero, _mm_loadu_ps(&_inverseScaleZ[i]),
+            _mm_loadu_ps(&_red[i]), _mm_loadu_ps(&_green[i]), _mm_loadu_ps(&_blue[i])
+        };
+        storeInstances(components, instances + i);
+    }
+}
+
+MP_TARGET_AVX2 void GrassField::_swayAvx2(const GLfloat time, InstanceData* instances, const std::size_t first, const std::size_t last) const {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 wave = _mm256_set1_ps(time * 2.0f);
+    for (std::size_t i = first; i < last; i += 8) {
+        const __m256 angle = _mm256_mul_ps(sinAvx2(_mm256_add_ps(wave, _mm256_loadu_ps(&_phase[i]))), _mm256_set1_ps(MAX_SWAY_ANGLE));
+        const __m256 angle2 = _mm256_mul_ps(angle, angle);
+        const __m256 s = _mm256_mul_ps(angle, _mm256_fnmadd_ps(_mm256_mul_ps(angle2, _mm256_set1_ps(1.0f / 6.0f)),
+                                                               _mm256_fnmadd_ps(angle2, _mm256_set1_ps(1.0f / 20.0f), one), one));
+        const __m256 c = _mm256_fnmadd_ps(_mm256_mul_ps(angle2, _mm256_set1_ps(0.5f)),
+                                          _mm256_fnmadd_ps(angle2, _mm256_set1_ps(1.0f / 12.0f), one), one);
+
+        const __m256 sx = _mm256_loadu_ps(&_scaleX[i]);
+        const __m256 sy = _mm256_loadu_ps(&_scaleY[i]);
+        const __m256 isx = _mm256_loadu_ps(&_inverseScaleX[i]);
+        const __m256 isy = _mm256_loadu_ps(&_inverseScaleY[i]);
+        const __m256 sxs = _mm256_mul_ps(sx, s);
+        const __m256 isxs = _mm256_mul_ps(isx, s);
+
+        const __m256 components[INSTANCE_FLOATS] = {
+            _mm256_mul_ps(sx, c), _mm256_mul_ps(sy, s), zero, zero,
+            _mm256_sub_ps(zero, sxs), _mm256_mul_ps(sy, c), zero, zero,
+            zero, zero, _mm256_loadu_ps(&_scaleZ[i]), zero,
+            _mm256_sub_ps(_mm256_loadu_ps(&_positionX[i]), sxs), _mm256_fmadd_ps(sy, _mm256_sub_ps(c, one), _mm256_loadu_ps(&_positionY[i])),
+            _mm256_loadu_ps(&_positionZ[i]), one,
+            _mm256_mul_ps(isx, c), _mm256_mul_ps(isy, s), zero,
+            _mm256_sub_ps(zero, isxs), _mm256_mul_ps(isy, c), zero,
+            zero, zero, _mm256_loadu_ps(&_inverseScaleZ[i]),
+            _mm256_loadu_ps(&_red[i]), _mm256_loadu_ps(&_green[i]), _mm256_loadu_ps(&_blue[i])
+        };
+
+        storeInstancesAvx2(components, instances + i);
+    }
+}
+
+#else
+
+// Without SIMD the processor only ever gets the scalar kernel.
+void GrassField::_swaySse2(const GLfloat time, InstanceData* instances, const std::size_t first, const std::size_t last) const {
+    _swayScalar(time, instances, first, last);
+}
+
+void GrassField::_swayAvx2(const GLfloat time, InstanceData* instances, const std::size_t first, const std::size_t last) const {
+    _swayScalar(time, instances, first, last);
+}
+
+#endif
+
+void GrassField::benchmark(const GLuint iterations) const {
+    const std::size_t count = size();
+    if (count == 0 || iterations == 0) return;
+    using Clock = std::chrono::steady_clock;
+    const GLfloat timeStep = 1.0f / 60.0f;
+
+    // The clumps as they used to be stored, a model matrix and a color each.
+    std::vector<glm::mat4> models(count);
+    std::vector<glm::vec3> colors(count);
+    for (std::size_t i = 0; i < count; i++) {
+        models[i] = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(_positionX[i], _positionY[i], _positionZ[i])),
+                               glm::vec3(_scaleX[i], _scaleY[i], _scaleZ[i]));
+        colors[i] = glm::vec3(_red[i], _green[i], _blue[i]);
+    }
+
+    // Reference: the sway matrix built with glm and a full inverse for the normals, clump by clump.
+    std::vector<InstanceData> reference(count);
+    Clock::time_point start = Clock::now();
+    for (GLuint iteration = 0; iteration < iterations; iteration++) {
+        const GLfloat time = static_cast<GLfloat>(iteration) * timeStep;
+        for (std::size_t i = 0; i < count; i++) {
+            const GLfloat angle = glm::radians(std::sin(time * 2.0f + models[i][3].x + models[i][3].z) * 5.0f);
+            glm::mat4 model = glm::translate(models[i], glm::vec3(0.0f, -1.0f, 0.0f));
+            model = glm::rotate(model, angle, glm::vec3(0.0f, 0.0f, 1.0f));
+            model = glm::translate(model, glm::vec3(0.0f, 1.0f, 0.0f));
+            reference[i] = {model, glm::mat3(glm::transpose(glm::inverse(model))), colors[i]};
+        }
+    }
+    const double referenceSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    const double clumpSways = static_cast<double>(count) * iterations;
+
+    fprintf(stdout, "[INFO]: Grass sway benchmark, %zu clumps x %u iterations\n", count, iterations);
+    fprintf(stdout, "[INFO]:   %-8s : %8.2f ns per clump\n", "glm", referenceSeconds * 1e9 / clumpSways);
+
+    // Every kernel the processor supports, the largest difference measured on the last iteration.
+    std::vector<InstanceData> instances(count);
+    for (GLuint k = KERNEL_SCALAR; k <= static_cast<GLuint>(_kernel); k++) {
+        const Kernel kernel = static_cast<Kernel>(k);
+        start = Clock::now();
+        for (GLuint iteration = 0; iteration < iterations; iteration++) {
+            sway(static_cast<GLfloat>(iteration) * timeStep, instances.data(), kernel);
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        GLfloat difference = 0.0f;
+        for (std::size_t i = 0; i < count; i++) {
+            const GLfloat* expected = reinterpret_cast<const GLfloat*>(&reference[i]);
+            const GLfloat* actual = reinterpret_cast<const GLfloat*>(&instances[i]);
+            for (std::size_t f = 0; f < INSTANCE_FLOATS; f++) {
+                difference = std::max(difference, std::abs(expected[f] - actual[f]));
+            }
+        }
+        fprintf(stdout, "[INFO]:   %-8s : %8.2f ns per clump, %5.2fx the glm loop, largest difference %.1e\n",
+                kernelName(kernel), seconds * 1e9 / clumpSways, referenceSeconds / seconds, difference);
+    }
+}
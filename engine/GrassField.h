@@ -0,0 +1,122 @@
+/**
+ * Engine helper header file : GrassField
+ *
+ * Grass clumps kept as separate packed arrays (structure of arrays), swayed on the CPU
+ * by a SIMD kernel writing the instance transforms, for when the shader cannot do it.
+ */
+
+#ifndef MP_GRASS_FIELD_H
+#define MP_GRASS_FIELD_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Mesh.h"
+
+/**
+ * Grass Field
+ * Each clump is a position, a scale and a color, its phase (x + z) being precomputed. The sway is
+ * the one of the lighting shader: a rotation about Z of up to 5 degrees around the bottom of the
+ * clump, following sin(2 time + phase). The kernel is picked once from the CPU: AVX2 (eight clumps
+ * at a time), SSE2 (four clumps at a time), or a scalar loop on any other processor.
+ */
+class GrassField {
+public:
+
+    /// Kernels computing the sway.
+    enum Kernel {
+        /// One clump at a time, any processor.
+        KERNEL_SCALAR,
+        /// Four clumps at a time, any x86-64 processor.
+        KERNEL_SSE2,
+        /// Eight clumps at a time, x86-64 processors with AVX2 and FMA.
+        KERNEL_AVX2
+    };
+
+    /// Picks the fastest kernel the processor runs.
+    GrassField();
+
+    /**
+     * Clump addition
+     * @param position : World space position of the bottom center of the clump.
+     * @param scale : Scale of the clump mesh along each axis, none being zero.
+     * @param color : Color of the clump.
+     */
+    void add(const glm::vec3& position, const glm::vec3& scale, const glm::vec3& color);
+
+    /// Removes every clump.
+    void clear();
+
+    /// Number of clumps.
+    std::size_t size() const { return _phase.size(); }
+
+    /**
+     * Sway computation
+     * Writes the swayed model matrix, its normal matrix and the color of every clump, in order.
+     * @param time : Time in seconds, the same as the one of the shader.
+     * @param instances : Output of at least size() instances.
+     */
+    void sway(GLfloat time, InstanceData* instances) const { sway(time, instances, _kernel); }
+
+    /**
+     * Sway computation with a given kernel
+     * @param time : Time in seconds.
+     * @param instances : Output of at least size() instances.
+     * @param kernel : Kernel to use, the processor must support it.
+     */
+    void sway(GLfloat time, InstanceData* instances, Kernel kernel) const;
+
+    /**
+     * Sway computation of a range of clumps
+     * Only writes the instances [first, last), so several threads can share the field.
+     * @param time : Time in seconds.
+     * @param instances : Output of at least size() instances.
+     * @param first : First clump of the range.
+     * @param last : One past the last clump of the range.
+     */
+    void sway(GLfloat time, InstanceData* instances, std::size_t first, std::size_t last) const;
+
+    /// Kernel picked for the processor.
+    Kernel getKernel() const { return _kernel; }
+
+    /// Printable name of a kernel.
+    static const char* kernelName(Kernel kernel);
+
+    /**
+     * Micro-benchmark
+     * Times every kernel the processor supports against the matrix loop the sway used to be
+     * (a glm translate, rotate, translate and inverse transpose per clump), and prints the time
+     * per clump and the largest difference with that loop on stdout.
+     * @param iterations : Number of sways of the whole field timed per kernel.
+     */
+    void benchmark(GLuint iterations) const;
+
+private:
+
+    /// Clumps [first, last) with the given kernel, the remainder one at a time.
+    void _sway(GLfloat time, InstanceData* instances, std::size_t first, std::size_t last, Kernel kernel) const;
+    /// Clumps [first, last) one at a time.
+    void _swayScalar(GLfloat time, InstanceData* instances, std::size_t first, std::size_t last) const;
+    /// Clumps [first, last) four at a time, the range being a multiple of four.
+    void _swaySse2(GLfloat time, InstanceData* instances, std::size_t first, std::size_t last) const;
+    /// Clumps [first, last) eight at a time, the range being a multiple of eight.
+    void _swayAvx2(GLfloat time, InstanceData* instances, std::size_t first, std::size_t last) const;
+
+    /// Position of every clump.
+    std::vector<GLfloat> _positionX, _positionY, _positionZ;
+    /// Scale of every clump.
+    std::vector<GLfloat> _scaleX, _scaleY, _scaleZ;
+    /// Inverse scale of every clump, the diagonal of the normal matrix.
+    std::vector<GLfloat> _inverseScaleX, _inverseScaleY, _inverseScaleZ;
+    /// Sine wave shift of every clump.
+    std::vector<GLfloat> _phase;
+    /// Color of every clump.
+    std::vector<GLfloat> _red, _green, _blue;
+
+    /// Fastest kernel the processor runs.
+    Kernel _kernel;
+};
+
+#endif //MP_GRASS_FIELD_H
@@ -0,0 +1,104 @@
+/**
+ * Engine helper class : Heightfield
+ *
+ * Terrain as a regular grid of heights with precomputed normals, answering
+ * height and normal queries anywhere in constant time, whatever its shape.
+ */
+
+#include "Heightfield.h"
+
+#include <algorithm>
+
+
+void Heightfield::generate(const glm::vec2& minCorner, const glm::vec2& size, GLuint cells, const HeightFunction& height) {
+    cells = std::max(cells, 1u);
+    _resize(minCorner, size, cells + 1, cells + 1);
+    for (GLuint row = 0; row < _rows; row++) {
+        for (GLuint column = 0; column < _columns; column++) {
+            _heights[row * _columns + column] = height(_minCorner.x + column * _cellSize.x, _minCorner.y + row * _cellSize.y);
+        }
+    }
+    _computeNormals();
+}
+
+GLfloat Heightfield::heightAt(const GLfloat x, const GLfloat z) const {
+    if (_heights.empty()) return 0.0f;
+
+    std::size_t corner;
+    GLfloat u, v;
+    _locate(x, z, corner, u, v);
+    const GLfloat nearRow = _heights[corner] + (_heights[corner + 1] - _heights[corner]) * u;
+    const GLfloat farRow = _heights[corner + _columns] + (_heights[corner + _columns + 1] - _heights[corner + _columns]) * u;
+    return nearRow + (farRow - nearRow) * v;
+}
+
+glm::vec3 Heightfield::normalAt(const GLfloat x, const GLfloat z) const {
+    if (_normals.empty()) return glm::vec3(0.0f, 1.0f, 0.0f);
+
+    std::size_t corner;
+    GLfloat u, v;
+    _locate(x, z, corner, u, v);
+    const glm::vec3 nearRow = _normals[corner] + (_normals[corner + 1] - _normals[corner]) * u;
+    const glm::vec3 farRow = _normals[corner + _columns] + (_normals[corner + _columns + 1] - _normals[corner + _columns]) * u;
+    return glm::normalize(nearRow + (farRow - nearRow) * v);
+}
+
+MeshData Heightfield::mesh() const {
+    MeshData mesh;
+    mesh.vertices.reserve(_heights.size());
+    for (GLuint row = 0; row < _rows; row++) {
+        for (GLuint column = 0; column < _columns; column++) {
+            const std::size_t point = row * _columns + column;
+            mesh.vertices.push_back({glm::vec3(_minCorner.x + column * _cellSize.x, _heights[point], _minCorner.y + row * _cellSize.y),
+                                     _normals[point]});
+        }
+    }
+
+    // Same winding as the flat ground quad the terrain replaces.
+    if (_rows > 1 && _columns > 1) mesh.indices.reserve(6 * (_rows - 1) * (_columns - 1));
+    for (GLuint row = 0; row + 1 < _rows; row++) {
+        for (GLuint column = 0; column + 1 < _columns; column++) {
+            const GLuint corner = row * _columns + column;
+            mesh.indices.insert(mesh.indices.end(), {corner, corner + 1, corner + _columns,
+                                                     corner + _columns, corner + 1, corner + _columns + 1});
+        }
+    }
+    return mesh;
+}
+
+void Heightfield::_resize(const glm::vec2& minCorner, const glm::vec2& size, const GLuint columns, const GLuint rows) {
+    _minCorner = minCorner;
+    _columns = columns;
+    _rows = rows;
+    _cellSize = size / glm::vec2(static_cast<GLfloat>(columns - 1), static_cast<GLfloat>(rows - 1));
+    _heights.assign(static_cast<std::size_t>(columns) * rows, 0.0f);
+    _normals.assign(_heights.size(), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+void Heightfield::_computeNormals() {
+    for (GLuint row = 0; row < _rows; row++) {
+        for (GLuint column = 0; column < _columns; column++) {
+            // Central differences inside, one-sided along the borders.
+            const GLuint left = column > 0 ? column - 1 : column;
+            const GLuint right = column + 1 < _columns ? column + 1 : column;
+            const GLuint back = row > 0 ? row - 1 : row;
+            const GLuint front = row + 1 < _rows ? row + 1 : row;
+
+            const GLfloat slopeX = (_heights[row * _columns + right] - _heights[row * _columns + left]) / ((right - left) * _cellSize.x);
+            const GLfloat slopeZ = (_heights[front * _columns + column] - _heights[back * _columns + column]) / ((front - back) * _cellSize.y);
+            _normals[row * _columns + column] = glm::normalize(glm::vec3(-slopeX, 1.0f, -slopeZ));
+        }
+    }
+}
+
+void Heightfield::_locate(const GLfloat x, const GLfloat z, std::size_t& corner, GLfloat& u, GLfloat& v) const {
+    // Position in cells, the last cell holding the far border.
+    const GLfloat cellX = glm::clamp((x - _minCorner.x) / _cellSize.x, 0.0f, static_cast<GLfloat>(_columns - 1));
+    const GLfloat cellZ = glm::clamp((z - _minCorner.y) / _cellSize.y, 0.0f, static_cast<GLfloat>(_rows - 1));
+    const GLuint column = std::min(static_cast<GLuint>(cellX), _columns - 2);
+    const GLuint row = std::min(static_cast<GLuint>(cellZ), _rows - 2);
+
+    corner = static_cast<std::size_t>(row) * _columns + column;
+    u = cellX - column;
+    v = cellZ - row;
+}
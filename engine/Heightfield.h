@@ -0,0 +1,83 @@
+/**
+ * Engine helper header file : Heightfield
+ *
+ * Terrain as a regular grid of heights with precomputed normals, answering
+ * height and normal queries anywhere in constant time, whatever its shape.
+ */
+
+#ifndef MP_HEIGHTFIELD_H
+#define MP_HEIGHTFIELD_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <vector>
+
+#include "Mesh.h"
+
+/**
+ * Heightfield
+ * Heights are sampled from a function on a grid of points covering a rectangle of the XZ plane. A query finds
+ * the cell holding the point and blends the heights (or normals) of its four corners, so it costs the same for
+ * a flat plane and for a range of hills. Outside the rectangle, the terrain continues with the height of its border.
+ */
+class Heightfield {
+public:
+
+    /// Height of a point of the XZ plane.
+    using HeightFunction = std::function<GLfloat(GLfloat x, GLfloat z)>;
+
+    Heightfield() = default;
+
+    /**
+     * Procedural generation
+     * @param minCorner : World space (x, z) of the first point of the grid.
+     * @param size : Width (along X) and length (along Z) of the terrain.
+     * @param cells : Number of cells along each side, at least one.
+     * @param height : Height of the terrain at every point of the grid.
+     */
+    void generate(const glm::vec2& minCorner, const glm::vec2& size, GLuint cells, const HeightFunction& height);
+
+    /// Height of the terrain at a world space (x, z), blended between the four corners of its cell.
+    GLfloat heightAt(GLfloat x, GLfloat z) const;
+
+    /// Unit normal of the terrain at a world space (x, z), blended between the four corners of its cell.
+    glm::vec3 normalAt(GLfloat x, GLfloat z) const;
+
+    /**
+     * Mesh generation
+     * Two triangles per cell, in world space, with the precomputed normals.
+     * @return the terrain mesh.
+     */
+    MeshData mesh() const;
+
+private:
+
+    /// Allocates a grid of columns x rows points.
+    void _resize(const glm::vec2& minCorner, const glm::vec2& size, GLuint columns, GLuint rows);
+
+    /// Normal of every point, from the slopes to its neighbours.
+    void _computeNormals();
+
+    /**
+     * Point location
+     * @param x, z : World space position, clamped to the terrain.
+     * @param corner : Index of the lowest corner of the cell holding the point.
+     * @param u, v : Position of the point in its cell along X and Z, from 0 to 1.
+     */
+    void _locate(GLfloat x, GLfloat z, std::size_t& corner, GLfloat& u, GLfloat& v) const;
+
+    /// World space (x, z) of the first point.
+    glm::vec2 _minCorner{0.0f};
+    /// Distance between two points along X and Z.
+    glm::vec2 _cellSize{1.0f};
+    /// Number of points along X and Z.
+    GLuint _columns = 0, _rows = 0;
+    /// Height of every point, row after row.
+    std::vector<GLfloat> _heights;
+    /// Unit normal of every point, row after row.
+    std::vector<glm::vec3> _normals;
+};
+
+#endif //MP_HEIGHTFIELD_H
@@ -0,0 +1,130 @@
+/**
+ * Engine helper class : ImpostorAtlas
+ *
+ * Pictures of an object taken from many directions over the upper hemisphere, laid out
+ * on a hemi-octahedral grid, so a far copy of the object can be drawn as a single card
+ * showing the picture taken from the closest direction.
+ */
+
+#include "ImpostorAtlas.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdio>
+
+
+ImpostorAtlas::~ImpostorAtlas() {
+    destroy();
+}
+
+void ImpostorAtlas::create(const GLsizei frameSize, const GLuint framesPerSide, const GLuint layerCount) {
+    destroy();
+    _frameSize = frameSize;
+    _framesPerSide = framesPerSide;
+    _layerCount = layerCount;
+    const GLsizei atlasSize = frameSize * static_cast<GLsizei>(framesPerSide);
+
+    // Same layout for both arrays, mipmapped since the cards shrink to a few pixels.
+    for (GLuint* texture : {&_albedoTexture, &_normalTexture}) {
+        glGenTextures(1, texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, *texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, atlasSize, atlasSize, static_cast<GLsizei>(layerCount), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenRenderbuffers(1, &_depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+
+    glGenFramebuffers(1, &_fbo);
+}
+
+void ImpostorAtlas::bake(const GLuint layer, const BoundingSphere& bounds, const std::function<void(const glm::mat4&)>& draw) {
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    const GLboolean blending = glIsEnabled(GL_BLEND);
+    glDisable(GL_BLEND);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, _albedoTexture, 0, static_cast<GLint>(layer));
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, _normalTexture, 0, static_cast<GLint>(layer));
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthRenderbuffer);
+    const GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "[ERROR]: Impostor atlas layer %u is incomplete\n", layer);
+    }
+
+    // Empty texels have no coverage, whatever the clear color of the scene.
+    const GLfloat transparent[] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const GLfloat farthest = 1.0f;
+    glClearBufferfv(GL_COLOR, 0, transparent);
+    glClearBufferfv(GL_COLOR, 1, transparent);
+    glClearBufferfv(GL_DEPTH, 0, &farthest);
+
+    // The sphere fills every frame, seen from twice its radius.
+    const GLfloat radius = bounds.radius;
+    const glm::mat4 projMtx = glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+    for (GLuint y = 0; y < _framesPerSide; y++) {
+        for (GLuint x = 0; x < _framesPerSide; x++) {
+            const glm::vec3 direction = frameDirection(x, y);
+            // Straight above, any horizontal up vector works as long as the shader picks the same.
+            const glm::vec3 up = std::abs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            const glm::mat4 viewMtx = glm::lookAt(bounds.center + direction * (2.0f * radius), bounds.center, up);
+
+            glViewport(static_cast<GLint>(x) * _frameSize, static_cast<GLint>(y) * _frameSize, _frameSize, _frameSize);
+            draw(projMtx * viewMtx);
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(previousFramebuffer));
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    if (blending) glEnable(GL_BLEND);
+}
+
+void ImpostorAtlas::finish() {
+    for (const GLuint texture : {_albedoTexture, _normalTexture}) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // The depth was only needed to bake.
+    if (_depthRenderbuffer) glDeleteRenderbuffers(1, &_depthRenderbuffer);
+    if (_fbo) glDeleteFramebuffers(1, &_fbo);
+    _depthRenderbuffer = _fbo = 0;
+}
+
+void ImpostorAtlas::bind(const GLuint albedoUnit) const {
+    glActiveTexture(GL_TEXTURE0 + albedoUnit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _albedoTexture);
+    glActiveTexture(GL_TEXTURE0 + albedoUnit + 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _normalTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void ImpostorAtlas::destroy() {
+    if (_albedoTexture) glDeleteTextures(1, &_albedoTexture);
+    if (_normalTexture) glDeleteTextures(1, &_normalTexture);
+    if (_depthRenderbuffer) glDeleteRenderbuffers(1, &_depthRenderbuffer);
+    if (_fbo) glDeleteFramebuffers(1, &_fbo);
+    _albedoTexture = _normalTexture = _depthRenderbuffer = _fbo = 0;
+}
+
+glm::vec3 ImpostorAtlas::frameDirection(const GLuint x, const GLuint y) const {
+    // Center of the frame in [-1, 1], rotated by 45 degrees onto the octahedron, whose top face covers it.
+    const GLfloat u = (static_cast<GLfloat>(x) + 0.5f) / static_cast<GLfloat>(_framesPerSide) * 2.0f - 1.0f;
+    const GLfloat v = (static_cast<GLfloat>(y) + 0.5f) / static_cast<GLfloat>(_framesPerSide) * 2.0f - 1.0f;
+    const GLfloat px = (u + v) * 0.5f;
+    const GLfloat pz = (u - v) * 0.5f;
+    return glm::normalize(glm::vec3(px, 1.0f - std::abs(px) - std::abs(pz), pz));
+}
@@ -0,0 +1,97 @@
+/**
+ * Engine helper header file : ImpostorAtlas
+ *
+ * Pictures of an object taken from many directions over the upper hemisphere, laid out
+ * on a hemi-octahedral grid, so a far copy of the object can be drawn as a single card
+ * showing the picture taken from the closest direction.
+ */
+
+#ifndef MP_IMPOSTOR_ATLAS_H
+#define MP_IMPOSTOR_ATLAS_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+
+#include "Frustum.h"
+
+/**
+ * Impostor Atlas
+ * Two texture arrays with one layer per object variant. The albedo layer keeps the weights of two
+ * materials (red and green) and the coverage (alpha), the normal layer keeps the world space normal,
+ * so the cards are colored and lit when drawn. Each layer is a grid of framesPerSide x framesPerSide
+ * frames, frame (x, y) being the picture seen from frameDirection(x, y). Only needs OpenGL 4.1.
+ */
+class ImpostorAtlas {
+public:
+
+    ImpostorAtlas() = default;
+    ~ImpostorAtlas();
+
+    ImpostorAtlas(const ImpostorAtlas&) = delete;
+    ImpostorAtlas& operator=(const ImpostorAtlas&) = delete;
+
+    /**
+     * Atlas creation
+     * @param frameSize : Width and height of a single frame in pixels.
+     * @param framesPerSide : Number of frames along each side of the grid.
+     * @param layerCount : Number of object variants.
+     */
+    void create(GLsizei frameSize, GLuint framesPerSide, GLuint layerCount);
+
+    /**
+     * Variant baking
+     * Renders every frame of a layer, the current framebuffer and viewport are restored afterwards.
+     * The draw function is called once per frame with an orthographic camera framing the bounds,
+     * it must write the albedo to output 0 and the normal to output 1.
+     * @param layer : Layer of the variant.
+     * @param bounds : Sphere enclosing the variant, the cards are drawn with the same sphere.
+     * @param draw : Draws the variant with the given projection times view matrix.
+     */
+    void bake(GLuint layer, const BoundingSphere& bounds, const std::function<void(const glm::mat4&)>& draw);
+
+    /// Builds the mipmaps once every layer is baked, far cards are only a few pixels wide.
+    void finish();
+
+    /**
+     * Textures binding
+     * @param albedoUnit : Texture unit receiving the albedo array, the normal array takes the next one.
+     */
+    void bind(GLuint albedoUnit) const;
+
+    /// Deletes the textures and the framebuffer.
+    void destroy();
+
+    /// Number of frames along each side of the grid.
+    GLuint getFramesPerSide() const { return _framesPerSide; }
+
+    /**
+     * Frame direction
+     * Hemi-octahedral mapping of the grid, the impostor shader inverts it.
+     * @param x : Column of the frame.
+     * @param y : Row of the frame.
+     * @return unit direction from the object towards the camera of the frame, never below the horizon.
+     */
+    glm::vec3 frameDirection(GLuint x, GLuint y) const;
+
+private:
+
+    /// Albedo weights and coverage, one layer per variant.
+    GLuint _albedoTexture = 0;
+    /// World space normals packed in [0, 1], one layer per variant.
+    GLuint _normalTexture = 0;
+    /// Depth shared by every layer, only needed while baking.
+    GLuint _depthRenderbuffer = 0;
+    /// Framebuffer the layers are attached to in turn.
+    GLuint _fbo = 0;
+
+    /// Size of a single frame in pixels.
+    GLsizei _frameSize = 0;
+    /// Number of frames along each side of the grid.
+    GLuint _framesPerSide = 0;
+    /// Number of variants.
+    GLuint _layerCount = 0;
+};
+
+#endif //MP_IMPOSTOR_ATLAS_H
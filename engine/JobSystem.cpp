@@ -0,0 +1,195 @@
+/**
+ * Engine helper class : JobSystem
+ *
+ * Pool of worker threads running small jobs of the frame update, each worker with
+ * its own queue and stealing from the others when it runs out of work.
+ */
+
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+
+/// Work of a job and what depends on it.
+struct JobSystem::Job {
+    /// Function run by the job.
+    std::function<void()> work;
+    /// Dependencies not finished yet, plus one while the job is being scheduled.
+    std::atomic<GLuint> pendingCount{1};
+    /// Guards the dependents and the finished flag while they are changed together.
+    std::mutex mutex;
+    /// Jobs waiting for this one.
+    std::vector<JobHandle> dependents;
+    /// Set once the work is done.
+    std::atomic<bool> finished{false};
+};
+
+/// System the current thread is a worker of, and its index there.
+static thread_local const JobSystem* currentSystem = nullptr;
+static thread_local GLuint currentWorker = 0;
+
+
+JobSystem::JobSystem(GLuint threadCount) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (GLuint i = 0; i < threadCount; i++) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    for (GLuint i = 1; i < threadCount; i++) {
+        _threads.emplace_back(&JobSystem::_workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(_sleepMutex);
+        _running = false;
+    }
+    _wakeUp.notify_all();
+    for (std::thread& thread : _threads) {
+        thread.join();
+    }
+}
+
+JobSystem::JobHandle JobSystem::schedule(std::function<void()> work, const std::vector<JobHandle>& dependencies) {
+    JobHandle job = std::make_shared<Job>();
+    job->work = std::move(work);
+
+    // Registered on each dependency still running, the last one to finish queues the job.
+    for (const JobHandle& dependency : dependencies) {
+        if (!dependency) continue;
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+        if (!dependency->finished) {
+            job->pendingCount++;
+            dependency->dependents.push_back(job);
+        }
+    }
+
+    // Dropping the scheduling count, queued right away when nothing was pending.
+    if (--job->pendingCount == 0) _push(job);
+    return job;
+}
+
+void JobSystem::wait(const JobHandle& job) {
+    if (!job) return;
+    const GLuint worker = _workerIndex();
+    while (!job->finished) {
+        if (!_runOne(worker)) std::this_thread::yield();
+    }
+}
+
+void JobSystem::parallelFor(const std::size_t count, std::size_t grain, const RangeFunction& body) {
+    if (count == 0) return;
+    grain = std::max<std::size_t>(grain, 1);
+    if (count <= grain || _workers.size() == 1) {
+        body(0, count);
+        return;
+    }
+
+    // The body outlives the jobs, they are all waited for before returning.
+    std::vector<JobHandle> ranges;
+    ranges.reserve(count / grain);
+    for (std::size_t first = grain; first < count; first += grain) {
+        const std::size_t last = std::min(first + grain, count);
+        ranges.push_back(schedule([&body, first, last]() { body(first, last); }));
+    }
+    body(0, grain);
+    for (const JobHandle& range : ranges) {
+        wait(range);
+    }
+}
+
+void JobSystem::_push(JobHandle job) {
+    Worker& worker = *_workers[_workerIndex()];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.jobs.push_back(std::move(job));
+    }
+    _queuedCount++;
+
+    // Taking the sleep mutex so a worker about to sleep cannot miss the notification.
+    { std::lock_guard<std::mutex> lock(_sleepMutex); }
+    _wakeUp.notify_one();
+}
+
+bool JobSystem::_runOne(const GLuint worker) {
+    JobHandle job;
+
+    // Newest job of its own queue first, still warm in the cache.
+    {
+        Worker& own = *_workers[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+        }
+    }
+
+    // Otherwise the oldest job of another worker, most likely the largest piece of work left.
+    for (std::size_t offset = 1; !job && offset < _workers.size(); offset++) {
+        Worker& victim = *_workers[(worker + offset) % _workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+        }
+    }
+
+    if (!job) return false;
+    _queuedCount--;
+    job->work();
+    _finish(job);
+    return true;
+}
+
+void JobSystem::_finish(const JobHandle& job) {
+    std::vector<JobHandle> dependents;
+    {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->finished = true;
+        dependents.swap(job->dependents);
+    }
+    for (JobHandle& dependent : dependents) {
+        if (--dependent->pendingCount == 0) _push(std::move(dependent));
+    }
+}
+
+void JobSystem::_workerLoop(const GLuint worker) {
+    currentSystem = this;
+    currentWorker = worker;
+    while (_running) {
+        if (_runOne(worker)) continue;
+
+        std::unique_lock<std::mutex> lock(_sleepMutex);
+        _wakeUp.wait(lock, [this]() { return !_running || _queuedCount > 0; });
+    }
+}
+
+GLuint JobSystem::_workerIndex() const {
+    return currentSystem == this ? currentWorker : 0;
+}
+
+void JobSystem::benchmark(GLuint maxThreads, const std::size_t count, const std::size_t grain, const GLuint repetitions, const RangeFunction& body) {
+    if (maxThreads == 0) maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    using Clock = std::chrono::steady_clock;
+
+    fprintf(stdout, "[INFO]: Job system scaling, %zu items in jobs of %zu, %u loops per thread count\n", count, grain, repetitions);
+    double singleThreadSeconds = 0.0;
+    for (GLuint threads = 1; threads <= maxThreads; threads++) {
+        JobSystem jobs(threads);
+
+        // One loop untimed, for the threads to start and the caches to warm up.
+        jobs.parallelFor(count, grain, body);
+        const Clock::time_point start = Clock::now();
+        for (GLuint repetition = 0; repetition < repetitions; repetition++) {
+            jobs.parallelFor(count, grain, body);
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count() / std::max(1u, repetitions);
+        if (threads == 1) singleThreadSeconds = seconds;
+
+        const double speedUp = singleThreadSeconds / seconds;
+        fprintf(stdout, "[INFO]:   %3u threads : %9.3f ms per loop, %6.2fx speed-up, %5.1f%% efficiency\n",
+                threads, seconds * 1e3, speedUp, 100.0 * speedUp / threads);
+    }
+}
@@ -0,0 +1,133 @@
+/**
+ * Engine helper header file : JobSystem
+ *
+ * Pool of worker threads running small jobs of the frame update, each worker with
+ * its own queue and stealing from the others when it runs out of work.
+ */
+
+#ifndef MP_JOB_SYSTEM_H
+#define MP_JOB_SYSTEM_H
+
+#include <glad/gl.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Job System
+ * The thread creating the system is worker 0, the others are threads of their own. A job is queued on the
+ * worker scheduling it, which takes its newest job first, while idle workers steal the oldest job of
+ * another worker. A job only starts once every job it depends on is finished, and waiting for a job runs
+ * other jobs meanwhile, so jobs may schedule and wait for more jobs. Jobs must not make OpenGL calls,
+ * the context belongs to the main thread.
+ */
+class JobSystem {
+public:
+
+    /// Work of a job and what depends on it.
+    struct Job;
+
+    /// Reference to a scheduled job, to wait for it or depend on it. Empty handles are always finished.
+    using JobHandle = std::shared_ptr<Job>;
+
+    /// Work of a range [first, last) of a parallel loop.
+    using RangeFunction = std::function<void(std::size_t first, std::size_t last)>;
+
+    /**
+     * System creation
+     * @param threadCount : Number of threads including the calling one, 0 for one per core.
+     */
+    explicit JobSystem(GLuint threadCount = 0);
+
+    /// Waits for the workers to finish their current job and joins them.
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    /**
+     * Job scheduling
+     * @param work : Function run by the job.
+     * @param dependencies : Jobs that must be finished before this one starts.
+     * @return handle of the new job.
+     */
+    JobHandle schedule(std::function<void()> work, const std::vector<JobHandle>& dependencies = {});
+
+    /**
+     * Job waiting
+     * Runs the queued jobs until the given one is finished.
+     * @param job : Job to wait for.
+     */
+    void wait(const JobHandle& job);
+
+    /**
+     * Parallel loop
+     * Splits [0, count) into ranges of grain items run as jobs, the calling thread taking the first
+     * one, and returns once every range is done.
+     * @param count : Number of items.
+     * @param grain : Number of items per job, large enough for a job to be worth scheduling.
+     * @param body : Work of a range of items, run by several threads at once.
+     */
+    void parallelFor(std::size_t count, std::size_t grain, const RangeFunction& body);
+
+    /// Number of threads running jobs, the calling one included.
+    GLuint getThreadCount() const { return static_cast<GLuint>(_workers.size()); }
+
+    /**
+     * Scaling benchmark
+     * Times the same parallel loop on systems of 1 to maxThreads threads, and prints the time per loop,
+     * the speed-up over a single thread and the efficiency (speed-up per thread) on stdout.
+     * @param maxThreads : Largest number of threads, 0 for one per core.
+     * @param count : Number of items of the loop.
+     * @param grain : Number of items per job.
+     * @param repetitions : Number of loops timed per thread count.
+     * @param body : Work of a range of items.
+     */
+    static void benchmark(GLuint maxThreads, std::size_t count, std::size_t grain, GLuint repetitions, const RangeFunction& body);
+
+private:
+
+    /// Queue of a worker, its owner works at the back and thieves at the front.
+    struct Worker {
+        std::deque<JobHandle> jobs;
+        std::mutex mutex;
+    };
+
+    /// Queues a job whose dependencies are finished on the calling worker.
+    void _push(JobHandle job);
+
+    /// Runs one job, from the worker's own queue or stolen from another. False when there was none.
+    bool _runOne(GLuint worker);
+
+    /// Marks a job finished and queues the dependents it was the last dependency of.
+    void _finish(const JobHandle& job);
+
+    /// Loop of the worker threads, sleeping while there is nothing to run.
+    void _workerLoop(GLuint worker);
+
+    /// Worker of the calling thread, threads outside the system share worker 0.
+    GLuint _workerIndex() const;
+
+    /// Queue of every worker.
+    std::vector<std::unique_ptr<Worker>> _workers;
+    /// Threads of the workers 1 and up.
+    std::vector<std::thread> _threads;
+
+    /// Cleared to stop the workers.
+    std::atomic<bool> _running{true};
+    /// Number of jobs waiting in any queue.
+    std::atomic<std::size_t> _queuedCount{0};
+    /// Idle workers sleep on it until a job is queued.
+    std::condition_variable _wakeUp;
+    /// Mutex of the sleeping workers.
+    std::mutex _sleepMutex;
+};
+
+#endif //MP_JOB_SYSTEM_H
@@ -0,0 +1,51 @@
+/**
+ * Engine helper class : LevelOfDetail
+ *
+ * Picks one of several pre-generated tessellations of an object from the size
+ * it covers on screen, with some hysteresis so objects do not pop back and forth.
+ */
+
+#include "LevelOfDetail.h"
+
+#include "AffineTransform.h"
+
+#include <algorithm>
+#include <utility>
+
+
+LodViewpoint::LodViewpoint(const glm::mat4& viewMtx, const glm::mat4& projMtx)
+    : position(AffineTransform(viewMtx).inverse().getTranslation()),
+      projectionScale(projMtx[1][1]) {}
+
+LodSelector::LodSelector(std::vector<GLfloat> screenSizes, const GLfloat hysteresis)
+    : _screenSizes(std::move(screenSizes)),
+      _hysteresis(hysteresis) {}
+
+GLuint LodSelector::select(const GLfloat screenSize, const GLuint currentLevel) const {
+    // Finer only once clearly bigger, coarser only once clearly smaller.
+    const GLuint finer = _levelFor(screenSize, 1.0f + _hysteresis);
+    if (finer < currentLevel) return finer;
+
+    const GLuint coarser = _levelFor(screenSize, 1.0f - _hysteresis);
+    if (coarser > currentLevel) return coarser;
+
+    return std::min(currentLevel, getLevelCount() - 1);
+}
+
+GLfloat LodSelector::screenSize(const BoundingSphere& bounds, const std::vector<LodViewpoint>& viewpoints) {
+    GLfloat size = 0.0f;
+    for (const LodViewpoint& viewpoint : viewpoints) {
+        // Projected radius, a camera inside the sphere sees it whole.
+        const GLfloat distance = std::max(glm::length(bounds.center - viewpoint.position), bounds.radius);
+        size = std::max(size, bounds.radius * viewpoint.projectionScale / distance);
+    }
+    return size;
+}
+
+GLuint LodSelector::_levelFor(const GLfloat screenSize, const GLfloat scale) const {
+    GLuint level = 0;
+    while (level < _screenSizes.size() && screenSize < _screenSizes[level] * scale) {
+        level++;
+    }
+    return level;
+}
@@ -0,0 +1,84 @@
+/**
+ * Engine helper header file : LevelOfDetail
+ *
+ * Picks one of several pre-generated tessellations of an object from the size
+ * it covers on screen, with some hysteresis so objects do not pop back and forth.
+ */
+
+#ifndef MP_LEVEL_OF_DETAIL_H
+#define MP_LEVEL_OF_DETAIL_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Frustum.h"
+
+/// Camera a level of detail is chosen for.
+struct LodViewpoint {
+    /// World space position of the camera.
+    glm::vec3 position;
+    /// Vertical scale of the projection, one over the tangent of half the field of view.
+    GLfloat projectionScale;
+
+    /**
+     * Viewpoint of a camera
+     * @param viewMtx : View matrix of the camera.
+     * @param projMtx : Perspective projection matrix of the camera.
+     */
+    LodViewpoint(const glm::mat4& viewMtx, const glm::mat4& projMtx);
+};
+
+/**
+ * Level Of Detail Selector
+ * Level 0 is the finest. Level i is kept while the object covers at least screenSizes[i],
+ * the last level below the last size. Sizes are radii relative to half the viewport height.
+ */
+class LodSelector {
+public:
+
+    /**
+     * Selector creation
+     * @param screenSizes : Decreasing screen sizes, one less than the number of levels.
+     * @param hysteresis : Fraction of a size the object must go past before its level changes.
+     */
+    explicit LodSelector(std::vector<GLfloat> screenSizes, GLfloat hysteresis = 0.2f);
+
+    /**
+     * Level selection
+     * @param screenSize : Size currently covered by the object.
+     * @param currentLevel : Level the object is drawn with so far.
+     * @return level to draw the object with.
+     */
+    GLuint select(GLfloat screenSize, GLuint currentLevel) const;
+
+    /// Number of levels.
+    GLuint getLevelCount() const { return static_cast<GLuint>(_screenSizes.size()) + 1; }
+
+    /// Decreasing screen sizes between the levels.
+    const std::vector<GLfloat>& getScreenSizes() const { return _screenSizes; }
+
+    /// Fraction of hysteresis around each size.
+    GLfloat getHysteresis() const { return _hysteresis; }
+
+    /**
+     * Screen size
+     * @param bounds : World space bounds of the object.
+     * @param viewpoints : Cameras drawing the object this frame.
+     * @return largest size covered by the object in any of the cameras.
+     */
+    static GLfloat screenSize(const BoundingSphere& bounds, const std::vector<LodViewpoint>& viewpoints);
+
+private:
+
+    /// First level whose size is reached, with every size scaled.
+    GLuint _levelFor(GLfloat screenSize, GLfloat scale) const;
+
+    /// Decreasing screen sizes.
+    std::vector<GLfloat> _screenSizes;
+    /// Fraction of hysteresis around each size.
+    GLfloat _hysteresis;
+};
+
+#endif //MP_LEVEL_OF_DETAIL_H
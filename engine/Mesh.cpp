@@ -0,0 +1,148 @@
+/**
+ * Engine helper class : Mesh
+ *
+ * Procedural geometry for the primitives our world is made of, and the
+ * per-instance data used to draw many copies of them in a single call.
+ */
+
+#include "Mesh.h"
+
+#include "AffineTransform.h"
+
+#include <glm/gtc/constants.hpp>
+
+
+// -------------------------------- MESH DATA --------------------------------
+
+void MeshData::append(const MeshData& other, const glm::mat4& transform) {
+    const GLuint offset = static_cast<GLuint>(vertices.size());
+    const glm::mat3 normalMtx = AffineTransform(transform).normalMatrix();
+
+    // Moving every vertex to its final place.
+    for (const MeshVertex& vertex : other.vertices) {
+        MeshVertex newVertex;
+        newVertex.position = glm::vec3(transform * glm::vec4(vertex.position, 1.0f));
+        newVertex.normal = glm::normalize(normalMtx * vertex.normal);
+        vertices.push_back(newVertex);
+    }
+
+    // Shifting the indices past the vertices already stored.
+    for (const GLuint index : other.indices) {
+        indices.push_back(index + offset);
+    }
+}
+
+BoundingSphere MeshData::bounds() const {
+    if (vertices.empty()) return {glm::vec3(0.0f), 0.0f};
+
+    glm::vec3 minCorner = vertices.front().position;
+    glm::vec3 maxCorner = minCorner;
+    for (const MeshVertex& vertex : vertices) {
+        minCorner = glm::min(minCorner, vertex.position);
+        maxCorner = glm::max(maxCorner, vertex.position);
+    }
+    return BoundingSphere::enclosing(minCorner, maxCorner);
+}
+
+MeshData MeshData::cylinder(const GLfloat base, const GLfloat top, const GLfloat height, const GLint stacks, const GLint slices) {
+    MeshData mesh;
+
+    // Slope of the side, used to tilt the normals of cones.
+    const glm::vec2 side = glm::normalize(glm::vec2(height, base - top));
+
+    // Rings of vertices from the bottom to the top.
+    for (GLint i = 0; i <= stacks; i++) {
+        const GLfloat t = static_cast<GLfloat>(i) / static_cast<GLfloat>(stacks);
+        const GLfloat radius = base + (top - base) * t;
+        for (GLint j = 0; j <= slices; j++) {
+            const GLfloat theta = glm::two_pi<GLfloat>() * static_cast<GLfloat>(j) / static_cast<GLfloat>(slices);
+            MeshVertex vertex;
+            vertex.position = glm::vec3(radius * sinf(theta), height * t, radius * cosf(theta));
+            vertex.normal = glm::vec3(side.x * sinf(theta), side.y, side.x * cosf(theta));
+            mesh.vertices.push_back(vertex);
+        }
+    }
+
+    // Two triangles for each quad between two rings.
+    const GLuint ringSize = slices + 1;
+    for (GLint i = 0; i < stacks; i++) {
+        for (GLint j = 0; j < slices; j++) {
+            const GLuint bottomLeft = i * ringSize + j;
+            const GLuint topLeft = bottomLeft + ringSize;
+            mesh.indices.insert(mesh.indices.end(), {bottomLeft, bottomLeft + 1, topLeft});
+            mesh.indices.insert(mesh.indices.end(), {topLeft, bottomLeft + 1, topLeft + 1});
+        }
+    }
+
+    return mesh;
+}
+
+MeshData MeshData::cone(const GLfloat base, const GLfloat height, const GLint stacks, const GLint slices) {
+    return cylinder(base, 0.0f, height, stacks, slices);
+}
+
+MeshData MeshData::sphere(const GLfloat radius, const GLint stacks, const GLint slices) {
+    return _sphereSection(radius, glm::pi<GLfloat>(), stacks, slices);
+}
+
+MeshData MeshData::cube(const GLfloat size) {
+    MeshData mesh;
+    const GLfloat half = size / 2.0f;
+
+    // Normal, and the two axes spanning each face.
+    const glm::vec3 faces[6][3] = {
+            { { 1, 0, 0}, { 0, 0,-1}, { 0, 1, 0} },
+            { {-1, 0, 0}, { 0, 0, 1}, { 0, 1, 0} },
+            { { 0, 1, 0}, { 1, 0, 0}, { 0, 0,-1} },
+            { { 0,-1, 0}, { 1, 0, 0}, { 0, 0, 1} },
+            { { 0, 0, 1}, { 1, 0, 0}, { 0, 1, 0} },
+            { { 0, 0,-1}, {-1, 0, 0}, { 0, 1, 0} }
+    };
+
+    for (const auto& face : faces) {
+        const glm::vec3& normal = face[0];
+        const glm::vec3& u = face[1];
+        const glm::vec3& v = face[2];
+        const GLuint offset = static_cast<GLuint>(mesh.vertices.size());
+
+        // Four corners, counter-clockwise seen from outside.
+        mesh.vertices.push_back({(normal - u - v) * half, normal});
+        mesh.vertices.push_back({(normal + u - v) * half, normal});
+        mesh.vertices.push_back({(normal + u + v) * half, normal});
+        mesh.vertices.push_back({(normal - u + v) * half, normal});
+
+        mesh.indices.insert(mesh.indices.end(), {offset, offset + 1, offset + 2,   offset + 2, offset + 3, offset});
+    }
+
+    return mesh;
+}
+
+MeshData MeshData::_sphereSection(const GLfloat radius, const GLfloat maxPhi, const GLint stacks, const GLint slices) {
+    MeshData mesh;
+
+    // Rings of vertices from the north pole downwards.
+    for (GLint i = 0; i <= stacks; i++) {
+        const GLfloat phi = maxPhi * static_cast<GLfloat>(i) / static_cast<GLfloat>(stacks);
+        for (GLint j = 0; j <= slices; j++) {
+            const GLfloat theta = glm::two_pi<GLfloat>() * static_cast<GLfloat>(j) / static_cast<GLfloat>(slices);
+            MeshVertex vertex;
+            vertex.normal = glm::vec3(sinf(phi) * sinf(theta), cosf(phi), sinf(phi) * cosf(theta));
+            vertex.position = vertex.normal * radius;
+            mesh.vertices.push_back(vertex);
+        }
+    }
+
+    // Two triangles for each quad between two rings.
+    const GLuint ringSize = slices + 1;
+    for (GLint i = 0; i < stacks; i++) {
+        for (GLint j = 0; j < slices; j++) {
+            const GLuint topLeft = i * ringSize + j;
+            const GLuint bottomLeft = topLeft + ringSize;
+            mesh.indices.insert(mesh.indices.end(), {bottomLeft, bottomLeft + 1, topLeft});
+            mesh.indices.insert(mesh.indices.end(), {topLeft, bottomLeft + 1, topLeft + 1});
+        }
+    }
+
+    return mesh;
+}
+
@@ -0,0 +1,118 @@
+/**
+ * Engine helper header file : Mesh
+ *
+ * Procedural geometry for the primitives our world is made of, and the
+ * per-instance data used to draw many copies of them in a single call.
+ */
+
+#ifndef MP_MESH_H
+#define MP_MESH_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Frustum.h"
+
+/// Vertex layout shared by every procedural mesh.
+struct MeshVertex {
+    /// Object space position.
+    glm::vec3 position;
+    /// Object space normal.
+    glm::vec3 normal;
+};
+
+/**
+ * Mesh Data
+ * CPU side vertices and triangle indices of a mesh, before being sent to the GPU.
+ */
+struct MeshData {
+    /// List of vertices.
+    std::vector<MeshVertex> vertices;
+    /// Triangle list indices into the vertex list.
+    std::vector<GLuint> indices;
+
+    /**
+     * Mesh merging
+     * Appends another mesh to this one, transforming its vertices and normals.
+     * @param other : Mesh to append.
+     * @param transform : Model matrix applied to the appended vertices.
+     */
+    void append(const MeshData& other, const glm::mat4& transform);
+
+    /// Sphere enclosing every vertex, in the space of the mesh.
+    BoundingSphere bounds() const;
+
+    /**
+     * Cylinder generation
+     * Same shape as CSCI441::drawSolidCylinder, an open tube from y = 0 to y = height.
+     * @param base : Radius at the bottom.
+     * @param top : Radius at the top.
+     * @param height : Height of the cylinder.
+     * @param stacks : Number of vertical subdivisions.
+     * @param slices : Number of subdivisions around the Y axis.
+     */
+    static MeshData cylinder(GLfloat base, GLfloat top, GLfloat height, GLint stacks, GLint slices);
+
+    /**
+     * Cone generation
+     * Same shape as CSCI441::drawSolidCone, base at y = 0 and tip at y = height.
+     * @param base : Radius at the bottom.
+     * @param height : Height of the cone.
+     * @param stacks : Number of vertical subdivisions.
+     * @param slices : Number of subdivisions around the Y axis.
+     */
+    static MeshData cone(GLfloat base, GLfloat height, GLint stacks, GLint slices);
+
+    /**
+     * Sphere generation
+     * Same shape as CSCI441::drawSolidSphere, centered at the origin.
+     * @param radius : Radius of the sphere.
+     * @param stacks : Number of subdivisions from pole to pole.
+     * @param slices : Number of subdivisions around the Y axis.
+     */
+    static MeshData sphere(GLfloat radius, GLint stacks, GLint slices);
+
+    /**
+     * Cube generation
+     * Same shape as CSCI441::drawSolidCube, centered at the origin with flat shaded faces.
+     * @param size : Length of the cube sides.
+     */
+    static MeshData cube(GLfloat size);
+
+private:
+
+    /// Sphere section from the north pole down to the polar angle maxPhi.
+    static MeshData _sphereSection(GLfloat radius, GLfloat maxPhi, GLint stacks, GLint slices);
+};
+
+/// Per-instance data read by the lighting shader when drawing instanced meshes.
+struct InstanceData {
+    /// Model matrix of the instance.
+    glm::mat4 modelMatrix;
+    /// Precomputed normal matrix of the instance.
+    glm::mat3 normalMatrix;
+    /// Material color of the instance.
+    glm::vec3 color;
+};
+
+/// Attribute locations used to feed a mesh to the lighting shader.
+struct MeshAttributeLocations {
+    /// Vertex position location
+    GLint vPos;
+    /// Vertex normal location
+    GLint vertexNormal;
+    /// Instance model matrix location (first of four columns)
+    GLint instanceModelMatrix;
+    /// Instance normal matrix location (first of three columns)
+    GLint instanceNormalMatrix;
+    /// Instance color location
+    GLint instanceColor;
+    /// Vertex color location
+    GLint vertexColor;
+    /// Vertex part index location (transform palette entry)
+    GLint partIndex;
+};
+
+#endif //MP_MESH_H
@@ -0,0 +1,136 @@
+/**
+ * Engine helper class : OcclusionBuffer
+ *
+ * Low resolution depth of the big occluders of a view, read back once and reduced
+ * into a hierarchical depth pyramid, so objects hidden behind them can be skipped
+ * before they are drawn.
+ */
+
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+
+OcclusionBuffer::~OcclusionBuffer() {
+    destroy();
+}
+
+void OcclusionBuffer::create(const GLsizei width, const GLsizei height) {
+    destroy();
+
+    glGenRenderbuffers(1, &_depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    // Depth only, without any color to write or read.
+    glGenFramebuffers(1, &_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthRenderbuffer);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "[ERROR]: Occlusion buffer %dx%d is incomplete\n", width, height);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // Every level half the size of the previous one, down to a single texel.
+    GLsizei levelWidth = width;
+    GLsizei levelHeight = height;
+    while (true) {
+        _levels.push_back({levelWidth, levelHeight, std::vector<GLfloat>(static_cast<std::size_t>(levelWidth * levelHeight), 1.0f)});
+        if (levelWidth == 1 && levelHeight == 1) break;
+        levelWidth = std::max(1, (levelWidth + 1) / 2);
+        levelHeight = std::max(1, (levelHeight + 1) / 2);
+    }
+}
+
+void OcclusionBuffer::begin() {
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &_previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, _previousViewport);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glViewport(0, 0, _levels.front().width, _levels.front().height);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void OcclusionBuffer::end(const glm::mat4& viewProjectionMtx) {
+    _viewProjectionMtx = viewProjectionMtx;
+
+    // The target is small enough for the wait on the occluders to stay short.
+    Level& base = _levels.front();
+    glReadPixels(0, 0, base.width, base.height, GL_DEPTH_COMPONENT, GL_FLOAT, base.depth.data());
+
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(_previousFramebuffer));
+    glViewport(_previousViewport[0], _previousViewport[1], _previousViewport[2], _previousViewport[3]);
+
+    // Furthest depth of the (up to) four texels below, odd sizes keep their last row and column.
+    for (std::size_t l = 1; l < _levels.size(); l++) {
+        const Level& below = _levels[l - 1];
+        Level& level = _levels[l];
+        for (GLsizei y = 0; y < level.height; y++) {
+            const GLsizei y0 = std::min(2 * y, below.height - 1);
+            const GLsizei y1 = std::min(2 * y + 1, below.height - 1);
+            for (GLsizei x = 0; x < level.width; x++) {
+                const GLsizei x0 = std::min(2 * x, below.width - 1);
+                const GLsizei x1 = std::min(2 * x + 1, below.width - 1);
+                level.depth[y * level.width + x] = std::max({below.depth[y0 * below.width + x0], below.depth[y0 * below.width + x1],
+                                                             below.depth[y1 * below.width + x0], below.depth[y1 * below.width + x1]});
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::isOccluded(const BoundingSphere& sphere) const {
+    if (_levels.empty()) return false;
+
+    // Screen rectangle and closest depth of the box around the sphere.
+    glm::vec3 minNdc(1.0f);
+    glm::vec3 maxNdc(-1.0f);
+    bool first = true;
+    for (GLuint corner = 0; corner < 8; corner++) {
+        const glm::vec3 offset((corner & 1) ? sphere.radius : -sphere.radius,
+                               (corner & 2) ? sphere.radius : -sphere.radius,
+                               (corner & 4) ? sphere.radius : -sphere.radius);
+        const glm::vec4 clip = _viewProjectionMtx * glm::vec4(sphere.center + offset, 1.0f);
+
+        // Crossing the camera plane, the rectangle is unbounded.
+        if (clip.w <= 1e-4f) return false;
+
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        minNdc = first ? ndc : glm::min(minNdc, ndc);
+        maxNdc = first ? ndc : glm::max(maxNdc, ndc);
+        first = false;
+    }
+    const GLfloat closestDepth = minNdc.z * 0.5f + 0.5f;
+    if (closestDepth <= 0.0f) return false;
+
+    const Level& base = _levels.front();
+    const GLint x0 = std::clamp(static_cast<GLint>(std::floor((minNdc.x * 0.5f + 0.5f) * base.width)), 0, base.width - 1);
+    const GLint x1 = std::clamp(static_cast<GLint>(std::floor((maxNdc.x * 0.5f + 0.5f) * base.width)), 0, base.width - 1);
+    const GLint y0 = std::clamp(static_cast<GLint>(std::floor((minNdc.y * 0.5f + 0.5f) * base.height)), 0, base.height - 1);
+    const GLint y1 = std::clamp(static_cast<GLint>(std::floor((maxNdc.y * 0.5f + 0.5f) * base.height)), 0, base.height - 1);
+
+    // Coarsest level where the rectangle still spans two texels or less in each direction.
+    std::size_t l = 0;
+    while (l + 1 < _levels.size() && ((x1 >> l) - (x0 >> l) > 1 || (y1 >> l) - (y0 >> l) > 1)) {
+        l++;
+    }
+
+    const Level& level = _levels[l];
+    for (GLint y = y0 >> l; y <= (y1 >> l); y++) {
+        for (GLint x = x0 >> l; x <= (x1 >> l); x++) {
+            if (closestDepth <= level.depth[y * level.width + x]) return false;
+        }
+    }
+    return true;
+}
+
+void OcclusionBuffer::destroy() {
+    if (_fbo) glDeleteFramebuffers(1, &_fbo);
+    if (_depthRenderbuffer) glDeleteRenderbuffers(1, &_depthRenderbuffer);
+    _fbo = _depthRenderbuffer = 0;
+    _levels.clear();
+}
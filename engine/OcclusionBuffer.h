@@ -0,0 +1,87 @@
+/**
+ * Engine helper header file : OcclusionBuffer
+ *
+ * Low resolution depth of the big occluders of a view, read back once and reduced
+ * into a hierarchical depth pyramid, so objects hidden behind them can be skipped
+ * before they are drawn.
+ */
+
+#ifndef MP_OCCLUSION_BUFFER_H
+#define MP_OCCLUSION_BUFFER_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Frustum.h"
+
+/**
+ * Occlusion Buffer
+ * Depth-only framebuffer the occluders are drawn into between begin and end. Every level of the
+ * pyramid keeps the furthest depth of the four texels below it, so a single texel tells whether
+ * everything behind a region is hidden. Only needs OpenGL 4.1, no compute shaders.
+ */
+class OcclusionBuffer {
+public:
+
+    OcclusionBuffer() = default;
+    ~OcclusionBuffer();
+
+    OcclusionBuffer(const OcclusionBuffer&) = delete;
+    OcclusionBuffer& operator=(const OcclusionBuffer&) = delete;
+
+    /**
+     * Buffer creation
+     * @param width : Width of the depth target, whatever the size of the view.
+     * @param height : Height of the depth target.
+     */
+    void create(GLsizei width, GLsizei height);
+
+    /// Binds and clears the depth target, the current framebuffer and viewport are restored by end.
+    void begin();
+
+    /**
+     * Pyramid building
+     * Reads the depth of the occluders back and reduces it level by level.
+     * @param viewProjectionMtx : Projection times view matrix the occluders were drawn with.
+     */
+    void end(const glm::mat4& viewProjectionMtx);
+
+    /**
+     * Occlusion test
+     * @param sphere : World space bounding sphere.
+     * @return true only when the box around the sphere is behind the occluders everywhere it covers.
+     */
+    bool isOccluded(const BoundingSphere& sphere) const;
+
+    /// Deletes the framebuffer.
+    void destroy();
+
+private:
+
+    /// Reduced depth, level 0 being the depth read back.
+    struct Level {
+        GLsizei width;
+        GLsizei height;
+        std::vector<GLfloat> depth;
+    };
+
+    /// Depth-only framebuffer object
+    GLuint _fbo = 0;
+    /// Depth attachment
+    GLuint _depthRenderbuffer = 0;
+
+    /// Levels of the pyramid, from the finest.
+    std::vector<Level> _levels;
+
+    /// Matrix of the occluders, the tested spheres are projected with it.
+    glm::mat4 _viewProjectionMtx{1.0f};
+
+    /// Framebuffer bound before begin.
+    GLint _previousFramebuffer = 0;
+    /// Viewport set before begin.
+    GLint _previousViewport[4] = {0, 0, 0, 0};
+};
+
+#endif //MP_OCCLUSION_BUFFER_H
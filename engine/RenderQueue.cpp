@@ -0,0 +1,452 @@
+/**
+ * Engine helper class : RenderQueue
+ *
+ * Single place where the scene hands over everything it wants drawn in a frame.
+ * Draw packets are sorted by pass, shader program, state, mesh and distance to the camera,
+ * then packets sharing a mesh are merged into instanced draws submitted with as few calls
+ * as possible, their instances front to back.
+ * The sorted frame is prepared once and executed for every view.
+ * Groups of static instances can be culled by a compute shader instead, on OpenGL 4.3+.
+ */
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+
+// -------------------------------- SETUP --------------------------------
+
+RenderQueue::~RenderQueue() {
+    destroy();
+}
+
+RenderQueue::MeshHandle RenderQueue::addMesh(const MeshData& mesh) {
+    MeshRange range;
+    range.firstIndex = static_cast<GLuint>(_geometry.indices.size());
+    range.indexCount = static_cast<GLuint>(mesh.indices.size());
+    range.baseVertex = static_cast<GLint>(_geometry.vertices.size());
+
+    // Indices stay relative to the mesh, the base vertex moves them when drawing.
+    _geometry.vertices.insert(_geometry.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+    _geometry.indices.insert(_geometry.indices.end(), mesh.indices.begin(), mesh.indices.end());
+
+    _meshes.push_back(range);
+    return static_cast<MeshHandle>(_meshes.size() - 1);
+}
+
+RenderQueue::StateHandle RenderQueue::addState(const GLuint programHandle, ViewFunction bind, std::function<void()> unbind) {
+    _states.push_back({programHandle, std::move(bind), std::move(unbind)});
+    return static_cast<StateHandle>(_states.size() - 1);
+}
+
+void RenderQueue::upload(const MeshAttributeLocations& locations, StreamBuffer* streamBuffer) {
+    _locations = locations;
+    _streamBuffer = streamBuffer;
+
+    // Multi-draw indirect is core since OpenGL 4.3, older contexts loop over the commands.
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    _multiDrawIndirect = (major == 4 && minor >= 3) || major > 4;
+
+    // Compute shaders and storage buffers came with the same version.
+    _gpuCulling = _multiDrawIndirect;
+
+    glGenVertexArrays(1, &_vao);
+    glBindVertexArray(_vao);
+
+    // Geometry of every registered mesh.
+    glGenBuffers(1, &_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_geometry.vertices.size() * sizeof(MeshVertex)), _geometry.vertices.data(), GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(locations.vPos);
+    glVertexAttribPointer(locations.vPos, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, position));
+
+    glEnableVertexAttribArray(locations.vertexNormal);
+    glVertexAttribPointer(locations.vertexNormal, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, normal));
+
+    glGenBuffers(1, &_ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(_geometry.indices.size() * sizeof(GLuint)), _geometry.indices.data(), GL_STATIC_DRAW);
+
+    // Per-draw data, advancing once per instance. The base instance of each command picks its range.
+    // The data itself is streamed every frame, prepare points the attributes at it.
+    for (GLint column = 0; column < 4; column++) {
+        glEnableVertexAttribArray(locations.instanceModelMatrix + column);
+        glVertexAttribDivisor(locations.instanceModelMatrix + column, 1);
+    }
+    for (GLint column = 0; column < 3; column++) {
+        glEnableVertexAttribArray(locations.instanceNormalMatrix + column);
+        glVertexAttribDivisor(locations.instanceNormalMatrix + column, 1);
+    }
+    glEnableVertexAttribArray(locations.instanceColor);
+    glVertexAttribDivisor(locations.instanceColor, 1);
+
+    glBindVertexArray(0);
+
+    // The geometry is on the GPU now.
+    _geometry = MeshData();
+}
+
+void RenderQueue::setCullProgram(const GLuint programHandle) {
+    _cullProgram = programHandle;
+    _cullLocations.frustumPlanes = glGetUniformLocation(programHandle, "frustumPlanes");
+    _cullLocations.cameraPosition = glGetUniformLocation(programHandle, "cameraPosition");
+    _cullLocations.projectionScale = glGetUniformLocation(programHandle, "projectionScale");
+    _cullLocations.lodScreenSizes = glGetUniformLocation(programHandle, "lodScreenSizes");
+    _cullLocations.lodLevelCount = glGetUniformLocation(programHandle, "lodLevelCount");
+    _cullLocations.hysteresis = glGetUniformLocation(programHandle, "hysteresis");
+    _cullLocations.instanceCount = glGetUniformLocation(programHandle, "instanceCount");
+    _cullLocations.viewSlot = glGetUniformLocation(programHandle, "viewSlot");
+    _cullLocations.minScreenSize = glGetUniformLocation(programHandle, "minScreenSize");
+}
+
+RenderQueue::GroupHandle RenderQueue::addGpuGroup(const StateHandle state, const std::vector<MeshHandle>& lodMeshes,
+                                                  const LodSelector& lodSelector, const std::vector<InstanceData>& instances,
+                                                  const std::vector<BoundingSphere>& bounds) {
+    GpuGroup group{};
+    group.state = state;
+    group.instanceCount = static_cast<GLuint>(instances.size());
+    group.levelCount = std::min(static_cast<GLuint>(lodMeshes.size()), MAX_GROUP_LOD_LEVELS);
+    for (GLuint level = 0; level + 1 < group.levelCount; level++) {
+        group.lodScreenSizes[level] = level < lodSelector.getScreenSizes().size() ? lodSelector.getScreenSizes()[level] : 0.0f;
+    }
+    group.hysteresis = lodSelector.getHysteresis();
+
+    // Centers and radii packed as vec4, the layout of the shader.
+    std::vector<glm::vec4> spheres;
+    spheres.reserve(bounds.size());
+    group.bounds = bounds.empty() ? BoundingSphere{glm::vec3(0.0f), 0.0f} : bounds.front();
+    for (const BoundingSphere& sphere : bounds) {
+        spheres.emplace_back(sphere.center, sphere.radius);
+        group.bounds = group.bounds.merged(sphere);
+    }
+
+    // One command per level, its survivors placed after its base instance.
+    for (GLuint level = 0; level < group.levelCount; level++) {
+        const MeshRange& range = _meshes[lodMeshes[level]];
+        group.emptyCommands.insert(group.emptyCommands.end(),
+            {range.indexCount, 0u, range.firstIndex, static_cast<GLuint>(range.baseVertex), level * group.instanceCount});
+    }
+
+    const std::size_t instanceBytes = instances.size() * sizeof(InstanceData);
+    glGenBuffers(1, &group.instanceBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, group.instanceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(instanceBytes), instances.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &group.boundsBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, group.boundsBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(spheres.size() * sizeof(glm::vec4)), spheres.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &group.visibleBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, group.visibleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(group.levelCount * instanceBytes), nullptr, GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &group.commandBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, group.commandBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(group.emptyCommands.size() * sizeof(GLuint)), group.emptyCommands.data(), GL_DYNAMIC_DRAW);
+
+    // Every instance starts with the finest level.
+    const std::vector<GLuint> levels(GROUP_VIEW_SLOTS * instances.size(), 0);
+    glGenBuffers(1, &group.levelBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, group.levelBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<GLsizeiptr>(levels.size() * sizeof(GLuint)), levels.data(), GL_DYNAMIC_COPY);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    _groups.push_back(std::move(group));
+    return static_cast<GroupHandle>(_groups.size() - 1);
+}
+
+
+// -------------------------------- SUBMISSION --------------------------------
+
+void RenderQueue::submit(const RenderPass pass, const StateHandle state, const MeshHandle mesh, const InstanceData& instance,
+                         const BoundingSphere& bounds) {
+    const GLuint program = _states[state].program;
+    _packets.push_back({_sortKey(pass, program, state, mesh), state, mesh, static_cast<GLuint>(_instances.size()), MESH_PACKET, program, ALL_VIEWS, bounds});
+    _instances.push_back(instance);
+}
+
+void RenderQueue::submit(const RenderPass pass, const GLuint programHandle, ViewFunction draw, const ViewMask views,
+                         const BoundingSphere& bounds) {
+    _packets.push_back({_sortKey(pass, programHandle, NO_STATE, 0), NO_STATE, 0, static_cast<GLuint>(_customDraws.size()), CUSTOM_PACKET, programHandle, views, bounds});
+    _customDraws.push_back(std::move(draw));
+}
+
+void RenderQueue::submitGroup(const RenderPass pass, const GroupHandle group) {
+    const StateHandle state = _groups[group].state;
+    const GLuint program = _states[state].program;
+    _packets.push_back({_sortKey(pass, program, state, 0), state, 0, group, GROUP_PACKET, program, ALL_VIEWS, _groups[group].bounds});
+}
+
+void RenderQueue::prepare(const glm::vec3& cameraPosition) {
+    for (Packet& packet : _packets) {
+        // Distance to the closest point of the bounds, zero from inside. The bits of a positive float
+        // sort like its value, the top 20 keep the exponent and enough of the mantissa.
+        const GLfloat distance = std::max(glm::length(packet.bounds.center - cameraPosition) - packet.bounds.radius, 0.0f);
+        GLuint bits;
+        std::memcpy(&bits, &distance, sizeof(bits));
+        packet.key = (packet.key & ~GLuint64(0xFFFFF)) | ((bits >> 11) & 0xFFFFF);
+    }
+
+    // Stable, so custom packets at the same distance keep their submission order.
+    std::stable_sort(_packets.begin(), _packets.end(),
+                     [](const Packet& a, const Packet& b) { return a.key < b.key; });
+}
+
+void RenderQueue::execute(const glm::mat4& viewMtx, const glm::mat4& projMtx, const ViewMask view,
+                          const OcclusionBuffer* occlusion) {
+    _drawCallCount = 0;
+    const Frustum frustum(projMtx * viewMtx);
+    const LodViewpoint viewpoint(viewMtx, projMtx);
+
+    // Half the viewport height covers a screen size of one.
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    _cameraPosition = viewpoint.position;
+    _pixelScale = viewpoint.projectionScale * static_cast<GLfloat>(viewport[3]) * 0.5f;
+
+    _build(frustum, view, occlusion);
+    _cullGroups(frustum, viewpoint, view);
+
+    // Executing the batches, changing program only when the sorted keys do.
+    GLuint currentProgram = 0;
+    for (const Batch& batch : _batches) {
+        if (batch.program != currentProgram) {
+            glUseProgram(batch.program);
+            currentProgram = batch.program;
+        }
+
+        if (batch.custom >= 0) {
+            _customDraws[batch.custom](viewMtx, projMtx);
+            _drawCallCount++;
+            continue;
+        }
+
+        const State& state = _states[batch.state];
+        state.bind(viewMtx, projMtx);
+        glBindVertexArray(_vao);
+
+        if (batch.group >= 0) {
+            _drawGroup(_groups[batch.group]);
+            _drawCallCount++;
+        } else if (_multiDrawIndirect) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandRange.buffer);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                        (void*)(_commandRange.offset + batch.firstCommand * sizeof(DrawCommand)),
+                                        static_cast<GLsizei>(batch.commandCount), 0);
+            _drawCallCount++;
+        } else {
+            // Without base instances the per-draw attributes are moved to the first instance of each command.
+            glBindBuffer(GL_ARRAY_BUFFER, _instanceRange.buffer);
+            for (GLuint i = 0; i < batch.commandCount; i++) {
+                const DrawCommand& command = _commands[batch.firstCommand + i];
+                _pointInstanceAttributes(_instanceRange.offset + command.baseInstance * sizeof(InstanceData));
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(command.count), GL_UNSIGNED_INT,
+                                                  (void*)(command.firstIndex * sizeof(GLuint)),
+                                                  static_cast<GLsizei>(command.instanceCount), command.baseVertex);
+                _drawCallCount++;
+            }
+        }
+
+        state.unbind();
+    }
+}
+
+void RenderQueue::clear() {
+    _packets.clear();
+    _instances.clear();
+    _customDraws.clear();
+}
+
+void RenderQueue::destroy() {
+    for (GpuGroup& group : _groups) {
+        const GLuint buffers[] = {group.instanceBuffer, group.boundsBuffer, group.visibleBuffer, group.commandBuffer, group.levelBuffer};
+        glDeleteBuffers(5, buffers);
+    }
+    _groups.clear();
+
+    if (_vao) glDeleteVertexArrays(1, &_vao);
+    if (_vbo) glDeleteBuffers(1, &_vbo);
+    if (_ibo) glDeleteBuffers(1, &_ibo);
+    _vao = _vbo = _ibo = 0;
+}
+
+
+// -------------------------------- PRIVATE --------------------------------
+
+void RenderQueue::_build(const Frustum& frustum, const ViewMask view, const OcclusionBuffer* occlusion) {
+    _sortedInstances.clear();
+    _commands.clear();
+    _batches.clear();
+    _culledCount = 0;
+    _occludedCount = 0;
+    _smallCount = 0;
+
+    // Merging consecutive visible packets: same state means same batch, same mesh means same command.
+    MeshHandle lastMesh = 0;
+    for (const Packet& packet : _packets) {
+        if (!(packet.views & view)) continue;
+        if (!frustum.intersects(packet.bounds)) {
+            _culledCount++;
+            continue;
+        }
+        // GPU groups test their own instances.
+        if (packet.type != GROUP_PACKET && _pixelRadius(packet.bounds) < _contributionThreshold) {
+            _smallCount++;
+            continue;
+        }
+        // Custom packets may be the occluders themselves.
+        if (occlusion && packet.type == MESH_PACKET && occlusion->isOccluded(packet.bounds)) {
+            _occludedCount++;
+            continue;
+        }
+
+        if (packet.type == CUSTOM_PACKET) {
+            _batches.push_back({packet.program, NO_STATE, 0, 0, static_cast<GLint>(packet.payload), -1});
+            continue;
+        }
+        if (packet.type == GROUP_PACKET) {
+            _batches.push_back({packet.program, packet.state, 0, 0, -1, static_cast<GLint>(packet.payload)});
+            continue;
+        }
+
+        const Batch* last = _batches.empty() ? nullptr : &_batches.back();
+        if (!last || last->custom >= 0 || last->group >= 0 || last->state != packet.state) {
+            _batches.push_back({packet.program, packet.state, static_cast<GLuint>(_commands.size()), 0, -1, -1});
+        }
+
+        Batch& batch = _batches.back();
+        if (batch.commandCount == 0 || lastMesh != packet.mesh) {
+            const MeshRange& range = _meshes[packet.mesh];
+            _commands.push_back({range.indexCount, 0, range.firstIndex, range.baseVertex, static_cast<GLuint>(_sortedInstances.size())});
+            batch.commandCount++;
+            lastMesh = packet.mesh;
+        }
+
+        _commands.back().instanceCount++;
+        _sortedInstances.push_back(_instances[packet.payload]);
+    }
+
+    // Writing the per-draw data and the commands of the view straight into the stream buffer.
+    if (!_sortedInstances.empty()) {
+        const GLsizeiptr instanceBytes = static_cast<GLsizeiptr>(_sortedInstances.size() * sizeof(InstanceData));
+        const GLsizeiptr commandBytes = _multiDrawIndirect ? static_cast<GLsizeiptr>(_commands.size() * sizeof(DrawCommand)) : 0;
+
+        // Both in the same buffer, even if it has to grow.
+        _streamBuffer->reserve(instanceBytes + commandBytes);
+        _instanceRange = _streamBuffer->write(_sortedInstances.data(), instanceBytes, 16);
+        if (_multiDrawIndirect) {
+            _commandRange = _streamBuffer->write(_commands.data(), commandBytes);
+        }
+
+        glBindVertexArray(_vao);
+        glBindBuffer(GL_ARRAY_BUFFER, _instanceRange.buffer);
+        _pointInstanceAttributes(_instanceRange.offset);
+    }
+}
+
+void RenderQueue::_cullGroups(const Frustum& frustum, const LodViewpoint& viewpoint, const ViewMask view) {
+    if (!_cullProgram) return;
+
+    // Views after the last slot share it.
+    GLuint viewSlot = 0;
+    while (viewSlot + 1 < GROUP_VIEW_SLOTS && !(view & (1u << viewSlot))) {
+        viewSlot++;
+    }
+
+    bool culled = false;
+    for (const Batch& batch : _batches) {
+        if (batch.group < 0) continue;
+        const GpuGroup& group = _groups[batch.group];
+
+        if (!culled) {
+            glUseProgram(_cullProgram);
+            glUniform4fv(_cullLocations.frustumPlanes, 6, &frustum.getPlanes()[0][0]);
+            glUniform3fv(_cullLocations.cameraPosition, 1, &viewpoint.position[0]);
+            glUniform1f(_cullLocations.projectionScale, viewpoint.projectionScale);
+            glUniform1ui(_cullLocations.viewSlot, viewSlot);
+            glUniform1f(_cullLocations.minScreenSize, _pixelScale > 0.0f ? _contributionThreshold * viewpoint.projectionScale / _pixelScale : 0.0f);
+            culled = true;
+        }
+        glUniform1fv(_cullLocations.lodScreenSizes, MAX_GROUP_LOD_LEVELS - 1, group.lodScreenSizes);
+        glUniform1ui(_cullLocations.lodLevelCount, group.levelCount);
+        glUniform1f(_cullLocations.hysteresis, group.hysteresis);
+        glUniform1ui(_cullLocations.instanceCount, group.instanceCount);
+
+        // Counting from zero again, the previous view drew with the old counts already.
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, group.commandBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, static_cast<GLsizeiptr>(group.emptyCommands.size() * sizeof(GLuint)), group.emptyCommands.data());
+
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, group.instanceBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, group.boundsBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, group.visibleBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, group.commandBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, group.levelBuffer);
+        glDispatchCompute((group.instanceCount + 63) / 64, 1, 1);
+    }
+
+    // The commands and survivors are read as indirect commands and instance attributes.
+    if (culled) {
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    }
+}
+
+bool RenderQueue::contributes(const BoundingSphere& bounds) {
+    if (_pixelRadius(bounds) >= _contributionThreshold) return true;
+    _smallCount++;
+    return false;
+}
+
+GLfloat RenderQueue::_pixelRadius(const BoundingSphere& bounds) const {
+    // Unbounded packets (the sky) cover the whole view, inf / inf would give NaN.
+    if (std::isinf(bounds.radius)) return std::numeric_limits<GLfloat>::infinity();
+
+    // Same projected size as the levels of detail, a camera inside the sphere sees it whole.
+    return bounds.radius * _pixelScale / std::max(glm::length(bounds.center - _cameraPosition), bounds.radius);
+}
+
+void RenderQueue::_drawGroup(const GpuGroup& group) const {
+    glBindBuffer(GL_ARRAY_BUFFER, group.visibleBuffer);
+    _pointInstanceAttributes(0);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, group.commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(group.levelCount), 0);
+
+    // Back to the streamed per-draw data for the next mesh batches.
+    if (!_sortedInstances.empty()) {
+        glBindBuffer(GL_ARRAY_BUFFER, _instanceRange.buffer);
+        _pointInstanceAttributes(_instanceRange.offset);
+    }
+}
+
+GLuint64 RenderQueue::_sortKey(const RenderPass pass, const GLuint program, const StateHandle state, const MeshHandle mesh) {
+    // 4 bits of pass, 12 of program, 12 of state and 16 of mesh, the last 20 are the distance set by prepare.
+    return (static_cast<GLuint64>(pass & 0xF) << 60)
+         | (static_cast<GLuint64>(program & 0xFFF) << 48)
+         | (static_cast<GLuint64>(state & 0xFFF) << 36)
+         | (static_cast<GLuint64>(mesh & 0xFFFF) << 20);
+}
+
+void RenderQueue::_pointInstanceAttributes(const std::size_t base) const {
+    // A mat4 attribute takes four consecutive locations, one per column.
+    for (GLint column = 0; column < 4; column++) {
+        glVertexAttribPointer(_locations.instanceModelMatrix + column, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(base + offsetof(InstanceData, modelMatrix) + column * sizeof(glm::vec4)));
+    }
+
+    // A mat3 attribute takes three consecutive locations, one per column.
+    for (GLint column = 0; column < 3; column++) {
+        glVertexAttribPointer(_locations.instanceNormalMatrix + column, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                              (void*)(base + offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec3)));
+    }
+
+    glVertexAttribPointer(_locations.instanceColor, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                          (void*)(base + offsetof(InstanceData, color)));
+}
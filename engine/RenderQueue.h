@@ -0,0 +1,402 @@
+/**
+ * Engine helper header file : RenderQueue
+ *
+ * Single place where the scene hands over everything it wants drawn in a frame.
+ * Draw packets are sorted by pass, shader program, state, mesh and distance to the camera,
+ * then packets sharing a mesh are merged into instanced draws submitted with as few calls
+ * as possible, their instances front to back.
+ * The sorted frame is prepared once and executed for every view, each view keeping
+ * only the packets whose bounding sphere intersects its frustum and, optionally,
+ * the mesh packets not hidden behind the occluders of the view. Packets too small on screen
+ * to contribute to the picture are skipped as well.
+ * On OpenGL 4.3+, groups of static instances can instead be culled by a compute shader
+ * writing the indirect commands, without the CPU touching a single instance.
+ */
+
+#ifndef MP_RENDER_QUEUE_H
+#define MP_RENDER_QUEUE_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "Frustum.h"
+#include "LevelOfDetail.h"
+#include "Mesh.h"
+#include "OcclusionBuffer.h"
+#include "StreamBuffer.h"
+
+/// Render passes, drawn in this order.
+enum RenderPass : GLuint {
+    /// Solid geometry of the world and the heroes, without blending.
+    PASS_OPAQUE = 0,
+    /// Background at the far plane (skybox), only shaded where nothing opaque was drawn.
+    PASS_SKY,
+    PASS_COUNT
+};
+
+/**
+ * Render Queue
+ * Collects the draw packets of a frame and submits them sorted by pass, program, state and mesh.
+ * All the meshes live in one shared vertex and index buffer, so every run of packets with the
+ * same state becomes a single glMultiDrawElementsIndirect call when the context supports it.
+ */
+class RenderQueue {
+public:
+
+    /// Mesh registered in the shared geometry buffers.
+    using MeshHandle = GLuint;
+
+    /// Draw state registered in the queue (shader program and the uniforms it needs).
+    using StateHandle = GLuint;
+
+    /// Function called with the view and projection matrices of the view being executed.
+    using ViewFunction = std::function<void(const glm::mat4& viewMtx, const glm::mat4& projMtx)>;
+
+    /// Group of static instances culled on the GPU.
+    using GroupHandle = GLuint;
+
+    /// Set of views a packet is drawn in, one bit per view.
+    using ViewMask = GLuint;
+
+    /// Packet drawn in every view.
+    static constexpr ViewMask ALL_VIEWS = 0xFFFFFFFF;
+
+    /// Most levels of detail of a GPU group, as declared by the culling shader.
+    static constexpr GLuint MAX_GROUP_LOD_LEVELS = 4;
+
+    /// Views keeping their own levels of detail in a GPU group, the others share them.
+    static constexpr GLuint GROUP_VIEW_SLOTS = 2;
+
+    RenderQueue() = default;
+    ~RenderQueue();
+
+    RenderQueue(const RenderQueue&) = delete;
+    RenderQueue& operator=(const RenderQueue&) = delete;
+
+    /**
+     * Mesh registration
+     * Appends the mesh to the shared geometry, must be called before upload.
+     * @param mesh : Geometry of the mesh.
+     * @return handle used to submit packets of this mesh.
+     */
+    MeshHandle addMesh(const MeshData& mesh);
+
+    /**
+     * State registration
+     * @param programHandle : Shader program used by the state.
+     * @param bind : Sends the uniforms of the state before its draws.
+     * @param unbind : Restores the uniforms changed by bind.
+     * @return handle used to submit packets with this state.
+     */
+    StateHandle addState(GLuint programHandle, ViewFunction bind, std::function<void()> unbind);
+
+    /**
+     * Buffers creation
+     * Sends the shared geometry to the GPU. The per-draw data and indirect commands are
+     * streamed every frame through the given ring buffer.
+     * @param locations : Shader attribute locations.
+     * @param streamBuffer : Ring buffer receiving the per-draw data and commands.
+     */
+    void upload(const MeshAttributeLocations& locations, StreamBuffer* streamBuffer);
+
+    /// True when the context can cull groups on the GPU (OpenGL 4.3+), known once uploaded.
+    bool isGpuCullingSupported() const { return _gpuCulling; }
+
+    /**
+     * Culling shader
+     * Sets the compute program culling the groups, built from shaders/cull.c.glsl.
+     * @param programHandle : Linked compute program, owned by the caller.
+     */
+    void setCullProgram(GLuint programHandle);
+
+    /**
+     * GPU group registration
+     * Sends static instances and their bounds to the GPU once. Every view, a compute shader keeps the
+     * instances in its frustum, picks their level of detail and writes one indirect command per level.
+     * Only valid when GPU culling is supported, after upload.
+     * @param state : Draw state of the instances.
+     * @param lodMeshes : Mesh of every level of detail, from the finest.
+     * @param lodSelector : Screen sizes and hysteresis between the levels.
+     * @param instances : Transform and color of every instance.
+     * @param bounds : World space bounds of every instance.
+     * @return handle used to submit the group.
+     */
+    GroupHandle addGpuGroup(StateHandle state, const std::vector<MeshHandle>& lodMeshes, const LodSelector& lodSelector,
+                            const std::vector<InstanceData>& instances, const std::vector<BoundingSphere>& bounds);
+
+    /**
+     * Mesh packet submission
+     * @param pass : Pass the packet is drawn in.
+     * @param state : Draw state of the packet.
+     * @param mesh : Mesh to draw.
+     * @param instance : Transform and color of this copy of the mesh.
+     * @param bounds : World space sphere enclosing this copy of the mesh.
+     */
+    void submit(RenderPass pass, StateHandle state, MeshHandle mesh, const InstanceData& instance,
+                const BoundingSphere& bounds);
+
+    /**
+     * Custom packet submission
+     * For geometry that does not live in the shared buffers (static batch, heroes, skybox).
+     * The function must leave the given program current.
+     * @param pass : Pass the packet is drawn in.
+     * @param programHandle : Shader program made current before calling draw.
+     * @param draw : Function issuing the draw calls.
+     * @param views : Views the packet is drawn in.
+     * @param bounds : World space sphere enclosing everything drawn by the function.
+     */
+    void submit(RenderPass pass, GLuint programHandle, ViewFunction draw, ViewMask views = ALL_VIEWS,
+                const BoundingSphere& bounds = BoundingSphere::everywhere());
+
+    /**
+     * GPU group submission
+     * @param pass : Pass the group is drawn in.
+     * @param group : Group culled and drawn by the GPU.
+     */
+    void submitGroup(RenderPass pass, GroupHandle group);
+
+    /**
+     * Frame preparation
+     * Sorts the packets submitted this frame, once for every view. Packets with the same pass,
+     * program, state and mesh are ordered by the distance from the camera to their bounds,
+     * so the closest are rasterized first and hide the fragments behind them.
+     * @param cameraPosition : World space position the packets are sorted from.
+     */
+    void prepare(const glm::vec3& cameraPosition);
+
+    /**
+     * View execution
+     * Culls the prepared packets against the frustum of one view, merges the visible ones into
+     * draws, streams their per-draw data and commands, then draws them.
+     * @param viewMtx : View matrix of the current view.
+     * @param projMtx : Projection matrix of the current view.
+     * @param view : Bit of the current view, custom packets without it are skipped.
+     * @param occlusion : Occluders of the current view the mesh packets are tested against, nullptr for none.
+     */
+    void execute(const glm::mat4& viewMtx, const glm::mat4& projMtx, ViewMask view = ALL_VIEWS,
+                 const OcclusionBuffer* occlusion = nullptr);
+
+    /**
+     * Contribution threshold
+     * Packets whose bounding sphere covers a smaller radius on screen are skipped, 0 draws them all.
+     * @param pixels : Smallest radius drawn, in pixels.
+     */
+    void setContributionThreshold(GLfloat pixels) { _contributionThreshold = pixels; }
+
+    /**
+     * Contribution test
+     * Lets custom draws leave out their own small parts in the view being executed,
+     * the parts left out are counted with the small packets.
+     * @param bounds : World space bounds of the part.
+     * @return true when the part covers at least the threshold radius on screen.
+     */
+    bool contributes(const BoundingSphere& bounds);
+
+    /// Empties the queue once every view of the frame is executed.
+    void clear();
+
+    /// Deletes the GPU buffers.
+    void destroy();
+
+    /// Number of draw calls issued by the last execute, a custom packet or a group counting as one.
+    GLsizei getDrawCallCount() const { return _drawCallCount; }
+
+    /// Number of packets outside the frustum of the last execute, the instances of GPU groups are not counted.
+    GLsizei getCulledCount() const { return _culledCount; }
+
+    /// Number of packets inside the frustum but hidden by the occluders in the last execute.
+    GLsizei getOccludedCount() const { return _occludedCount; }
+
+    /// Number of packets and custom parts too small on screen in the last execute.
+    GLsizei getSmallCount() const { return _smallCount; }
+
+private:
+
+    /// Position of a mesh inside the shared buffers.
+    struct MeshRange {
+        GLuint firstIndex;
+        GLuint indexCount;
+        GLint baseVertex;
+    };
+
+    /// Program and uniform callbacks of a state.
+    struct State {
+        GLuint program;
+        ViewFunction bind;
+        std::function<void()> unbind;
+    };
+
+    /// What a packet draws.
+    enum PacketType : GLuint {
+        /// One instance of a mesh in the shared buffers.
+        MESH_PACKET = 0,
+        /// Draw function of the caller.
+        CUSTOM_PACKET,
+        /// Whole GPU group.
+        GROUP_PACKET
+    };
+
+    /// Instances and buffers of a group culled on the GPU.
+    struct GpuGroup {
+        StateHandle state;
+        GLuint instanceCount;
+        GLuint levelCount;
+        /// Screen sizes between the levels, and hysteresis.
+        GLfloat lodScreenSizes[MAX_GROUP_LOD_LEVELS - 1];
+        GLfloat hysteresis;
+        /// Static InstanceData of every instance.
+        GLuint instanceBuffer;
+        /// Static center and radius of every instance.
+        GLuint boundsBuffer;
+        /// Survivors of the last cull, a range of instanceCount per level.
+        GLuint visibleBuffer;
+        /// One indirect command per level.
+        GLuint commandBuffer;
+        /// Current level of every instance, for every view slot.
+        GLuint levelBuffer;
+        /// Commands with no instance, restored before every cull.
+        std::vector<GLuint> emptyCommands;
+        /// Sphere enclosing every instance.
+        BoundingSphere bounds;
+    };
+
+    /// Uniform locations of the culling shader.
+    struct CullUniformLocations {
+        GLint frustumPlanes;
+        GLint cameraPosition;
+        GLint projectionScale;
+        GLint lodScreenSizes;
+        GLint lodLevelCount;
+        GLint hysteresis;
+        GLint instanceCount;
+        GLint viewSlot;
+        GLint minScreenSize;
+    };
+
+    /// Sortable draw request.
+    struct Packet {
+        /// Pass, program, state, mesh and distance packed from most to least significant.
+        GLuint64 key;
+        StateHandle state;
+        MeshHandle mesh;
+        /// Instance index for mesh packets, custom function index or group index otherwise.
+        GLuint payload;
+        PacketType type;
+        GLuint program;
+        ViewMask views;
+        BoundingSphere bounds;
+    };
+
+    /// Same layout as the DrawElementsIndirectCommand read by glMultiDrawElementsIndirect.
+    struct DrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    /// Consecutive commands sharing a state, one custom packet or one group.
+    struct Batch {
+        GLuint program;
+        StateHandle state;
+        GLuint firstCommand;
+        GLuint commandCount;
+        /// Index of the custom function, -1 for the others.
+        GLint custom;
+        /// Index of the GPU group, -1 for the others.
+        GLint group;
+    };
+
+    /// State of custom packets.
+    static constexpr StateHandle NO_STATE = 0xFFF;
+
+    /// Builds the sort key of a packet.
+    static GLuint64 _sortKey(RenderPass pass, GLuint program, StateHandle state, MeshHandle mesh);
+
+    /// Merges the visible packets into batches and commands, and streams them.
+    void _build(const Frustum& frustum, ViewMask view, const OcclusionBuffer* occlusion);
+
+    /// Points the per-draw attributes at the given byte offset of the bound array buffer.
+    void _pointInstanceAttributes(std::size_t base) const;
+
+    /// Culls the groups of the view being executed on the GPU.
+    void _cullGroups(const Frustum& frustum, const LodViewpoint& viewpoint, ViewMask view);
+
+    /// Draws the survivors of a group with one indirect command per level.
+    void _drawGroup(const GpuGroup& group) const;
+
+    /// Radius in pixels of a world space sphere in the view being executed, infinite for unbounded spheres.
+    GLfloat _pixelRadius(const BoundingSphere& bounds) const;
+
+    /// Geometry waiting to be uploaded.
+    MeshData _geometry;
+    /// Registered meshes.
+    std::vector<MeshRange> _meshes;
+    /// Registered states.
+    std::vector<State> _states;
+
+    /// Packets of the current frame.
+    std::vector<Packet> _packets;
+    /// Per-draw data of the mesh packets, in submission order.
+    std::vector<InstanceData> _instances;
+    /// Functions of the custom packets.
+    std::vector<ViewFunction> _customDraws;
+
+    /// Per-draw data in sorted order, as uploaded.
+    std::vector<InstanceData> _sortedInstances;
+    /// Indirect commands, as uploaded.
+    std::vector<DrawCommand> _commands;
+    /// Batches of the view being executed.
+    std::vector<Batch> _batches;
+
+    /// Attribute locations used by the shared VAO.
+    MeshAttributeLocations _locations{};
+
+    /// Vertex array object
+    GLuint _vao = 0;
+    /// Shared vertex buffer object
+    GLuint _vbo = 0;
+    /// Shared index buffer object
+    GLuint _ibo = 0;
+    /// Ring buffer receiving the per-draw data and commands, owned by the engine.
+    StreamBuffer* _streamBuffer = nullptr;
+    /// Per-draw data of the view being executed in the ring buffer.
+    StreamBuffer::Range _instanceRange{};
+    /// Indirect commands of the view being executed in the ring buffer.
+    StreamBuffer::Range _commandRange{};
+
+    /// True when glMultiDrawElementsIndirect is available (OpenGL 4.3+).
+    bool _multiDrawIndirect = false;
+    /// True when compute shaders and storage buffers are available (OpenGL 4.3+).
+    bool _gpuCulling = false;
+
+    /// Groups culled on the GPU.
+    std::vector<GpuGroup> _groups;
+    /// Compute program culling the groups, owned by the caller.
+    GLuint _cullProgram = 0;
+    /// Uniform locations of the culling program.
+    CullUniformLocations _cullLocations{};
+
+    /// Draw calls issued by the last execute.
+    GLsizei _drawCallCount = 0;
+    /// Packets culled by the last execute.
+    GLsizei _culledCount = 0;
+    /// Packets occluded in the last execute.
+    GLsizei _occludedCount = 0;
+    /// Packets and custom parts too small in the last execute.
+    GLsizei _smallCount = 0;
+
+    /// Smallest radius drawn, in pixels.
+    GLfloat _contributionThreshold = 0.0f;
+    /// Camera of the view being executed.
+    glm::vec3 _cameraPosition{0.0f};
+    /// Pixels per unit of screen size (radius over distance) in the view being executed.
+    GLfloat _pixelScale = 0.0f;
+};
+
+#endif //MP_RENDER_QUEUE_H
@@ -0,0 +1,66 @@
+/**
+ * Engine helper class : RenderTarget
+ *
+ * Offscreen framebuffer with a color texture and a depth buffer, used to render
+ * a view once and show it later, as many times as needed, with a textured quad.
+ */
+
+#include "RenderTarget.h"
+
+#include <cstdio>
+
+
+RenderTarget::~RenderTarget() {
+    destroy();
+}
+
+bool RenderTarget::resize(const GLsizei width, const GLsizei height) {
+    if (_fbo && width == _width && height == _height) return false;
+
+    destroy();
+    _width = width;
+    _height = height;
+
+    // Color, filtered linearly since the target is usually smaller than the area it is shown in.
+    glGenTextures(1, &_colorTexture);
+    glBindTexture(GL_TEXTURE_2D, _colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Depth, only needed while rendering.
+    glGenRenderbuffers(1, &_depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, _depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    glGenFramebuffers(1, &_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _colorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthRenderbuffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "[ERROR]: Render target %dx%d is incomplete\n", width, height);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    return true;
+}
+
+void RenderTarget::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, _fbo);
+    glViewport(0, 0, _width, _height);
+}
+
+void RenderTarget::unbind() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderTarget::destroy() {
+    if (_fbo) glDeleteFramebuffers(1, &_fbo);
+    if (_colorTexture) glDeleteTextures(1, &_colorTexture);
+    if (_depthRenderbuffer) glDeleteRenderbuffers(1, &_depthRenderbuffer);
+    _fbo = _colorTexture = _depthRenderbuffer = 0;
+    _width = _height = 0;
+}
@@ -0,0 +1,61 @@
+/**
+ * Engine helper header file : RenderTarget
+ *
+ * Offscreen framebuffer with a color texture and a depth buffer, used to render
+ * a view once and show it later, as many times as needed, with a textured quad.
+ */
+
+#ifndef MP_RENDER_TARGET_H
+#define MP_RENDER_TARGET_H
+
+#include <glad/gl.h>
+
+/**
+ * Render Target
+ * Framebuffer object rendering into a color texture, with its own depth renderbuffer.
+ */
+class RenderTarget {
+public:
+
+    RenderTarget() = default;
+    ~RenderTarget();
+
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+
+    /**
+     * Target resizing
+     * Creates the attachments with the given size, nothing is done if the size did not change.
+     * @param width : Width of the target in pixels.
+     * @param height : Height of the target in pixels.
+     * @return true when the attachments were created, their content is undefined then.
+     */
+    bool resize(GLsizei width, GLsizei height);
+
+    /// Binds the framebuffer and sets the viewport to the whole target.
+    void bind() const;
+
+    /// Binds the window framebuffer back.
+    static void unbind();
+
+    /// Deletes the framebuffer and its attachments.
+    void destroy();
+
+    /// Texture holding the color of the last render.
+    GLuint getColorTexture() const { return _colorTexture; }
+
+private:
+
+    /// Framebuffer object
+    GLuint _fbo = 0;
+    /// Color attachment, sampled when compositing.
+    GLuint _colorTexture = 0;
+    /// Depth attachment, never sampled.
+    GLuint _depthRenderbuffer = 0;
+
+    /// Size of the attachments in pixels.
+    GLsizei _width = 0;
+    GLsizei _height = 0;
+};
+
+#endif //MP_RENDER_TARGET_H
@@ -0,0 +1,54 @@
+/**
+ * Engine helper class : SceneGraph
+ *
+ * Hierarchy of transforms whose world transforms and object blocks are cached,
+ * so only the nodes that moved since the last frame are computed again.
+ */
+
+#include "SceneGraph.h"
+
+#include <cstring>
+
+
+SceneGraph::SceneGraph() {
+    _parents.push_back(ROOT);
+    _locals.emplace_back();
+    _worlds.emplace_back();
+    _objectBlocks.emplace_back(AffineTransform());
+    _dirty.push_back(0);
+    _updated.push_back(0);
+}
+
+SceneGraph::NodeHandle SceneGraph::addNode(const NodeHandle parent, const AffineTransform& local) {
+    const NodeHandle node = getNodeCount();
+    _parents.push_back(parent);
+    _locals.push_back(local);
+    _worlds.emplace_back();
+    _objectBlocks.emplace_back(AffineTransform());
+    // Computed by the next update, which reports it as updated.
+    _dirty.push_back(1);
+    _updated.push_back(0);
+    return node;
+}
+
+void SceneGraph::setLocal(const NodeHandle node, const AffineTransform& local) {
+    // Both are 12 tightly packed floats, a still node compares equal bit for bit.
+    if (std::memcmp(&_locals[node], &local, sizeof(AffineTransform)) == 0) return;
+    _locals[node] = local;
+    _dirty[node] = 1;
+}
+
+void SceneGraph::update() {
+    _updatedCount = 0;
+    _updated[ROOT] = 0;
+    for (NodeHandle node = 1; node < getNodeCount(); node++) {
+        // Parents come first, their flag is already set for this update.
+        _updated[node] = _dirty[node] | _updated[_parents[node]];
+        if (!_updated[node]) continue;
+
+        _worlds[node] = _worlds[_parents[node]] * _locals[node];
+        _objectBlocks[node] = ObjectBlock(_worlds[node]);
+        _dirty[node] = 0;
+        _updatedCount++;
+    }
+}
@@ -0,0 +1,94 @@
+/**
+ * Engine helper header file : SceneGraph
+ *
+ * Hierarchy of transforms whose world transforms and object blocks are cached,
+ * so only the nodes that moved since the last frame are computed again.
+ */
+
+#ifndef MP_SCENE_GRAPH_H
+#define MP_SCENE_GRAPH_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "AffineTransform.h"
+#include "UniformBuffer.h"
+
+/**
+ * Scene Graph
+ * Every node has a local transform relative to its parent, the root being the world. Setting a different
+ * local transform marks the node dirty, and the next update computes the world transform and the object
+ * block (model and normal matrices) of the dirty nodes and of everything below them, nothing else.
+ * A parent is always created before its children, so the nodes are updated in a single pass.
+ */
+class SceneGraph {
+public:
+
+    /// Index of a node in the graph.
+    using NodeHandle = GLuint;
+
+    /// The world, parent of every other node, never moves.
+    static constexpr NodeHandle ROOT = 0;
+
+    /// Graph with only the root.
+    SceneGraph();
+
+    /**
+     * Node creation
+     * @param parent : Node the new one is attached to.
+     * @param local : Transform of the new node relative to its parent.
+     * @return handle of the new node.
+     */
+    NodeHandle addNode(NodeHandle parent, const AffineTransform& local = AffineTransform());
+
+    /**
+     * Local transform setter
+     * The node is only marked dirty when the transform differs from the current one,
+     * so it can be set every frame at no cost while the node stays still.
+     * @param node : Node to move.
+     * @param local : New transform relative to the parent.
+     */
+    void setLocal(NodeHandle node, const AffineTransform& local);
+
+    /// Computes the world transform and object block of the dirty nodes and their descendants.
+    void update();
+
+    /// Transform of a node relative to its parent.
+    const AffineTransform& getLocal(NodeHandle node) const { return _locals[node]; }
+
+    /// Transform of a node relative to the world, as of the last update.
+    const AffineTransform& getWorld(NodeHandle node) const { return _worlds[node]; }
+
+    /// Model and normal matrices of a node, as of the last update.
+    const ObjectBlock& getObjectBlock(NodeHandle node) const { return _objectBlocks[node]; }
+
+    /// True when the last update computed the world transform of a node again.
+    bool wasUpdated(NodeHandle node) const { return _updated[node] != 0; }
+
+    /// Number of nodes computed by the last update.
+    GLuint getUpdatedCount() const { return _updatedCount; }
+
+    /// Number of nodes, the root included.
+    GLuint getNodeCount() const { return static_cast<GLuint>(_parents.size()); }
+
+private:
+
+    /// Parent of every node, the root being its own parent.
+    std::vector<NodeHandle> _parents;
+    /// Transform of every node relative to its parent.
+    std::vector<AffineTransform> _locals;
+    /// Cached transform of every node relative to the world.
+    std::vector<AffineTransform> _worlds;
+    /// Cached std140 model and normal matrices of every node.
+    std::vector<ObjectBlock> _objectBlocks;
+    /// Nodes whose local transform changed since the last update.
+    std::vector<GLubyte> _dirty;
+    /// Nodes computed by the last update.
+    std::vector<GLubyte> _updated;
+    /// Number of nodes computed by the last update.
+    GLuint _updatedCount = 0;
+};
+
+#endif //MP_SCENE_GRAPH_H
@@ -0,0 +1,175 @@
+/**
+ * Engine helper class : SpatialGrid
+ *
+ * Uniform grid over the ground plane indexing objects by their bounding sphere,
+ * so visibility, proximity and picking only look at the cells around them.
+ */
+
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+// -------------------------------- BUILDING --------------------------------
+
+void SpatialGrid::build(const std::vector<BoundingSphere>& items, const GLfloat cellSize) {
+    _cells.clear();
+    _items.clear();
+    _bounds = items;
+    _cellSize = cellSize;
+    _maxRadius = 0.0f;
+    _columns = _rows = 0;
+    if (items.empty()) return;
+
+    // Grid covering every center.
+    glm::vec2 minCenter(items.front().center.x, items.front().center.z);
+    glm::vec2 maxCenter = minCenter;
+    for (const BoundingSphere& item : items) {
+        minCenter = glm::min(minCenter, glm::vec2(item.center.x, item.center.z));
+        maxCenter = glm::max(maxCenter, glm::vec2(item.center.x, item.center.z));
+        _maxRadius = std::max(_maxRadius, item.radius);
+    }
+    _origin = minCenter;
+    _columns = static_cast<GLint>((maxCenter.x - minCenter.x) / cellSize) + 1;
+    _rows = static_cast<GLint>((maxCenter.y - minCenter.y) / cellSize) + 1;
+    _cells.assign(static_cast<std::size_t>(_columns * _rows), {glm::vec3(0.0f), glm::vec3(0.0f), 0, 0});
+
+    // Counting the objects of every cell, then placing them (counting sort).
+    std::vector<GLuint> cellOfItem(items.size());
+    for (std::size_t i = 0; i < items.size(); i++) {
+        const glm::ivec2 coordinates = _cellCoordinates(items[i].center);
+        cellOfItem[i] = static_cast<GLuint>(coordinates.y * _columns + coordinates.x);
+        _cells[cellOfItem[i]].itemCount++;
+    }
+    GLuint first = 0;
+    for (Cell& cell : _cells) {
+        cell.firstItem = first;
+        first += cell.itemCount;
+        cell.itemCount = 0;
+    }
+    _items.resize(items.size());
+    for (std::size_t i = 0; i < items.size(); i++) {
+        Cell& cell = _cells[cellOfItem[i]];
+        _items[cell.firstItem + cell.itemCount] = static_cast<GLuint>(i);
+
+        // The cell box grows to enclose the whole sphere, even where it leaves the cell.
+        const glm::vec3 minCorner = items[i].center - glm::vec3(items[i].radius);
+        const glm::vec3 maxCorner = items[i].center + glm::vec3(items[i].radius);
+        cell.minCorner = cell.itemCount == 0 ? minCorner : glm::min(cell.minCorner, minCorner);
+        cell.maxCorner = cell.itemCount == 0 ? maxCorner : glm::max(cell.maxCorner, maxCorner);
+        cell.itemCount++;
+    }
+}
+
+
+// -------------------------------- QUERIES --------------------------------
+
+void SpatialGrid::queryBox(const glm::vec3& minCorner, const glm::vec3& maxCorner, std::vector<GLuint>& results) const {
+    if (_cells.empty()) return;
+
+    // Only the cells whose objects can reach the box.
+    const glm::ivec2 first = _cellCoordinates(minCorner - glm::vec3(_maxRadius));
+    const glm::ivec2 last = _cellCoordinates(maxCorner + glm::vec3(_maxRadius));
+    for (GLint row = first.y; row <= last.y; row++) {
+        for (GLint column = first.x; column <= last.x; column++) {
+            const Cell& cell = _cells[row * _columns + column];
+            if (cell.itemCount == 0) continue;
+            if (cell.maxCorner.x < minCorner.x || cell.maxCorner.y < minCorner.y || cell.maxCorner.z < minCorner.z) continue;
+            if (cell.minCorner.x > maxCorner.x || cell.minCorner.y > maxCorner.y || cell.minCorner.z > maxCorner.z) continue;
+            _appendInBox(cell, minCorner, maxCorner, results);
+        }
+    }
+}
+
+void SpatialGrid::queryFrustum(const Frustum& frustum, std::vector<GLuint>& results) const {
+    for (const Cell& cell : _cells) {
+        if (cell.itemCount == 0 || !frustum.intersects(cell.minCorner, cell.maxCorner)) continue;
+        for (GLuint i = 0; i < cell.itemCount; i++) {
+            const GLuint item = _items[cell.firstItem + i];
+            if (frustum.intersects(_bounds[item])) {
+                results.push_back(item);
+            }
+        }
+    }
+}
+
+void SpatialGrid::queryFrustums(const std::vector<Frustum>& frustums, std::vector<GLuint>& results) const {
+    // Every object lives in a single cell, so nothing is appended twice.
+    for (const Cell& cell : _cells) {
+        if (cell.itemCount == 0) continue;
+        const bool visible = std::any_of(frustums.begin(), frustums.end(),
+            [&cell](const Frustum& frustum) { return frustum.intersects(cell.minCorner, cell.maxCorner); });
+        if (!visible) continue;
+
+        for (GLuint i = 0; i < cell.itemCount; i++) {
+            const GLuint item = _items[cell.firstItem + i];
+            const bool inside = std::any_of(frustums.begin(), frustums.end(),
+                [this, item](const Frustum& frustum) { return frustum.intersects(_bounds[item]); });
+            if (inside) {
+                results.push_back(item);
+            }
+        }
+    }
+}
+
+GLint SpatialGrid::nearest(const glm::vec3& point, const GLfloat maxDistance) const {
+    if (_cells.empty()) return NO_ITEM;
+
+    GLint best = NO_ITEM;
+    GLfloat bestDistance = maxDistance;
+    const glm::ivec2 center = _cellCoordinates(point);
+    const GLint maxRing = std::max(_columns, _rows);
+
+    // Rings of cells around the point, until the next ring is too far to hold anything closer.
+    for (GLint ring = 0; ring <= maxRing; ring++) {
+        if ((ring - 1) * _cellSize - _maxRadius > bestDistance) break;
+
+        for (GLint row = center.y - ring; row <= center.y + ring; row++) {
+            if (row < 0 || row >= _rows) continue;
+            // Inner rows of the ring only have their two ends.
+            const GLint step = (row == center.y - ring || row == center.y + ring) ? 1 : std::max(1, 2 * ring);
+            for (GLint column = center.x - ring; column <= center.x + ring; column += step) {
+                if (column < 0 || column >= _columns) continue;
+
+                const Cell& cell = _cells[row * _columns + column];
+                for (GLuint i = 0; i < cell.itemCount; i++) {
+                    const GLuint item = _items[cell.firstItem + i];
+                    const GLfloat distance = std::max(0.0f, glm::length(_bounds[item].center - point) - _bounds[item].radius);
+                    if (distance <= bestDistance) {
+                        best = static_cast<GLint>(item);
+                        bestDistance = distance;
+                    }
+                }
+            }
+        }
+    }
+    return best;
+}
+
+GLsizei SpatialGrid::getOccupiedCellCount() const {
+    return static_cast<GLsizei>(std::count_if(_cells.begin(), _cells.end(),
+                                              [](const Cell& cell) { return cell.itemCount > 0; }));
+}
+
+
+// -------------------------------- PRIVATE --------------------------------
+
+glm::ivec2 SpatialGrid::_cellCoordinates(const glm::vec3& position) const {
+    const GLint column = static_cast<GLint>(std::floor((position.x - _origin.x) / _cellSize));
+    const GLint row = static_cast<GLint>(std::floor((position.z - _origin.y) / _cellSize));
+    return {std::clamp(column, 0, _columns - 1), std::clamp(row, 0, _rows - 1)};
+}
+
+void SpatialGrid::_appendInBox(const Cell& cell, const glm::vec3& minCorner, const glm::vec3& maxCorner, std::vector<GLuint>& results) const {
+    for (GLuint i = 0; i < cell.itemCount; i++) {
+        const GLuint item = _items[cell.firstItem + i];
+        const BoundingSphere& sphere = _bounds[item];
+
+        // Distance from the center to the closest point of the box.
+        const glm::vec3 closest = glm::clamp(sphere.center, minCorner, maxCorner);
+        if (glm::length(closest - sphere.center) <= sphere.radius) {
+            results.push_back(item);
+        }
+    }
+}
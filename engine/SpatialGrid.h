@@ -0,0 +1,107 @@
+/**
+ * Engine helper header file : SpatialGrid
+ *
+ * Uniform grid over the ground plane indexing objects by their bounding sphere,
+ * so visibility, proximity and picking only look at the cells around them.
+ */
+
+#ifndef MP_SPATIAL_GRID_H
+#define MP_SPATIAL_GRID_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Frustum.h"
+
+/**
+ * Spatial Grid
+ * Square cells on the XZ plane, each object stored in the cell of its center. Every cell keeps
+ * the box enclosing its objects, so a whole cell can be rejected with a single test.
+ * Queries return the indices the objects had when the grid was built.
+ */
+class SpatialGrid {
+public:
+
+    /// Value returned by nearest when nothing is found.
+    static constexpr GLint NO_ITEM = -1;
+
+    /**
+     * Grid building
+     * Replaces the content of the grid.
+     * @param items : World space bounds of the objects, indexed as in the queries.
+     * @param cellSize : Side of a cell, in world units.
+     */
+    void build(const std::vector<BoundingSphere>& items, GLfloat cellSize);
+
+    /**
+     * Range query
+     * @param minCorner : Smallest corner of a world space axis aligned box.
+     * @param maxCorner : Largest corner of the box.
+     * @param results : Receives the objects touching the box, appended.
+     */
+    void queryBox(const glm::vec3& minCorner, const glm::vec3& maxCorner, std::vector<GLuint>& results) const;
+
+    /**
+     * Frustum query
+     * @param frustum : Frustum of a view.
+     * @param results : Receives the objects intersecting the frustum, appended.
+     */
+    void queryFrustum(const Frustum& frustum, std::vector<GLuint>& results) const;
+
+    /**
+     * Frustums query
+     * @param frustums : Frustums of several views.
+     * @param results : Receives, once each, the objects intersecting at least one frustum, appended.
+     */
+    void queryFrustums(const std::vector<Frustum>& frustums, std::vector<GLuint>& results) const;
+
+    /**
+     * Nearest neighbour query
+     * @param point : World space point.
+     * @param maxDistance : Objects further than this from the point are ignored.
+     * @return index of the object whose sphere is the closest to the point, NO_ITEM if none.
+     */
+    GLint nearest(const glm::vec3& point, GLfloat maxDistance) const;
+
+    /// Number of cells holding at least one object.
+    GLsizei getOccupiedCellCount() const;
+
+private:
+
+    /// Objects of a cell and the box enclosing them.
+    struct Cell {
+        glm::vec3 minCorner;
+        glm::vec3 maxCorner;
+        /// First entry of the cell in _items.
+        GLuint firstItem;
+        GLuint itemCount;
+    };
+
+    /// Column and row of the cell containing a world position, clamped to the grid.
+    glm::ivec2 _cellCoordinates(const glm::vec3& position) const;
+
+    /// Appends the objects of a cell touching the box.
+    void _appendInBox(const Cell& cell, const glm::vec3& minCorner, const glm::vec3& maxCorner, std::vector<GLuint>& results) const;
+
+    /// Cells, row after row along Z.
+    std::vector<Cell> _cells;
+    /// Object indices grouped by cell.
+    std::vector<GLuint> _items;
+    /// Bounds of the objects, by object index.
+    std::vector<BoundingSphere> _bounds;
+
+    /// World XZ position of the corner of the first cell.
+    glm::vec2 _origin{0.0f};
+    /// Side of a cell.
+    GLfloat _cellSize = 1.0f;
+    /// Number of cells along X.
+    GLint _columns = 0;
+    /// Number of cells along Z.
+    GLint _rows = 0;
+    /// Largest object radius, how far an object can stick out of its cell.
+    GLfloat _maxRadius = 0.0f;
+};
+
+#endif //MP_SPATIAL_GRID_H
@@ -0,0 +1,99 @@
+/**
+ * Engine helper class : StaticBatch
+ *
+ * Geometry that never moves, merged once in world space with its colors
+ * baked into the vertices, and drawn with a single call.
+ * Each vertex also stores a part index, so a small transform palette can move
+ * groups of vertices (for example the legs of a hero) without rebuilding the batch.
+ */
+
+#include "StaticBatch.h"
+
+#include <algorithm>
+#include <cstddef>
+
+
+StaticBatch::~StaticBatch() {
+    destroy();
+}
+
+void StaticBatch::add(const MeshData& mesh, const glm::mat4& modelMtx, const glm::vec3& color, const GLuint partIndex) {
+    // Moving the mesh to world space.
+    MeshData worldMesh;
+    worldMesh.append(mesh, modelMtx);
+
+    const GLuint offset = static_cast<GLuint>(_vertices.size());
+    if (_vertices.empty() && !worldMesh.vertices.empty()) {
+        _minCorner = _maxCorner = worldMesh.vertices.front().position;
+    }
+    for (const MeshVertex& vertex : worldMesh.vertices) {
+        _vertices.push_back({vertex.position, vertex.normal, color, static_cast<GLfloat>(partIndex)});
+        _minCorner = glm::min(_minCorner, vertex.position);
+        _maxCorner = glm::max(_maxCorner, vertex.position);
+    }
+    for (const GLuint index : worldMesh.indices) {
+        _indices.push_back(index + offset);
+    }
+}
+
+void StaticBatch::upload(const MeshAttributeLocations& locations) {
+    _indexCount = static_cast<GLsizei>(_indices.size());
+
+    glGenVertexArrays(1, &_vao);
+    glBindVertexArray(_vao);
+
+    glGenBuffers(1, &_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, _vbo);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_vertices.size() * sizeof(BatchVertex)), _vertices.data(), GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(locations.vPos);
+    glVertexAttribPointer(locations.vPos, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, position));
+
+    glEnableVertexAttribArray(locations.vertexNormal);
+    glVertexAttribPointer(locations.vertexNormal, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, normal));
+
+    glEnableVertexAttribArray(locations.vertexColor);
+    glVertexAttribPointer(locations.vertexColor, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, color));
+
+    glEnableVertexAttribArray(locations.partIndex);
+    glVertexAttribPointer(locations.partIndex, 1, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, partIndex));
+
+    glGenBuffers(1, &_ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(_indices.size() * sizeof(GLuint)), _indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+
+    // The GPU owns the geometry from now on.
+    _vertices.clear();
+    _vertices.shrink_to_fit();
+    _indices.clear();
+    _indices.shrink_to_fit();
+}
+
+void StaticBatch::draw(const GLsizei indexCount) const {
+    if (indexCount <= 0) return;
+
+    glBindVertexArray(_vao);
+    glDrawElements(GL_TRIANGLES, std::min(indexCount, _indexCount), GL_UNSIGNED_INT, (void*)nullptr);
+}
+
+BoundingSphere StaticBatch::getBounds(const GLsizei firstIndex) const {
+    if (static_cast<std::size_t>(firstIndex) >= _indices.size()) return {glm::vec3(0.0f), 0.0f};
+
+    glm::vec3 minCorner = _vertices[_indices[firstIndex]].position;
+    glm::vec3 maxCorner = minCorner;
+    for (std::size_t i = static_cast<std::size_t>(firstIndex); i < _indices.size(); i++) {
+        minCorner = glm::min(minCorner, _vertices[_indices[i]].position);
+        maxCorner = glm::max(maxCorner, _vertices[_indices[i]].position);
+    }
+    return BoundingSphere::enclosing(minCorner, maxCorner);
+}
+
+void StaticBatch::destroy() {
+    if (_vao) glDeleteVertexArrays(1, &_vao);
+    if (_vbo) glDeleteBuffers(1, &_vbo);
+    if (_ibo) glDeleteBuffers(1, &_ibo);
+    _vao = _vbo = _ibo = 0;
+    _indexCount = 0;
+}
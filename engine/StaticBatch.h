@@ -0,0 +1,112 @@
+/**
+ * Engine helper header file : StaticBatch
+ *
+ * Geometry that never moves, merged once in world space with its colors
+ * baked into the vertices, and drawn with a single call.
+ * Each vertex also stores a part index, so a small transform palette can move
+ * groups of vertices (for example the legs of a hero) without rebuilding the batch.
+ */
+
+#ifndef MP_STATIC_BATCH_H
+#define MP_STATIC_BATCH_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "Mesh.h"
+
+/**
+ * Static Batch
+ * Collects world space copies of meshes with a baked color, then uploads all of them
+ * into one vertex and index buffer.
+ */
+class StaticBatch {
+public:
+
+    StaticBatch() = default;
+    ~StaticBatch();
+
+    StaticBatch(const StaticBatch&) = delete;
+    StaticBatch& operator=(const StaticBatch&) = delete;
+
+    /**
+     * Mesh addition
+     * Bakes a copy of the mesh into the batch.
+     * @param mesh : Geometry to add.
+     * @param modelMtx : Model matrix moving the mesh to world space.
+     * @param color : Material color of the mesh.
+     * @param partIndex : Transform palette entry moving this mesh (0 for none).
+     */
+    void add(const MeshData& mesh, const glm::mat4& modelMtx, const glm::vec3& color, GLuint partIndex = 0);
+
+    /**
+     * Buffers creation
+     * Sends the merged geometry to the GPU and frees the CPU copy.
+     * @param locations : Shader attribute locations.
+     */
+    void upload(const MeshAttributeLocations& locations);
+
+    /// Draws the whole batch with a single call.
+    void draw() const { draw(_indexCount); }
+
+    /**
+     * Partial drawing
+     * Draws only the meshes added first, for example to leave out small details added last.
+     * @param indexCount : Number of indices drawn from the start, as returned by getIndexCount.
+     */
+    void draw(GLsizei indexCount) const;
+
+    /// Number of indices added so far, the next mesh added starts there.
+    GLsizei getIndexCount() const { return _indices.empty() ? _indexCount : static_cast<GLsizei>(_indices.size()); }
+
+    /// Sphere enclosing every mesh added, in the space of the batch.
+    BoundingSphere getBounds() const { return BoundingSphere::enclosing(_minCorner, _maxCorner); }
+
+    /**
+     * Section bounds
+     * Only available before the upload, the vertices are freed afterwards.
+     * @param firstIndex : First index of the section, as returned by getIndexCount.
+     * @return sphere enclosing the meshes added from that index on.
+     */
+    BoundingSphere getBounds(GLsizei firstIndex) const;
+
+    /// Deletes the GPU buffers.
+    void destroy();
+
+private:
+
+    /// Vertex layout of the batch, with the color baked in.
+    struct BatchVertex {
+        /// World space position.
+        glm::vec3 position;
+        /// World space normal.
+        glm::vec3 normal;
+        /// Material color.
+        glm::vec3 color;
+        /// Transform palette entry.
+        GLfloat partIndex;
+    };
+
+    /// Merged vertices, waiting to be uploaded.
+    std::vector<BatchVertex> _vertices;
+    /// Merged indices, waiting to be uploaded.
+    std::vector<GLuint> _indices;
+
+    /// Corners of the box enclosing every vertex added, kept after the upload.
+    glm::vec3 _minCorner{0.0f};
+    glm::vec3 _maxCorner{0.0f};
+
+    /// Vertex array object
+    GLuint _vao = 0;
+    /// Vertex buffer object
+    GLuint _vbo = 0;
+    /// Index buffer object
+    GLuint _ibo = 0;
+
+    /// Number of indices uploaded
+    GLsizei _indexCount = 0;
+};
+
+#endif //MP_STATIC_BATCH_H
@@ -0,0 +1,152 @@
+/**
+ * Engine helper class : StreamBuffer
+ *
+ * Ring buffer for the data rewritten every frame: per-view and per-object blocks,
+ * per-draw instance data and indirect commands. Split in one region per frame in
+ * flight, each region guarded by a fence so the CPU never writes what the GPU reads.
+ */
+
+#include "StreamBuffer.h"
+
+#include <cstdio>
+#include <cstring>
+
+
+// -------------------------------- SETUP --------------------------------
+
+StreamBuffer::~StreamBuffer() {
+    destroy();
+}
+
+void StreamBuffer::create(const GLsizeiptr regionSize) {
+    // Persistent mapping is core since OpenGL 4.4, older contexts map every write.
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    _persistent = (major == 4 && minor >= 4) || major > 4;
+
+    GLint uniformAlignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    if (uniformAlignment > 0) _uniformAlignment = uniformAlignment;
+
+    _regionSize = regionSize;
+    _allocate();
+}
+
+void StreamBuffer::destroy() {
+    _deleteFences();
+    _deleteRetiredBuffers();
+
+    // Deleting a mapped buffer releases its mapping.
+    if (_buffer) glDeleteBuffers(1, &_buffer);
+    _buffer = 0;
+    _mapped = nullptr;
+}
+
+
+// -------------------------------- FRAMES --------------------------------
+
+void StreamBuffer::beginFrame() {
+    _waitForRegion(_region);
+    _head = 0;
+}
+
+void StreamBuffer::endFrame() {
+    _fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _region = (_region + 1) % REGION_COUNT;
+
+    // Every draw reading the old buffers is issued, the driver frees them once they are done.
+    _deleteRetiredBuffers();
+}
+
+
+// -------------------------------- WRITING --------------------------------
+
+void StreamBuffer::reserve(const GLsizeiptr size) {
+    if (_alignedHead(_uniformAlignment) + size <= _regionSize) return;
+
+    GLsizeiptr newSize = _regionSize;
+    while (newSize < size) newSize *= 2;
+    _regionSize = newSize * 2;
+    fprintf(stdout, "[INFO]: stream buffer grown to %ld bytes per frame\n", static_cast<long>(_regionSize));
+
+    // The old buffer may still be bound for this frame, it is only deleted at the end of it.
+    _retiredBuffers.push_back(_buffer);
+    _deleteFences();
+    _allocate();
+    _region = 0;
+    _head = 0;
+}
+
+StreamBuffer::Range StreamBuffer::write(const void* data, const GLsizeiptr size, const GLintptr alignment) {
+    reserve(size);
+
+    const GLintptr offset = _alignedHead(alignment);
+    const GLintptr bufferOffset = static_cast<GLintptr>(_region) * _regionSize + offset;
+
+    if (_persistent) {
+        // Coherent mapping, the GPU sees the bytes without any flush.
+        memcpy(_mapped + bufferOffset, data, size);
+    } else {
+        // The fences guarantee the GPU is not reading this range, no need to synchronize.
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+        void* destination = glMapBufferRange(GL_COPY_WRITE_BUFFER, bufferOffset, size,
+                                             GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        if (destination) {
+            memcpy(destination, data, size);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        }
+    }
+
+    _head = offset + size;
+    return {_buffer, bufferOffset, size};
+}
+
+
+// -------------------------------- PRIVATE --------------------------------
+
+void StreamBuffer::_allocate() {
+    const GLsizeiptr bufferSize = _regionSize * REGION_COUNT;
+
+    glGenBuffers(1, &_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, _buffer);
+
+    if (_persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, bufferSize, nullptr, flags);
+        _mapped = static_cast<GLubyte*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bufferSize, flags));
+    } else {
+        glBufferData(GL_COPY_WRITE_BUFFER, bufferSize, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+void StreamBuffer::_waitForRegion(const GLuint region) {
+    GLsync& fence = _fences[region];
+    if (!fence) return;
+
+    // Usually signaled already, the GPU being at most two frames behind.
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while (result == GL_TIMEOUT_EXPIRED) {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    }
+
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void StreamBuffer::_deleteFences() {
+    for (GLsync& fence : _fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void StreamBuffer::_deleteRetiredBuffers() {
+    if (_retiredBuffers.empty()) return;
+    glDeleteBuffers(static_cast<GLsizei>(_retiredBuffers.size()), _retiredBuffers.data());
+    _retiredBuffers.clear();
+}
+
+GLintptr StreamBuffer::_alignedHead(const GLintptr alignment) const {
+    return (_head + alignment - 1) / alignment * alignment;
+}
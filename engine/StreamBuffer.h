@@ -0,0 +1,144 @@
+/**
+ * Engine helper header file : StreamBuffer
+ *
+ * Ring buffer for the data rewritten every frame: per-view and per-object blocks,
+ * per-draw instance data and indirect commands. Split in one region per frame in
+ * flight, each region guarded by a fence so the CPU never writes what the GPU reads.
+ */
+
+#ifndef MP_STREAM_BUFFER_H
+#define MP_STREAM_BUFFER_H
+
+#include <glad/gl.h>
+
+#include <vector>
+
+/**
+ * Stream Buffer
+ * Triple-buffered ring of GPU memory written straight from the CPU.
+ * With OpenGL 4.4+ the buffer is mapped once, persistent and coherent. Older contexts map
+ * each write unsynchronized, which is safe because the fences keep the regions apart.
+ */
+class StreamBuffer {
+public:
+
+    /// Frames the CPU may run ahead of the GPU, one region each.
+    static constexpr GLuint REGION_COUNT = 3;
+
+    /// Where a write landed, the buffer is kept so the range stays valid if the ring grows.
+    struct Range {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    StreamBuffer() = default;
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    /**
+     * Buffer creation
+     * @param regionSize : Bytes available to a single frame, grows when a frame needs more.
+     */
+    void create(GLsizeiptr regionSize);
+
+    /**
+     * Frame start
+     * Waits until the GPU is done with the region about to be reused, then starts writing at its beginning.
+     */
+    void beginFrame();
+
+    /**
+     * Frame end
+     * Fences the region written this frame and moves to the next one.
+     */
+    void endFrame();
+
+    /**
+     * Space reservation
+     * Makes sure the next writes of the given size fit in the current region, so they land in the same buffer.
+     * @param size : Bytes about to be written, alignment padding included.
+     */
+    void reserve(GLsizeiptr size);
+
+    /**
+     * Data writing
+     * @param data : Data to copy to the GPU.
+     * @param size : Number of bytes to copy.
+     * @param alignment : Required alignment of the offset.
+     * @return buffer and range the data was written to.
+     */
+    Range write(const void* data, GLsizeiptr size, GLintptr alignment = 4);
+
+    /// Writes a std140 block, aligned to be bound as a uniform block.
+    template<typename Block>
+    Range writeUniformBlock(const Block& block) { return write(&block, sizeof(Block), _uniformAlignment); }
+
+    /**
+     * Uniform range binding
+     * @param bindingPoint : Uniform block binding point.
+     * @param range : Block written earlier this frame.
+     */
+    static void bindUniformRange(const GLuint bindingPoint, const Range& range) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, range.buffer, range.offset, range.size);
+    }
+
+    /**
+     * Uniform block binding
+     * Writes a std140 block and attaches it to the given binding point.
+     * @param bindingPoint : Uniform block binding point.
+     * @param block : Content of the block.
+     */
+    template<typename Block>
+    void bindUniformBlock(const GLuint bindingPoint, const Block& block) {
+        bindUniformRange(bindingPoint, writeUniformBlock(block));
+    }
+
+    /// Deletes the GPU buffer and its fences.
+    void destroy();
+
+private:
+
+    /// Creates and maps the GL buffer with the current region size.
+    void _allocate();
+
+    /// Blocks until the fence of the region is signaled, then deletes it.
+    void _waitForRegion(GLuint region);
+
+    /// Deletes the fences of every region.
+    void _deleteFences();
+
+    /// Deletes the buffers replaced by a bigger one.
+    void _deleteRetiredBuffers();
+
+    /// Offset of the next write in the current region, padded to the alignment.
+    GLintptr _alignedHead(GLintptr alignment) const;
+
+    /// Buffer object
+    GLuint _buffer = 0;
+    /// Mapped memory of the whole buffer, only when persistently mapped.
+    GLubyte* _mapped = nullptr;
+
+    /// Size of each region in bytes.
+    GLsizeiptr _regionSize = 0;
+    /// Region written by the current frame.
+    GLuint _region = 0;
+    /// Bytes written in the current region.
+    GLintptr _head = 0;
+
+    /// Buffers replaced during the current frame, deleted when it ends.
+    std::vector<GLuint> _retiredBuffers;
+
+    /// Fence placed after the last frame written in each region.
+    GLsync _fences[REGION_COUNT] = {};
+
+    /// Alignment of uniform block ranges required by the driver.
+    GLintptr _uniformAlignment = 256;
+
+    /// True when the buffer stays mapped (OpenGL 4.4+).
+    bool _persistent = false;
+};
+
+#endif //MP_STREAM_BUFFER_H
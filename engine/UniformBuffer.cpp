@@ -0,0 +1,42 @@
+/**
+ * Engine helper class : UniformBuffer
+ *
+ * Uniform buffer objects shared by every draw of the lighting shader, and the
+ * std140 layouts of its blocks: frame data, lights and per-object data.
+ */
+
+#include "UniformBuffer.h"
+
+
+ObjectBlock::ObjectBlock(const glm::mat4& modelMtx) : ObjectBlock(AffineTransform(modelMtx)) {}
+
+ObjectBlock::ObjectBlock(const AffineTransform& transform) : modelMatrix(transform.toMat4()) {
+    const glm::mat3 normalMtx = transform.normalMatrix();
+    for (int column = 0; column < 3; column++) {
+        normalMatrix[column] = glm::vec4(normalMtx[column], 0.0f);
+    }
+}
+
+
+UniformBuffer::~UniformBuffer() {
+    destroy();
+}
+
+void UniformBuffer::create(const GLuint bindingPoint, const GLsizeiptr size) {
+    glGenBuffers(1, &_ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+
+    // Attached once, the programs only need their block bound to the same point.
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, _ubo);
+}
+
+void UniformBuffer::update(const void* data, const GLsizeiptr size, const GLintptr offset) const {
+    glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+}
+
+void UniformBuffer::destroy() {
+    if (_ubo) glDeleteBuffers(1, &_ubo);
+    _ubo = 0;
+}
@@ -0,0 +1,108 @@
+/**
+ * Engine helper header file : UniformBuffer
+ *
+ * Uniform buffer objects shared by every draw of the lighting shader, and the
+ * std140 layouts of its blocks: frame data, lights and per-object data.
+ */
+
+#ifndef MP_UNIFORM_BUFFER_H
+#define MP_UNIFORM_BUFFER_H
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include "AffineTransform.h"
+
+/// Binding points of the lighting shader uniform blocks.
+enum UniformBlockBinding : GLuint {
+    /// Camera and time, written once per view.
+    FRAME_BLOCK_BINDING = 0,
+    /// Lights, written only when they change.
+    LIGHT_BLOCK_BINDING,
+    /// Model and normal matrices of the object being drawn.
+    OBJECT_BLOCK_BINDING
+};
+
+/// std140 layout of the FrameData block.
+struct FrameBlock {
+    /// Projection times view matrix of the current view.
+    glm::mat4 viewProjectionMatrix;
+    /// World space position of the current camera.
+    glm::vec3 cameraPosition;
+    /// Current time in seconds, used by the grass animation.
+    GLfloat time;
+};
+
+/// std140 layout of the LightData block, every vec3 is padded to 16 bytes.
+struct LightBlock {
+    glm::vec3 directionalDirection;  GLfloat _pad0;
+    glm::vec3 directionalColor;      GLfloat _pad1;
+    glm::vec3 pointPosition;         GLfloat _pad2;
+    glm::vec3 pointColor;            GLfloat _pad3;
+    glm::vec3 spotPosition;          GLfloat _pad4;
+    glm::vec3 spotDirection;         GLfloat _pad5;
+    glm::vec3 spotColor;             GLfloat _pad6;
+};
+
+/// std140 layout of the ObjectData block, a mat3 takes three padded columns.
+struct ObjectBlock {
+    /// Model matrix of the object.
+    glm::mat4 modelMatrix;
+    /// Normal matrix of the object, one vec4 per column.
+    glm::vec4 normalMatrix[3];
+
+    /**
+     * Object block creation
+     * @param modelMtx : Affine model matrix of the object, the normal matrix is computed from it.
+     */
+    explicit ObjectBlock(const glm::mat4& modelMtx);
+
+    /**
+     * Object block creation
+     * @param transform : Transform of the object, its normal matrix needs no general inverse.
+     */
+    explicit ObjectBlock(const AffineTransform& transform);
+};
+
+/**
+ * Uniform Buffer
+ * A buffer bound to one uniform block binding point, shared by every program using that block.
+ */
+class UniformBuffer {
+public:
+
+    UniformBuffer() = default;
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    /**
+     * Buffer creation
+     * @param bindingPoint : Uniform block binding point the buffer is attached to.
+     * @param size : Size of the block in bytes.
+     */
+    void create(GLuint bindingPoint, GLsizeiptr size);
+
+    /**
+     * Buffer update
+     * @param data : New content of the block.
+     * @param size : Number of bytes to write.
+     * @param offset : Offset in bytes where the data starts.
+     */
+    void update(const void* data, GLsizeiptr size, GLintptr offset = 0) const;
+
+    /// Replaces the whole block with a std140 structure.
+    template<typename Block>
+    void update(const Block& block) const { update(&block, sizeof(Block)); }
+
+    /// Deletes the GPU buffer.
+    void destroy();
+
+private:
+
+    /// Uniform buffer object
+    GLuint _ubo = 0;
+};
+
+#endif //MP_UNIFORM_BUFFER_H
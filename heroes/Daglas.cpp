@@ -7,15 +7,13 @@
 
 #include "Daglas.h"
 #include <glm/gtc/matrix_transform.hpp>
-#include <CSCI441/objects.hpp>
 
 
 // -------------------------------- PUBLIC --------------------------------
 
 Daglas::Daglas(const GLuint shaderProgramHandle,
-               const GLint mvpMtxUniformLocation,
-               const GLint normalMtxUniformLocation,
-               const GLint materialColorUniformLocation
+               const HeroUniformLocations& uniformLocations,
+               StreamBuffer* streamBuffer
                ):
 
                // Parts
@@ -43,57 +41,98 @@ Daglas::Daglas(const GLuint shaderProgramHandle,
 
 {
 
-    setProgramUniformLocations(shaderProgramHandle, mvpMtxUniformLocation, normalMtxUniformLocation, materialColorUniformLocation);
+    setProgramUniformLocations(shaderProgramHandle, uniformLocations, streamBuffer);
 }
 
 
-void Daglas::drawHero(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx ) const {
+void Daglas::bakeParts(const MeshAttributeLocations& attributeLocations) {
     // Translating Daglas entirely to position him over the grid.
-    modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, 0.4f, 0.0f));
+    glm::mat4 modelMtx = glm::translate( glm::mat4(1.0f), glm::vec3(0.0f, 0.4f, 0.0f));
 
-    _drawBody(modelMtx, viewMtx, projMtx);
+    _bakeBody(modelMtx);
 
-    _drawShell(true, modelMtx, viewMtx, projMtx);
-    _drawShell(false, modelMtx, viewMtx, projMtx);
+    _bakeShell(true, modelMtx);
+    _bakeShell(false, modelMtx);
 
-    _drawLegs(true, modelMtx, viewMtx, projMtx);
-    _drawLegs(false, modelMtx, viewMtx, projMtx);
+    _bakeLegs(true, modelMtx);
+    _bakeLegs(false, modelMtx);
 
-    _drawArms(true, modelMtx, viewMtx, projMtx);
-    _drawArms(false, modelMtx, viewMtx, projMtx);
+    _bakeArms(true, modelMtx);
+    _bakeArms(false, modelMtx);
 
-    _drawNeck(modelMtx, viewMtx, projMtx);
+    _bakeNeck(modelMtx);
 
-    _drawHead(modelMtx, viewMtx, projMtx);
+    _bakeHead(modelMtx);
 
-    _drawCheeks(true, modelMtx, viewMtx, projMtx);
-    _drawCheeks(false, modelMtx, viewMtx, projMtx);
+    _bakeClosedEyes(true, modelMtx);
+    _bakeClosedEyes(false, modelMtx);
+    _bakeEyes(true, modelMtx);
+    _bakeEyes(false, modelMtx);
 
-    if (_blink) {
-        _drawClosedEyes(true, modelMtx, viewMtx, projMtx);
-        _drawClosedEyes(false, modelMtx, viewMtx, projMtx);
-    } else {
-        _drawEyes(true, modelMtx, viewMtx, projMtx);
-        _drawEyes(false, modelMtx, viewMtx, projMtx);
+    // Facial details last, so they can be left out when too small to be seen.
+    _detailsFirstIndex = _mesh.getIndexCount();
 
-        _drawPupils(true, modelMtx, viewMtx, projMtx);
-        _drawPupils(false, modelMtx, viewMtx, projMtx);
-    }
+    _bakeCheeks(true, modelMtx);
+    _bakeCheeks(false, modelMtx);
+
+    _bakePupils(true, modelMtx);
+    _bakePupils(false, modelMtx);
+
+    _bakeMouth(modelMtx);
+
+    _bakeNose(true, modelMtx);
+    _bakeNose(false, modelMtx);
+
+    _detailBounds = _mesh.getBounds(_detailsFirstIndex);
+    _mesh.upload(attributeLocations);
+}
+
+void Daglas::prepareHero(const ObjectBlock& objectBlock, const FrameContext& /*frame*/) {
+    // Moving the animated parts from the pose they were baked in.
+    _palette[STATIC_PARTS] = glm::mat4(1.0f);
+    _palette[LEFT_LEG] = glm::translate( glm::mat4(1.0f), _legWalkOffset(true));
+    _palette[RIGHT_LEG] = glm::translate( glm::mat4(1.0f), _legWalkOffset(false));
+
+    // Only one set of eyes is visible, the other one collapses to a point.
+    _palette[OPEN_EYES] = _blink ? glm::mat4(0.0f) : glm::mat4(1.0f);
+    _palette[CLOSED_EYES] = _blink ? glm::mat4(1.0f) : glm::mat4(0.0f);
 
-    _drawMouth(modelMtx, viewMtx, projMtx);
+    // Streaming the model and normal matrices once, every view binds the same block.
+    _objectRange = _streamBuffer->writeUniformBlock(objectBlock);
+}
+
+void Daglas::drawHero(const bool drawDetails) const {
+    // Shading
+    StreamBuffer::bindUniformRange(OBJECT_BLOCK_BINDING, _objectRange);
+    glProgramUniformMatrix4fv(_shaderProgramHandle, _uniformLocations.partPalette, PART_COUNT, GL_FALSE, &_palette[0][0][0]);
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.useVertexColor, 1);
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.usePartPalette, 1);
+
+    // Drawing every part at once, the details only when they can be seen
+    _mesh.draw(drawDetails ? _mesh.getIndexCount() : _detailsFirstIndex);
+
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.useVertexColor, 0);
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.usePartPalette, 0);
+}
 
-    _drawNose(true, modelMtx, viewMtx, projMtx);
-    _drawNose(false, modelMtx, viewMtx, projMtx);
+BoundingSphere Daglas::getBounds() const {
+    // A little larger than the baked pose, for the legs moving while walking.
+    BoundingSphere bounds = _mesh.getBounds();
+    bounds.radius *= 1.1f;
+    return bounds;
+}
 
+BoundingSphere Daglas::getDetailBounds() const {
+    return _detailBounds;
 }
 
 void Daglas::setProgramUniformLocations( GLuint shaderProgramHandle,
-                                 GLint mvpMtxUniformLocation,
-                                 GLint normalMtxUniformLocation,
-                                 GLint materialColorUniformLocation ) {
+                                 const HeroUniformLocations& uniformLocations,
+                                 StreamBuffer* streamBuffer ) {
 
     _shaderProgramHandle = shaderProgramHandle;
-    _shaderProgramUniformLocations = {mvpMtxUniformLocation, normalMtxUniformLocation, materialColorUniformLocation};
+    _uniformLocations = uniformLocations;
+    _streamBuffer = streamBuffer;
 }
 
 void Daglas::setBlink(bool blink) {
@@ -130,172 +169,126 @@ void Daglas::setStop(bool stop) {
 
 // DRAWING FUNCTIONS :
 
-void Daglas::_drawBody(glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Daglas::_bakeBody(glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, _body.y / 2.0f, 0.0f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _body );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_green[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _green);
 }
 
-void Daglas::_drawShell(const bool big, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Daglas::_bakeShell(const bool big, glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, _body.y / 2.0f, (big ? -0.2f : -0.3f)));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, (big ? _shellBig : _shellSmall) );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_darkGreen[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _darkGreen);
 }
 
-void Daglas::_drawLegs(const bool leftLeg, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
-    // Adjusting with respect to the grid.
-
-    if (_stop) {
-        modelMtx = glm::translate( modelMtx, glm::vec3((leftLeg ? -0.15f : 0.15f), -(_leg.y / 2.0f), 0.0f));
-    }
-    else if (_walkLeft) {
-        modelMtx = glm::translate( modelMtx, glm::vec3((leftLeg ? -0.15f : 0.15f), -(_leg.y / 2.0f), (leftLeg ? -0.1f : 0.1f)));
-    }
-    else if (_walkRight) {
-        modelMtx = glm::translate( modelMtx, glm::vec3((leftLeg ? -0.15f : 0.15f), -(_leg.y / 2.0f), (leftLeg ? 0.1f : -0.1f)));
-    }
-
+void Daglas::_bakeLegs(const bool leftLeg, glm::mat4 modelMtx) {
+    // Adjusting with respect to the grid, standing still. The palette moves it while walking.
+    modelMtx = glm::translate( modelMtx, glm::vec3((leftLeg ? -0.15f : 0.15f), -(_leg.y / 2.0f), 0.0f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _leg );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_beige[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _beige, (leftLeg ? LEFT_LEG : RIGHT_LEG));
 }
 
-void Daglas::_drawArms(const bool leftArm, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Daglas::_bakeArms(const bool leftArm, glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3((leftArm ? -0.35f : 0.35f), _body.y / 2.0f, 0.0f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _arm );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_green[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _green);
 }
 
-void Daglas::_drawNeck(glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Daglas::_bakeNeck(glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, (_neck.y / 2.0f) + _body.y, 0.0f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _neck );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_green[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _green);
 }
 
-void Daglas::_drawHead(glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Daglas::_bakeHead(glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, (_head.y / 2.0f) + _body.y + _neck.y, 0.0f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _head );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_green[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _green);
 }
 
-void Daglas::_drawCheeks(const bool leftCheek, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Daglas::_bakeCheeks(const bool leftCheek, glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3((leftCheek ? -0.35f : 0.35f), (_cheek.y / 2.0f) + _body.y + _neck.y, 0.05f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _cheek );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_green[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _green);
 }
 
-void Daglas::_drawEyes(const bool leftEye, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Daglas::_bakeEyes(const bool leftEye, glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3((leftEye ? -0.15f : 0.15f), (_eye.y / 2.0f) + _body.y + _neck.y + 0.2, 0.15f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _eye );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_white[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _white, OPEN_EYES);
 }
 
-void Daglas::_drawClosedEyes(const bool leftEye, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Daglas::_bakeClosedEyes(const bool leftEye, glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3((leftEye ? -0.15f : 0.15f), (_closedEye.y / 2.0f) + _body.y + _neck.y + 0.2, 0.15f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _closedEye );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_green[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _green, CLOSED_EYES);
 }
 
-void Daglas::_drawPupils(const bool leftPupil, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Daglas::_bakePupils(const bool leftPupil, glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     GLfloat pupilHeight = (_pupil.y / 2.0f) + _body.y + _neck.y + 0.23;
     modelMtx = glm::translate( modelMtx, glm::vec3((leftPupil ? -0.15f : 0.15f), pupilHeight, 0.2f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _pupil );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_black[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _black, OPEN_EYES);
 }
 
-void Daglas::_drawMouth(glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Daglas::_bakeMouth(glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, (_mouth.y / 2.0f) + _body.y + _neck.y + 0.05, 0.15f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _mouth );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_red[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _red);
 }
 
-void Daglas::_drawNose(const bool leftNose, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Daglas::_bakeNose(const bool leftNose, glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     GLfloat pupilHeight = (_nose.y / 2.0f) + _body.y + _neck.y + 0.17;
     modelMtx = glm::translate( modelMtx, glm::vec3((leftNose ? -0.03f : 0.03f), pupilHeight, 0.15f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _nose );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_black[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _black);
 }
 
 
-void Daglas::_computeAndSendMatrixUniforms(const glm::mat4& modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
-
-    // Precomputing the Model-View-Projection matrix on the CPU.
-    glm::mat4 mvpMtx = projMtx * viewMtx * modelMtx;
-    // Sending it to the shader on the GPU to apply to every vertex.
-    glProgramUniformMatrix4fv( _shaderProgramHandle, _shaderProgramUniformLocations.mvpMtx, 1, GL_FALSE, &mvpMtx[0][0] );
-
-    // Precomputing the normal matrix.
-    glm::mat3 normalMtx = glm::mat3( glm::transpose( glm::inverse( modelMtx )));
-    // Sending it to the shader on the GPU to apply to every vertex.
-    glProgramUniformMatrix3fv( _shaderProgramHandle, _shaderProgramUniformLocations.normalMtx, 1, GL_FALSE, &normalMtx[0][0] );
+glm::vec3 Daglas::_legWalkOffset(const bool leftLeg) const {
+    if (_stop) {
+        return glm::vec3(0.0f);
+    }
+    else if (_walkLeft) {
+        return glm::vec3(0.0f, 0.0f, (leftLeg ? -0.1f : 0.1f));
+    }
+    else if (_walkRight) {
+        return glm::vec3(0.0f, 0.0f, (leftLeg ? 0.1f : -0.1f));
+    }
+    return glm::vec3(0.0f);
 }
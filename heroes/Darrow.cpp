@@ -1,12 +1,11 @@
 #include "Darrow.h"
 #include <glm/gtc/matrix_transform.hpp>
-#include <CSCI441/objects.hpp>
 #include <CSCI441/ModelLoader.hpp>
 #include <CSCI441/ShaderProgram.hpp>
 
 // -------------------------------- PUBLIC --------------------------------
 
-Darrow::Darrow(const GLuint shaderProgramHandle, const GLint mvpMtxUniformLocation, const GLint normalMtxUniformLocation, const GLint materialColorUniformLocation):
+Darrow::Darrow(const GLuint shaderProgramHandle, const HeroUniformLocations& uniformLocations, StreamBuffer* streamBuffer):
 
                _body(0.6, 0.9, 0.3),
                _leg(0.25, 0.828, 0.25),
@@ -28,38 +27,79 @@ Darrow::Darrow(const GLuint shaderProgramHandle, const GLint mvpMtxUniformLocati
 
 {
 
-    setProgramUniformLocations(shaderProgramHandle, mvpMtxUniformLocation, normalMtxUniformLocation, materialColorUniformLocation);
+    setProgramUniformLocations(shaderProgramHandle, uniformLocations, streamBuffer);
 }
 
-void Darrow::drawHero(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
-    modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, 0.4f, 0.0f));
+void Darrow::bakeParts(const MeshAttributeLocations& attributeLocations) {
+    // Translating Darrow entirely to position him over the grid.
+    glm::mat4 modelMtx = glm::translate( glm::mat4(1.0f), glm::vec3(0.0f, 0.4f, 0.0f));
 
-    _drawBody(modelMtx, viewMtx, projMtx);
-    _drawLegs(true, modelMtx, viewMtx, projMtx);
-    _drawLegs(false, modelMtx, viewMtx, projMtx);
-    _drawArms(true, modelMtx, viewMtx, projMtx);
-    _drawArms(false, modelMtx, viewMtx, projMtx);
-    _drawHands(true, modelMtx, viewMtx, projMtx);
-    _drawHands(false, modelMtx, viewMtx, projMtx);
-    _drawHead(modelMtx, viewMtx, projMtx);
-    _drawEyes(true, modelMtx, viewMtx, projMtx);
-    _drawEyes(false, modelMtx, viewMtx, projMtx);
-    _drawPupils(true, modelMtx, viewMtx, projMtx);
-    _drawPupils(false, modelMtx, viewMtx, projMtx);
-    _drawMouth(modelMtx, viewMtx, projMtx);
-    _drawHairTop(modelMtx, viewMtx, projMtx);
-    _drawHairSides(true, modelMtx, viewMtx, projMtx);
-    _drawHairSides(false, modelMtx, viewMtx, projMtx);
-    _drawHairBack(modelMtx, viewMtx, projMtx);
+    _bakeBody(modelMtx);
+    _bakeLegs(true, modelMtx);
+    _bakeLegs(false, modelMtx);
+    _bakeArms(true, modelMtx);
+    _bakeArms(false, modelMtx);
+    _bakeHands(true, modelMtx);
+    _bakeHands(false, modelMtx);
+    _bakeHead(modelMtx);
+    _bakeEyes(true, modelMtx);
+    _bakeEyes(false, modelMtx);
+    _bakeHairTop(modelMtx);
+    _bakeHairSides(true, modelMtx);
+    _bakeHairSides(false, modelMtx);
+    _bakeHairBack(modelMtx);
 
+    // Facial details last, so they can be left out when too small to be seen.
+    _detailsFirstIndex = _mesh.getIndexCount();
+    _bakePupils(true, modelMtx);
+    _bakePupils(false, modelMtx);
+    _bakeMouth(modelMtx);
+    _detailBounds = _mesh.getBounds(_detailsFirstIndex);
+
+    _mesh.upload(attributeLocations);
+}
+
+void Darrow::prepareHero(const ObjectBlock& objectBlock, const FrameContext& /*frame*/) {
+    // Moving the animated parts from the pose they were baked in.
+    _palette[STATIC_PARTS] = glm::mat4(1.0f);
+    _palette[LEFT_LEG] = glm::translate( glm::mat4(1.0f), _legWalkOffset(true));
+    _palette[RIGHT_LEG] = glm::translate( glm::mat4(1.0f), _legWalkOffset(false));
+
+    // Streaming the model and normal matrices once, every view binds the same block.
+    _objectRange = _streamBuffer->writeUniformBlock(objectBlock);
+}
+
+void Darrow::drawHero(const bool drawDetails) const {
+    // Shading
+    StreamBuffer::bindUniformRange(OBJECT_BLOCK_BINDING, _objectRange);
+    glProgramUniformMatrix4fv(_shaderProgramHandle, _uniformLocations.partPalette, PART_COUNT, GL_FALSE, &_palette[0][0][0]);
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.useVertexColor, 1);
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.usePartPalette, 1);
+
+    // Drawing every part at once, the details only when they can be seen
+    _mesh.draw(drawDetails ? _mesh.getIndexCount() : _detailsFirstIndex);
+
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.useVertexColor, 0);
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.usePartPalette, 0);
+}
+
+BoundingSphere Darrow::getBounds() const {
+    // A little larger than the baked pose, for the legs moving while walking.
+    BoundingSphere bounds = _mesh.getBounds();
+    bounds.radius *= 1.1f;
+    return bounds;
+}
+
+BoundingSphere Darrow::getDetailBounds() const {
+    return _detailBounds;
 }
 
 void Darrow::setProgramUniformLocations( GLuint shaderProgramHandle,
-                                 GLint mvpMtxUniformLocation,
-                                 GLint normalMtxUniformLocation,
-                                 GLint materialColorUniformLocation ) {
+                                 const HeroUniformLocations& uniformLocations,
+                                 StreamBuffer* streamBuffer ) {
     _shaderProgramHandle = shaderProgramHandle;
-    _shaderProgramUniformLocations = {mvpMtxUniformLocation, normalMtxUniformLocation, materialColorUniformLocation};
+    _uniformLocations = uniformLocations;
+    _streamBuffer = streamBuffer;
 }
 
 void Darrow::setWalkLeft( bool walk) {
@@ -96,146 +136,110 @@ bool Darrow::getBlink() {
 
 // DRAWING FUNCTIONS :
 
-void Darrow::_drawBody(glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Darrow::_bakeBody(glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, (_leg.y), 0.0f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _body );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_black[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _black);
 }
 
-void Darrow::_drawLegs(const bool leftLeg, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
-    // Adjusting with respect to the grid.
-    if (_stop) {
-        modelMtx = glm::translate( modelMtx, glm::vec3((leftLeg ? -0.15f : 0.15f), 0.0f, 0.0f));
-    }
-    else if (_walkLeft) {
-        modelMtx = glm::translate( modelMtx, glm::vec3((leftLeg ? -0.15f : 0.15f), 0.0f, (leftLeg ? -0.1f : 0.1f)));
-    }
-    else if (_walkRight) {
-        modelMtx = glm::translate( modelMtx, glm::vec3((leftLeg ? -0.15f : 0.15f), 0.0f, (leftLeg ? 0.1f : -0.1f)));
-    }
+void Darrow::_bakeLegs(const bool leftLeg, glm::mat4 modelMtx) {
+    // Adjusting with respect to the grid, standing still. The palette moves it while walking.
+    modelMtx = glm::translate( modelMtx, glm::vec3((leftLeg ? -0.15f : 0.15f), 0.0f, 0.0f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _leg );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_black[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _black, (leftLeg ? LEFT_LEG : RIGHT_LEG));
 }
 
-void Darrow::_drawArms(const bool leftArm, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Darrow::_bakeArms(const bool leftArm, glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3((leftArm ? -((_body.x / 2.0f) + _arm.x / 2.0f) : ((_body.x / 2.0f) + _arm.x / 2.0f)), (_body.y / 2.0f) + (_leg.y / 2.0f), 0.0f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _arm );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_black[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _black);
 }
 
-void Darrow::_drawHands(const bool leftHand, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Darrow::_bakeHands(const bool leftHand, glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3((leftHand ? -((_body.x / 2.0f) + _arm.x / 2.0f) : ((_body.x / 2.0f) + _arm.x / 2.0f)), (_body.y / 2.0f) + (_leg.y / 2.0f)- 0.1f - (_arm.y / 2.0f), 0.0f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _hand );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_skintone[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _skintone);
 }
 
-void Darrow::_drawHead(glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Darrow::_bakeHead(glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, (_head.y / 2.0f) + (_body.y / 2.0f) + (_leg.y), 0.0f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _head );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_skintone[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _skintone);
 }
 
-void Darrow::_drawEyes(const bool leftEye, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Darrow::_bakeEyes(const bool leftEye, glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3((leftEye ? -_eye.x : _eye.x), (_eye.y / 2.0f) + (_body.y / 2.0f) + _leg.y + (_head.y / 2.0f), (_head.z / 2.0f) + (_eye.z / 2.0f)));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _eye );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_white[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _white);
 }
 
-void Darrow::_drawPupils(const bool leftPupil, glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Darrow::_bakePupils(const bool leftPupil, glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     GLfloat pupilHeight = (_pupil.y / 2.0f) + _body.y + 0.23;
     modelMtx = glm::translate( modelMtx, glm::vec3((leftPupil ? -_eye.x : _eye.x), _pupil.y + (_body.y / 2.0f) + _leg.y + (_head.y / 2.0f), (_head.z / 2.0f) + (_eye.z / 2.0f) + (_pupil.z / 2.0f)));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _pupil );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_gold[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _gold);
 }
 
-void Darrow::_drawMouth(glm::mat4 modelMtx, const glm::mat4 &viewMtx, const glm::mat4 &projMtx) const {
+void Darrow::_bakeMouth(glm::mat4 modelMtx) {
     // Adjusting with respect to the grid.
     modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, (_mouth.y / 2.0f) + (_body.y / 2.0f) + _leg.y + (_head.y / 4.0f), 0.15f));
     // Scaling by the defined coordinates.
     modelMtx = glm::scale( modelMtx, _mouth );
-    // Shading and color
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_black[0]);
-    // Drawing
-    CSCI441::drawSolidCube(1.0);
+    // Baking with its color
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _black);
 }
 
-void Darrow::_drawHairTop(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
+void Darrow::_bakeHairTop(glm::mat4 modelMtx) {
     // Top of hair
     modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, _leg.y + _body.y -.045, 0.0f));
     modelMtx = glm::scale( modelMtx, _hairTop );
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_gold[0]);
-    CSCI441::drawSolidCube(1.0);
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _gold);
  
 }
 
-void Darrow::_drawHairSides(const bool leftHair, glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const{
+void Darrow::_bakeHairSides(const bool leftHair, glm::mat4 modelMtx) {
         // Sides of hair
     modelMtx = glm::translate( modelMtx, glm::vec3(leftHair ? -((_head.x / 2.0f) + _hairSides.x / 2.0f) : ((_head.x / 2.0f) + _hairSides.x / 2.0f), _leg.y + _body.y - _hairSides.y*.6 - _hairTop.y, 0.0f));
     modelMtx = glm::scale( modelMtx, _hairSides );
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_gold[0]);
-    CSCI441::drawSolidCube(1.0);
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _gold);
 }
 
-void Darrow::_drawHairBack(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
+void Darrow::_bakeHairBack(glm::mat4 modelMtx) {
     // Back of hair
     modelMtx = glm::translate( modelMtx, glm::vec3(0.0f, _leg.y + _body.y - _hairBack.y*.55 - _hairTop.y*2, -(_head.z / 2.0f)));
     modelMtx = glm::scale( modelMtx, _hairBack );
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &_gold[0]);
-    CSCI441::drawSolidCube(1.0);
-}
-
-void Darrow::_computeAndSendMatrixUniforms(const glm::mat4& modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
-    // Precomputing the Model-View-Projection matrix on the CPU.
-    glm::mat4 mvpMtx = projMtx * viewMtx * modelMtx;
-    // Sending it to the shader on the GPU to apply to every vertex.
-    glProgramUniformMatrix4fv( _shaderProgramHandle, _shaderProgramUniformLocations.mvpMtx, 1, GL_FALSE, &mvpMtx[0][0] );
-    // Precomputing the normal matrix.
-    glm::mat3 normalMtx = glm::mat3( glm::transpose( glm::inverse( modelMtx )));
-    // Sending it to the shader on the GPU to apply to every vertex.
-    glProgramUniformMatrix3fv( _shaderProgramHandle, _shaderProgramUniformLocations.normalMtx, 1, GL_FALSE, &normalMtx[0][0] );
+    _mesh.add(MeshData::cube(1.0f), modelMtx, _gold);
+}
+
+glm::vec3 Darrow::_legWalkOffset(const bool leftLeg) const {
+    if (_stop) {
+        return glm::vec3(0.0f);
+    }
+    else if (_walkLeft) {
+        return glm::vec3(0.0f, 0.0f, (leftLeg ? -0.1f : 0.1f));
+    }
+    else if (_walkRight) {
+        return glm::vec3(0.0f, 0.0f, (leftLeg ? 0.1f : -0.1f));
+    }
+    return glm::vec3(0.0f);
 }
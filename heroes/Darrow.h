@@ -19,38 +19,58 @@ public:
     /**
      *  constructor
      * @param shaderProgramHandle : Handle for the shader program (vertex + fragment)
-     * @param mvpMtxUniformLocation : Location of the MVP matrix uniform
-     * @param normalMtxUniformLocation : Location of the normal matrix uniform
-     * @param materialColorUniformLocation : Location of the material color uniform
+     * @param uniformLocations : Locations of the uniforms used by the baked mesh.
+     * @param streamBuffer : Ring buffer receiving the model and normal matrices.
      */
     Darrow( GLuint shaderProgramHandle,
-            GLint mvpMtxUniformLocation,
-            GLint normalMtxUniformLocation,
-            GLint materialColorUniformLocation );
+            const HeroUniformLocations& uniformLocations,
+            StreamBuffer* streamBuffer );
+
+    /**
+     * Darrow preparation
+     * Computes the part palette and streams the model and normal matrices, once per frame.
+     * @param objectBlock : Model and normal matrices to go from object space to world space
+     * @param frame : Time of the frame being drawn
+     */
+    void prepareHero(const ObjectBlock& objectBlock, const FrameContext& frame) override;
 
     /**
      *  Drawing function
-     * Using the three components of the MVP matrix, model, view and projection, executes all
-     * the drawing functions to create our hero.
-     * @param modelMtx : Model matrix to go from object space to world space
-     * @param viewMtx : View matrix to go from world space to view/eye/camera space.
-     * @param projMtx : Projection matrix to go from view space to clip space.
+     * Draws every part of our hero at once, for the current view.
+     * @param drawDetails : false to leave out the facial details, baked last.
+     */
+    void drawHero(bool drawDetails) const override;
+
+    /**
+     * Darrow bounds
+     * @return sphere enclosing every part of Darrow, in object space.
+     */
+    BoundingSphere getBounds() const override;
+
+    /**
+     * Darrow details bounds
+     * @return sphere enclosing the facial details of Darrow, in object space.
      */
-    void drawHero(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx ) const override;
+    BoundingSphere getDetailBounds() const override;
 
 
     /**
      * Uniform location setter
      * Sets all the uniform location for the shader passed as parameters.
      * @param shaderProgramHandle : Handle for the shader program (vertex + fragment)
-     * @param mvpMtxUniformLocation : Location of the MVP matrix uniform
-     * @param normalMtxUniformLocation : Location of the normal matrix uniform
-     * @param materialColorUniformLocation : Location of the material color uniform
+     * @param uniformLocations : Locations of the uniforms used by the baked mesh.
+     * @param streamBuffer : Ring buffer receiving the model and normal matrices.
      */
     void setProgramUniformLocations( GLuint shaderProgramHandle,
-                                     GLint mvpMtxUniformLocation,
-                                     GLint normalMtxUniformLocation,
-                                     GLint materialColorUniformLocation ) override;
+                                     const HeroUniformLocations& uniformLocations,
+                                     StreamBuffer* streamBuffer ) override;
+
+    /**
+     * Parts baking
+     * Bakes every part of Darrow into a single mesh, so drawHero is a single draw call.
+     * @param attributeLocations : Locations of the vertex attributes of the shader.
+     */
+    void bakeParts( const MeshAttributeLocations& attributeLocations ) override;
 
     /**
      * Blinking flag setter
@@ -102,18 +122,36 @@ private:
     /// Handle for the shader program, used when drawing .
     GLuint _shaderProgramHandle;
 
-    /// Structure storing the uniform locations for the shader program.
-    struct ShaderProgramUniformLocations {
-        /// Location of the precomputed Model-View-Projection matrix.
-        GLint mvpMtx;
+    /// Ring buffer receiving the model and normal matrices.
+    StreamBuffer* _streamBuffer;
+
+    // ------------- BAKED MESH -------------
+
+    /// Entries of the part transform palette, one for each group of parts moving together.
+    enum Part : GLuint {
+        /// Parts that never move.
+        STATIC_PARTS = 0,
+        LEFT_LEG,
+        RIGHT_LEG,
+        PART_COUNT
+    };
+
+    /// Every part of Darrow, baked with its color and palette entry.
+    StaticBatch _mesh;
+
+    /// Uniform locations used to draw the baked mesh.
+    HeroUniformLocations _uniformLocations;
 
-        /// Location of the precomputed Normal matrix.
-        GLint normalMtx;
+    /// Part transforms computed by the last preparation.
+    glm::mat4 _palette[PART_COUNT];
 
-        /// Location of the material color.
-        GLint materialColor;
+    /// Object block streamed by the last preparation.
+    StreamBuffer::Range _objectRange{};
 
-    } _shaderProgramUniformLocations;
+    /// First index of the facial details, baked after every other part.
+    GLsizei _detailsFirstIndex = 0;
+    /// Sphere enclosing the facial details.
+    BoundingSphere _detailBounds{glm::vec3(0.0f), 0.0f};
 
     // ------------- DRAWING VARIABLES -------------
 
@@ -146,48 +184,46 @@ private:
     bool _stop = true;
 
 
-    // --------------------------------- DRAWING FUNCTIONS ---------------------------------
+    // --------------------------------- BAKING FUNCTIONS ---------------------------------
 
-    /// Drawing  Body
-    void _drawBody(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx ) const;
+    /// Baking Body
+    void _bakeBody(glm::mat4 modelMtx);
 
-    /// Drawing  Legs
-    void _drawLegs(const bool leftLeg, glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx ) const;
+    /// Baking Legs
+    void _bakeLegs(const bool leftLeg, glm::mat4 modelMtx);
 
-    /// Drawing  Arms
-    void _drawArms(const bool leftArm, glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx ) const;
+    /// Baking Arms
+    void _bakeArms(const bool leftArm, glm::mat4 modelMtx);
 
-    // Drawing Hands
-    void _drawHands(const bool leftArm, glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx ) const;
+    // Baking Hands
+    void _bakeHands(const bool leftArm, glm::mat4 modelMtx);
 
-    /// Drawing  Head
-    void _drawHead(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx ) const;
+    /// Baking Head
+    void _bakeHead(glm::mat4 modelMtx);
 
-    /// Drawing  Eyes
-    void _drawEyes(const bool leftEye, glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx ) const;
+    /// Baking Eyes
+    void _bakeEyes(const bool leftEye, glm::mat4 modelMtx);
 
-    /// Drawing  Pupils
-    void _drawPupils(const bool leftPupil, glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx ) const;
+    /// Baking Pupils
+    void _bakePupils(const bool leftPupil, glm::mat4 modelMtx);
 
-    /// Drawing  Mouth
-    void _drawMouth(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx ) const;
+    /// Baking Mouth
+    void _bakeMouth(glm::mat4 modelMtx);
 
-    void _drawHairTop(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const;
+    void _bakeHairTop(glm::mat4 modelMtx);
 
-    void _drawHairSides(const bool leftHair, glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const;
+    void _bakeHairSides(const bool leftHair, glm::mat4 modelMtx);
 
-    void _drawHairBack(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const;
+    void _bakeHairBack(glm::mat4 modelMtx);
 
 
 
     /**
-     * Matrix uniform processor
-     * This function computes the MVP and normal matrices and sends them to the shader through the GPU.
-     * @param modelMtx : Model matrix to go from object space to world space
-     * @param viewMtx : View matrix to go from world space to view/eye/camera space.
-     * @param projMtx : Projection matrix to go from view space to clip space.
+     * Walking offset
+     * Offset of a leg from the standing position it was baked in, for the current walking state.
+     * @param leftLeg : true for the left leg.
      */
-    void _computeAndSendMatrixUniforms(const glm::mat4& modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const;
+    glm::vec3 _legWalkOffset(const bool leftLeg) const;
 
 };
 
@@ -6,16 +6,13 @@
 
 #include "Petre.h"
 #include <glm/gtc/matrix_transform.hpp>
-#include <CSCI441/objects.hpp>
-#include <GLFW/glfw3.h> // (for time, to hide the animation in this implementation)
 
 
 // -------------------------------- PUBLIC --------------------------------
 
-Petre::Petre(GLuint shaderProgramHandle,
-             GLint mvpMtxUniformLocation,
-             GLint normalMtxUniformLocation,
-             GLint materialColorUniformLocation
+Petre::Petre(const GLuint shaderProgramHandle,
+             const HeroUniformLocations& uniformLocations,
+             StreamBuffer* streamBuffer
             ): 
             // Parts
             _torsoXZ(0.80f, 0.0f, 0.50f),
@@ -37,24 +34,70 @@ Petre::Petre(GLuint shaderProgramHandle,
             _pupilBlack(0.0f, 0.0f, 0.0f),
             _mouthDark(0.55f, 0.12f, 0.12f)
 {
-    setProgramUniformLocations(shaderProgramHandle, mvpMtxUniformLocation, normalMtxUniformLocation, materialColorUniformLocation);
+    setProgramUniformLocations(shaderProgramHandle, uniformLocations, streamBuffer);
 }
 
 void Petre::setProgramUniformLocations(GLuint shaderProgramHandle,
-                                       GLint mvpMtxUniformLocation,
-                                       GLint normalMtxUniformLocation,
-                                       GLint materialColorUniformLocation) {
+                                       const HeroUniformLocations& uniformLocations,
+                                       StreamBuffer* streamBuffer) {
     _shaderProgramHandle = shaderProgramHandle;
-    _shaderProgramUniformLocations = { mvpMtxUniformLocation, normalMtxUniformLocation, materialColorUniformLocation };
+    _uniformLocations = uniformLocations;
+    _streamBuffer = streamBuffer;
 }
 
-void Petre::drawHero(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
-    modelMtx = glm::translate(modelMtx, glm::vec3(0.0f, 0.0f, 0.0f));
+void Petre::bakeParts(const MeshAttributeLocations& attributeLocations) {
+    glm::mat4 modelMtx(1.0f);
 
-    _drawLegs(modelMtx, viewMtx, projMtx);
-    _drawStack(modelMtx, viewMtx, projMtx);
-    _drawArms(modelMtx, viewMtx, projMtx);
-    _drawHeadAndHair(modelMtx, viewMtx, projMtx); // Also draw face
+    _bakeLegs(modelMtx);
+    _bakeStack(modelMtx);
+    _bakeArms(modelMtx);
+    _bakeHeadAndHair(modelMtx); // Also bake face, last
+
+    _mesh.upload(attributeLocations);
+}
+
+void Petre::prepareHero(const ObjectBlock& objectBlock, const FrameContext& frame) {
+    float swingAngle = 0.0f;
+    if(!_stop && (_walkLeft ^ _walkRight)) {
+        const float t = static_cast<float>(frame.time);
+        const float A = glm::radians(28.0f);        // swinging amplitude in radians
+        const float w = 10.0f;                      // speed
+        const float swing = sinf(w*t);              // in [-1,1]
+        swingAngle =  A*swing;    // opposite phase
+    }
+
+    // Swinging the arms around their shoulders, they were baked hanging straight down.
+    _palette[STATIC_PARTS] = glm::mat4(1.0f);
+    _palette[LEFT_ARM] = _armSwing(true, swingAngle);
+    _palette[RIGHT_ARM] = _armSwing(false, -swingAngle);
+
+    // Streaming the model and normal matrices once, every view binds the same block.
+    _objectRange = _streamBuffer->writeUniformBlock(objectBlock);
+}
+
+void Petre::drawHero(const bool drawDetails) const {
+    // Shading
+    StreamBuffer::bindUniformRange(OBJECT_BLOCK_BINDING, _objectRange);
+    glProgramUniformMatrix4fv(_shaderProgramHandle, _uniformLocations.partPalette, PART_COUNT, GL_FALSE, &_palette[0][0][0]);
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.useVertexColor, 1);
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.usePartPalette, 1);
+
+    // Drawing every part at once, the details only when they can be seen
+    _mesh.draw(drawDetails ? _mesh.getIndexCount() : _detailsFirstIndex);
+
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.useVertexColor, 0);
+    glProgramUniform1i(_shaderProgramHandle, _uniformLocations.usePartPalette, 0);
+}
+
+BoundingSphere Petre::getBounds() const {
+    // A little larger than the baked pose, for the legs moving while walking.
+    BoundingSphere bounds = _mesh.getBounds();
+    bounds.radius *= 1.1f;
+    return bounds;
+}
+
+BoundingSphere Petre::getDetailBounds() const {
+    return _detailBounds;
 }
 
 // (unused)
@@ -66,17 +109,14 @@ bool Petre::getWalkLeft() { return _walkLeft; }
 bool Petre::getWalkRight() { return _walkRight; }
 void Petre::setStop(bool stop) { _stop = stop; }
 
-// Wrapper function to draw a scaled cube/box
-void Petre::_drawBox(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx,
-                     glm::vec3 scale, glm::vec3 color) const {
+// Wrapper function to bake a scaled cube/box
+void Petre::_bakeBox(glm::mat4 modelMtx, glm::vec3 scale, glm::vec3 color, GLuint part) {
     modelMtx = glm::scale(modelMtx, scale);
-    _computeAndSendMatrixUniforms(modelMtx, viewMtx, projMtx);
-    glProgramUniform3fv(_shaderProgramHandle, _shaderProgramUniformLocations.materialColor, 1, &color[0]);
-    CSCI441::drawSolidCube(1.0);
+    _mesh.add(MeshData::cube(1.0f), modelMtx, color, part);
 }
 
-// Draw torso box stack
-void Petre::_drawStack(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
+// Bake torso box stack
+void Petre::_bakeStack(glm::mat4 modelMtx) {
     const float yLeg = _leg.y;
     const float yPantsC = yLeg + _hPants*0.5f;
     const float yBeltC  = yLeg + _hPants + _hBelt*0.5f;
@@ -85,83 +125,82 @@ void Petre::_drawStack(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::
     // Pants
     {
         glm::mat4 M = glm::translate(modelMtx, glm::vec3(0.0f, yPantsC, 0.0f));
-        _drawBox(M, viewMtx, projMtx, glm::vec3(_torsoXZ.x, _hPants, _torsoXZ.z), _pantsGreen);
+        _bakeBox(M, glm::vec3(_torsoXZ.x, _hPants, _torsoXZ.z), _pantsGreen);
     }
     // Belt
     {
         glm::mat4 M = glm::translate(modelMtx, glm::vec3(0.0f, yBeltC, 0.0f));
-        _drawBox(M, viewMtx, projMtx, glm::vec3(_torsoXZ.x, _hBelt, _torsoXZ.z), _beltBlack);
+        _bakeBox(M, glm::vec3(_torsoXZ.x, _hBelt, _torsoXZ.z), _beltBlack);
     }
     // Shirt
     {
         glm::mat4 M = glm::translate(modelMtx, glm::vec3(0.0f, yShirtC, 0.0f));
-        _drawBox(M, viewMtx, projMtx, glm::vec3(_torsoXZ.x, _hShirt, _torsoXZ.z), _shirtWhite);
+        _bakeBox(M, glm::vec3(_torsoXZ.x, _hShirt, _torsoXZ.z), _shirtWhite);
     }
 }
 
-void Petre::_drawLegs(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
+void Petre::_bakeLegs(glm::mat4 modelMtx) {
     const float xOff = 0.20f;
     // Left leg
     {
         glm::mat4 M = glm::translate(modelMtx, glm::vec3(-xOff, _leg.y*0.5f, 0.0f));
-        _drawBox(M, viewMtx, projMtx, _leg, _skin);
+        _bakeBox(M, _leg, _skin);
     }
     // Right leg
     {
         glm::mat4 M = glm::translate(modelMtx, glm::vec3(+xOff, _leg.y*0.5f, 0.0f));
-        _drawBox(M, viewMtx, projMtx, _leg, _skin);
+        _bakeBox(M, _leg, _skin);
     }
 }
 
-void Petre::_drawArms(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
-    const float yLeg = _leg.y;
-    const float yMidShirt = yLeg + _hPants + _hBelt + _hShirt*0.5f;
-    const float xOff = (_torsoXZ.x*0.5f) + (_arm.x*0.5f);
-
-    float swingAngle = 0.0f;
-    if(!_stop && (_walkLeft ^ _walkRight)) {
-        const float t = static_cast<float>(glfwGetTime());
-        const float A = glm::radians(28.0f);        // swinging amplitude in radians
-        const float w = 10.0f;                      // speed
-        const float swing = sinf(w*t);              // in [-1,1]
-        swingAngle =  A*swing;    // opposite phase
-    }
-
+void Petre::_bakeArms(glm::mat4 modelMtx) {
     // left arm
     {
-        glm::mat4 M = glm::translate(modelMtx, glm::vec3(-xOff, yMidShirt, 0.0f));
-        M = glm::rotate(M, swingAngle, glm::vec3(1, 0, 0));
+        glm::mat4 M = glm::translate(modelMtx, _shoulder(true));
         M = glm::translate(M, glm::vec3(0.0f, -_arm.y*0.5f, 0.0f));
-        _drawBox(M, viewMtx, projMtx, _arm, _skin);
+        _bakeBox(M, _arm, _skin, LEFT_ARM);
     }
     // right arm
     {
-        glm::mat4 M = glm::translate(modelMtx, glm::vec3(+xOff, yMidShirt, 0.0f));
-        M = glm::rotate(M, -swingAngle, glm::vec3(1,0,0));
+        glm::mat4 M = glm::translate(modelMtx, _shoulder(false));
         M = glm::translate(M, glm::vec3(0.0f, -_arm.y*0.5f, 0.0f));
-        _drawBox(M, viewMtx, projMtx, _arm, _skin);
+        _bakeBox(M, _arm, _skin, RIGHT_ARM);
     }
 }
 
-void Petre::_drawHeadAndHair(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
+glm::vec3 Petre::_shoulder(bool leftArm) const {
+    const float yLeg = _leg.y;
+    const float yMidShirt = yLeg + _hPants + _hBelt + _hShirt*0.5f;
+    const float xOff = (_torsoXZ.x*0.5f) + (_arm.x*0.5f);
+    return glm::vec3(leftArm ? -xOff : +xOff, yMidShirt, 0.0f);
+}
+
+glm::mat4 Petre::_armSwing(bool leftArm, float angle) const {
+    glm::mat4 M = glm::translate(glm::mat4(1.0f), _shoulder(leftArm));
+    M = glm::rotate(M, angle, glm::vec3(1, 0, 0));
+    return glm::translate(M, -_shoulder(leftArm));
+}
+
+void Petre::_bakeHeadAndHair(glm::mat4 modelMtx) {
     const float yLeg = _leg.y;
     const float yHeadC = yLeg + _hPants + _hBelt + _hShirt + _head.y*0.5f;
     const float yHairC = yHeadC + _head.y*0.5f + _hair.y*0.5f;
 
     // Head
-    {
-        glm::mat4 M = glm::translate(modelMtx, glm::vec3(0.0f, yHeadC, 0.0f));
-        _drawBox(M, viewMtx, projMtx, _head, _skin);
-        _drawFace(M, viewMtx, projMtx);
-    }
+    const glm::mat4 headM = glm::translate(modelMtx, glm::vec3(0.0f, yHeadC, 0.0f));
+    _bakeBox(headM, _head, _skin);
     // Hair
     {
         glm::mat4 M = glm::translate(modelMtx, glm::vec3(0.0f, yHairC, 0.0f));
-        _drawBox(M, viewMtx, projMtx, _hair, _hairBrown);
+        _bakeBox(M, _hair, _hairBrown);
     }
+    // Face last, so it can be left out when too small to be seen
+    _detailsFirstIndex = _mesh.getIndexCount();
+    _bakeFace(headM);
+    _detailBounds = _mesh.getBounds(_detailsFirstIndex);
 }
 
-void Petre::_drawFace(glm::mat4 headCenterM, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
+void Petre::_bakeFace(glm::mat4 headCenterM) {
     const float headHalfZ = _head.z*0.5f;
     const float zFlush = headHalfZ + 0.01f; // Stick out of the head a little bit
     const float zPupil = zFlush + 0.02f; // Stick out a bit further
@@ -179,38 +218,25 @@ void Petre::_drawFace(glm::mat4 headCenterM, const glm::mat4& viewMtx, const glm
 
     // Left eye white
     { glm::mat4 M = glm::translate(headCenterM, {-eyeX, eyeY, zFlush});
-      _drawBox(M, viewMtx, projMtx, eyeSize, _eyeWhite); }
+      _bakeBox(M, eyeSize, _eyeWhite); }
 
     // Right eye white
     { glm::mat4 M = glm::translate(headCenterM, {+eyeX, eyeY, zFlush});
-      _drawBox(M, viewMtx, projMtx, eyeSize, _eyeWhite); }
+      _bakeBox(M, eyeSize, _eyeWhite); }
 
     // Left pupil
     { glm::mat4 M = glm::translate(headCenterM, {-eyeX, eyeY, zPupil});
-      _drawBox(M, viewMtx, projMtx, pupilSize, _pupilBlack); }
+      _bakeBox(M, pupilSize, _pupilBlack); }
 
     // Right pupil
     { glm::mat4 M = glm::translate(headCenterM, {+eyeX, eyeY, zPupil});
-      _drawBox(M, viewMtx, projMtx, pupilSize, _pupilBlack); }
+      _bakeBox(M, pupilSize, _pupilBlack); }
 
     // Nose (skin), slightly protruding
     { glm::mat4 M = glm::translate(headCenterM, {0.0f, 0.0f, zNoseC});
-      _drawBox(M, viewMtx, projMtx, noseSize, _skin); }
+      _bakeBox(M, noseSize, _skin); }
 
     // Mouth
     { glm::mat4 M = glm::translate(headCenterM, {0.0f, mouthY, zMouth});
-      _drawBox(M, viewMtx, projMtx, mouthSize, _mouthDark); }
+      _bakeBox(M, mouthSize, _mouthDark); }
 }
-
-void Petre::_computeAndSendMatrixUniforms(const glm::mat4& modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const {
-
-    // Precomputing the Model-View-Projection matrix on the CPU.
-    glm::mat4 mvpMtx = projMtx*viewMtx*modelMtx;
-    // Sending it to the shader on the GPU to apply to every vertex.
-    glProgramUniformMatrix4fv( _shaderProgramHandle, _shaderProgramUniformLocations.mvpMtx, 1, GL_FALSE, &mvpMtx[0][0] );
-
-    // Precomputing the normal matrix.
-    glm::mat3 normalMtx = glm::mat3( glm::transpose( glm::inverse( modelMtx )));
-    // Sending it to the shader on the GPU to apply to every vertex.
-    glProgramUniformMatrix3fv( _shaderProgramHandle, _shaderProgramUniformLocations.normalMtx, 1, GL_FALSE, &normalMtx[0][0] );
-}
\ No newline at end of file
@@ -23,37 +23,57 @@ public:
     /**
      * Petre constructor
      * @param shaderProgramHandle : Handle for the shader program (vertex + fragment)
-     * @param mvpMtxUniformLocation : Location of the MVP matrix uniform
-     * @param normalMtxUniformLocation : Location of the normal matrix uniform
-     * @param materialColorUniformLocation : Location of the material color uniform
+     * @param uniformLocations : Locations of the uniforms used by the baked mesh.
+     * @param streamBuffer : Ring buffer receiving the model and normal matrices.
      */
     Petre(GLuint shaderProgramHandle,
-          GLint mvpMtxUniformLocation,
-          GLint normalMtxUniformLocation,
-          GLint materialColorUniformLocation);
+          const HeroUniformLocations& uniformLocations,
+          StreamBuffer* streamBuffer );
+
+    /**
+     * Petre preparation
+     * Computes the part palette and streams the model and normal matrices, once per frame.
+     * @param objectBlock : Model and normal matrices to go from object space to world space
+     * @param frame : Time of the frame being drawn
+     */
+    void prepareHero(const ObjectBlock& objectBlock, const FrameContext& frame) override;
 
     /**
      * Petre Drawing function
-     * Using the three components of the MVP matrix, model, view and projection, executes all
-     * the drawing functions to create our hero.
-     * @param modelMtx : Model matrix to go from object space to world space
-     * @param viewMtx : View matrix to go from world space to view/eye/camera space.
-     * @param projMtx : Projection matrix to go from view space to clip space.
+     * Draws every part of our hero at once, for the current view.
+     * @param drawDetails : false to leave out the facial details, baked last.
+     */
+    void drawHero(bool drawDetails) const override;
+
+    /**
+     * Petre bounds
+     * @return sphere enclosing every part of Petre, in object space.
+     */
+    BoundingSphere getBounds() const override;
+
+    /**
+     * Petre details bounds
+     * @return sphere enclosing the facial details of Petre, in object space.
      */
-    void drawHero(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const override;
+    BoundingSphere getDetailBounds() const override;
 
     /**
      * Uniform loction setter
      * Sets all the uniform location for the shader passed as parameters.
      * @param shaderProgramHandle : Handle for the shader program (vertex + fragment)
-     * @param mvpMtxUniformLocation : Location of the MVP matrix uniform
-     * @param normalMtxUniformLocation : Location of the normal matrix uniform
-     * @param materialColorUniformLocation : Location of the material color uniform
+     * @param uniformLocations : Locations of the uniforms used by the baked mesh.
+     * @param streamBuffer : Ring buffer receiving the model and normal matrices.
      */
     void setProgramUniformLocations(GLuint shaderProgramHandle,
-                                    GLint mvpMtxUniformLocation,
-                                    GLint normalMtxUniformLocation,
-                                    GLint materialColorUniformLocation) override;
+                                    const HeroUniformLocations& uniformLocations,
+                                    StreamBuffer* streamBuffer ) override;
+
+    /**
+     * Parts baking
+     * Bakes every part of Petre into a single mesh, so drawHero is a single draw call.
+     * @param attributeLocations : Locations of the vertex attributes of the shader.
+     */
+    void bakeParts(const MeshAttributeLocations& attributeLocations) override;
 
     /**
      * Blinking flag setter
@@ -100,11 +120,19 @@ public:
 private:
 
     GLuint _shaderProgramHandle;
-    struct ShaderProgramUniformLocations {
-        GLint mvpMtx;
-        GLint normalMtx;
-        GLint materialColor;
-    } _shaderProgramUniformLocations;
+    StreamBuffer* _streamBuffer;
+
+    // Baked mesh, the arms have their own palette entries to swing
+    enum Part : GLuint { STATIC_PARTS = 0, LEFT_ARM, RIGHT_ARM, PART_COUNT };
+    StaticBatch _mesh;
+    HeroUniformLocations _uniformLocations;
+    glm::mat4 _palette[PART_COUNT];
+    StreamBuffer::Range _objectRange{};
+
+    /// First index of the facial details, baked after every other part.
+    GLsizei _detailsFirstIndex = 0;
+    /// Sphere enclosing the facial details.
+    BoundingSphere _detailBounds{glm::vec3(0.0f), 0.0f};
 
     // Torso stack
     const glm::vec3 _torsoXZ;     // (width, UNUSED, depth)
@@ -134,18 +162,18 @@ private:
     bool _walkRight;
     bool _stop = true;
 
-    // Draw helpers
-    void _drawBox(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx,
-                  glm::vec3 scale, glm::vec3 color) const;
-    void _drawStack(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const;
-    void _drawLegs(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const;
-    void _drawArms(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const;
-    void _drawHeadAndHair(glm::mat4 modelMtx, const glm::mat4& viewMtx, const glm::mat4& projMtx) const;
-    void _drawFace(glm::mat4 headCenterM, const glm::mat4& viewMtx, const glm::mat4& projMtx) const;
-
-    void _computeAndSendMatrixUniforms(const glm::mat4& modelMtx,
-                                       const glm::mat4& viewMtx,
-                                       const glm::mat4& projMtx) const;
+    // Bake helpers
+    void _bakeBox(glm::mat4 modelMtx, glm::vec3 scale, glm::vec3 color, GLuint part = STATIC_PARTS);
+    void _bakeStack(glm::mat4 modelMtx);
+    void _bakeLegs(glm::mat4 modelMtx);
+    void _bakeArms(glm::mat4 modelMtx);
+    void _bakeHeadAndHair(glm::mat4 modelMtx);
+    void _bakeFace(glm::mat4 headCenterM);
+
+    // Arm animation helpers
+    glm::vec3 _shoulder(bool leftArm) const;
+    glm::mat4 _armSwing(bool leftArm, float angle) const;
+
 };
 
 #endif // MP_PETRE_H
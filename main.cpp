@@ -14,6 +14,8 @@
 
 #include "MPEngine.h"
 
+#include <cstring>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -23,7 +25,13 @@
 ///*****************************************************************************
 //
 // Our main function
-int main() {
+int main(int argc, char* argv[]) {
+    // Scaling of the job system only, no window needed
+    if (argc > 1 && std::strcmp(argv[1], "--benchmark-jobs") == 0) {
+        MPEngine::benchmarkJobSystem();
+        return EXIT_SUCCESS;
+    }
+
     const auto MpEngine = new MPEngine();
     MpEngine->initialize();
     if (MpEngine->getError() == CSCI441::OpenGLEngine::OPENGL_ENGINE_ERROR_NO_ERROR) {
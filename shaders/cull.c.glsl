@@ -0,0 +1,71 @@
+#version 430 core
+
+// Frustum culling and level of detail of a group of static instances, one invocation per instance.
+// Survivors are appended to the range of their level, and counted in the indirect command of that level.
+layout(local_size_x = 64) in;
+
+// InstanceData as 28 tightly packed floats: model matrix, normal matrix and color.
+const uint INSTANCE_FLOATS = 28u;
+// DrawElementsIndirectCommand as 5 uints, the instance count being the second.
+const uint COMMAND_UINTS = 5u;
+// Most levels of detail a group can have.
+const uint MAX_LOD_LEVELS = 4u;
+
+layout(std430, binding = 0) readonly buffer Instances { float instances[]; };
+layout(std430, binding = 1) readonly buffer Bounds { vec4 bounds[]; };
+layout(std430, binding = 2) writeonly buffer Visible { float visible[]; };
+layout(std430, binding = 3) buffer Commands { uint commands[]; };
+layout(std430, binding = 4) buffer Levels { uint levels[]; };
+
+uniform vec4 frustumPlanes[6];
+uniform vec3 cameraPosition;
+uniform float projectionScale;
+uniform float lodScreenSizes[MAX_LOD_LEVELS - 1u];
+uniform uint lodLevelCount;
+uniform float hysteresis;
+uniform uint instanceCount;
+uniform uint viewSlot;
+// Smallest screen size drawn, smaller instances do not contribute to the picture.
+uniform float minScreenSize;
+
+// First level whose size is reached, with every size scaled.
+uint levelFor(float size, float scale) {
+    uint level = 0u;
+    while (level + 1u < lodLevelCount && size < lodScreenSizes[level] * scale) {
+        level++;
+    }
+    return level;
+}
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= instanceCount) return;
+
+    // Center and radius.
+    vec4 sphere = bounds[i];
+    for (int p = 0; p < 6; p++) {
+        if (dot(frustumPlanes[p].xyz, sphere.xyz) + frustumPlanes[p].w < -sphere.w) return;
+    }
+
+    // Same hysteresis as the CPU selector, the level being kept for every view.
+    float size = sphere.w * projectionScale / max(distance(sphere.xyz, cameraPosition), sphere.w);
+    if (size < minScreenSize) return;
+    uint slot = viewSlot * instanceCount + i;
+    uint level = min(levels[slot], lodLevelCount - 1u);
+    uint finer = levelFor(size, 1.0 + hysteresis);
+    uint coarser = levelFor(size, 1.0 - hysteresis);
+    if (finer < level) {
+        level = finer;
+    } else if (coarser > level) {
+        level = coarser;
+    }
+    levels[slot] = level;
+
+    // Compacting the survivors of each level after its base instance.
+    uint index = atomicAdd(commands[level * COMMAND_UINTS + 1u], 1u);
+    uint source = i * INSTANCE_FLOATS;
+    uint target = (level * instanceCount + index) * INSTANCE_FLOATS;
+    for (uint f = 0u; f < INSTANCE_FLOATS; f++) {
+        visible[target + f] = instances[source + f];
+    }
+}
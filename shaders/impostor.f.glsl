@@ -0,0 +1,58 @@
+#version 410 core
+
+layout(std140) uniform FrameData {
+    // Projection times view matrix
+    mat4 viewProjectionMatrix;
+    // Camera position for the viewing vector.
+    vec3 cameraPos;
+    // Current time in seconds.
+    float time;
+};
+
+layout(std140) uniform LightData {
+    // Directional light direction and color
+    vec3 directional_lightDirection;
+    vec3 directional_lightColor;
+    // Point light position and color
+    vec3 point_lightPosition;
+    vec3 point_lightColor;
+    // Spot light position, direction and color
+    vec3 spot_lightPosition;
+    vec3 spot_lightDirection;
+    vec3 spot_lightColor;
+};
+
+// Material weights and coverage of the atlas frames.
+uniform sampler2DArray albedoAtlas;
+// World space normals of the atlas frames.
+uniform sampler2DArray normalAtlas;
+
+in vec3 texCoord;
+in vec3 trunkColor;
+in vec3 leavesColor;
+in vec3 worldPosition;
+
+out vec4 fragColorOut;
+
+void main() {
+    vec4 albedo = texture(albedoAtlas, texCoord);
+    if (albedo.a < 0.5) discard;
+
+    // Weights averaged with the empty texels around, divided back by the coverage.
+    vec3 surfaceColor = (albedo.r * trunkColor + albedo.g * leavesColor) / albedo.a;
+    vec3 N = normalize(texture(normalAtlas, texCoord).xyz * 2.0 - 1.0);
+    vec3 V = normalize(cameraPos - worldPosition);
+
+    // Same coefficients as the lighting shader, far away only the sun matters.
+    const vec3 K_amb = vec3(0.2, 0.2, 0.2);
+    const vec3 K_diff = vec3(0.9, 0.9, 0.9);
+    const vec3 K_spec = vec3(0.7, 0.7, 0.7);
+    const float shininess = 40.0;
+
+    vec3 Ld = normalize(-directional_lightDirection);
+    vec3 diffuseD = K_diff * directional_lightColor * surfaceColor * max(dot(Ld, N), 0.0);
+    vec3 Rd = reflect(-Ld, N);
+    vec3 specularD = K_spec * directional_lightColor * pow(max(dot(Rd, V), 0.0), shininess);
+
+    fragColorOut = vec4(diffuseD + specularD + K_amb * surfaceColor, 1.0);
+}
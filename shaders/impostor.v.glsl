@@ -0,0 +1,58 @@
+#version 410 core
+
+// Far trees drawn as a single card showing the atlas frame taken from the closest direction.
+
+layout(std140) uniform FrameData {
+    // Projection times view matrix
+    mat4 viewProjectionMatrix;
+    // Camera position for the viewing vector.
+    vec3 cameraPos;
+    // Current time in seconds.
+    float time;
+};
+
+// Number of frames along each side of the atlas grid.
+uniform float framesPerSide;
+
+// Card corner in [-1, 1].
+layout(location = 0) in vec3 vPos;
+// Card placement: translation to the center of the variant bounds, scaled by their radius.
+layout(location = 2) in mat4 instanceModelMatrix;
+// Leaves color (first column) and atlas layer (second column, x), the normal matrix is not needed.
+layout(location = 6) in mat3 instanceNormalMatrix;
+// Trunk color.
+layout(location = 9) in vec3 instanceColor;
+
+out vec3 texCoord;
+out vec3 trunkColor;
+out vec3 leavesColor;
+out vec3 worldPosition;
+
+void main() {
+    vec3 center = instanceModelMatrix[3].xyz;
+    float radius = instanceModelMatrix[0][0];
+
+    // Hemi-octahedral grid cell of the direction towards the camera, as ImpostorAtlas::frameDirection.
+    vec3 toCamera = normalize(cameraPos - center);
+    toCamera.y = max(toCamera.y, 0.0);
+    vec3 octahedron = toCamera / (abs(toCamera.x) + abs(toCamera.y) + abs(toCamera.z));
+    vec2 grid = vec2(octahedron.x + octahedron.z, octahedron.x - octahedron.z);
+    vec2 frame = clamp(floor((grid * 0.5 + 0.5) * framesPerSide), vec2(0.0), vec2(framesPerSide - 1.0));
+
+    // Direction the frame was actually taken from, the card faces it so the picture is not distorted.
+    vec2 frameGrid = (frame + 0.5) / framesPerSide * 2.0 - 1.0;
+    vec2 p = vec2(frameGrid.x + frameGrid.y, frameGrid.x - frameGrid.y) * 0.5;
+    vec3 direction = normalize(vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y));
+
+    // Same basis as glm::lookAt while baking.
+    vec3 up = abs(direction.y) > 0.999 ? vec3(0.0, 0.0, -1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(-direction, up));
+    vec3 cardUp = cross(right, -direction);
+
+    worldPosition = center + (right * vPos.x + cardUp * vPos.y) * radius;
+    gl_Position = viewProjectionMatrix * vec4(worldPosition, 1.0);
+
+    texCoord = vec3((frame + vPos.xy * 0.5 + 0.5) / framesPerSide, instanceNormalMatrix[1].x);
+    trunkColor = instanceColor;
+    leavesColor = instanceNormalMatrix[0];
+}
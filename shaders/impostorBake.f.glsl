@@ -0,0 +1,14 @@
+#version 410 core
+
+in vec3 normal;
+in vec2 weights;
+
+// Material weights and coverage.
+layout(location = 0) out vec4 albedoOut;
+// Normal packed in [0, 1].
+layout(location = 1) out vec4 normalOut;
+
+void main() {
+    albedoOut = vec4(weights, 0.0, 1.0);
+    normalOut = vec4(normalize(normal) * 0.5 + 0.5, 1.0);
+}
@@ -0,0 +1,18 @@
+#version 410 core
+
+// Trees baked into the impostor atlas, already placed in the space of their variant.
+layout(location = 0) in vec3 vPos;
+layout(location = 1) in vec3 vertexNormal;
+// Material weights, red for the trunk and green for the leaves.
+layout(location = 2) in vec3 vertexColor;
+
+uniform mat4 viewProjectionMatrix;
+
+out vec3 normal;
+out vec2 weights;
+
+void main() {
+    normal = vertexNormal;
+    weights = vertexColor.rg;
+    gl_Position = viewProjectionMatrix * vec4(vPos, 1.0);
+}
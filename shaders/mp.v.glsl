@@ -12,49 +12,68 @@
  */
 
 
-// ------------------------ Uniform inputs ------------------------|
+// ------------------------ Uniform blocks ------------------------|
+
+// ··············· Frame data (once per view) ···············|
+
+layout(std140) uniform FrameData {
+    // Projection times view matrix
+    mat4 viewProjectionMatrix;
+    // Camera position for the viewing vector.
+    vec3 cameraPos;
+    // Current time in seconds, used by the grass animation.
+    float time;
+};
+
+// ··············· Lights (only when they change) ···············|
+
+layout(std140) uniform LightData {
+    // Directional light direction and color
+    vec3 directional_lightDirection;
+    vec3 directional_lightColor;
+    // Point light position and color
+    vec3 point_lightPosition;
+    vec3 point_lightColor;
+    // Spot light position, direction and color
+    vec3 spot_lightPosition;
+    vec3 spot_lightDirection;
+    vec3 spot_lightColor;
+};
+
+// ··············· Object data (once per object) ···············|
+
+layout(std140) uniform ObjectData {
+    // World model matrix
+    mat4 modelMatrix;
+    // Normal matrix
+    mat3 normalMatrix;
+};
 
-// ··············· Matrix uniforms ···············|
 
-// Precomputed Model-View-Projection Matrix
-uniform mat4 mvpMatrix;
-// World model matrix
-uniform mat4 modelMatrix;
-// Normal matrix
-uniform mat3 normalMatrix;
+// ------------------------ Uniform inputs ------------------------|
 
 // ··············· Material ···············|
 
 // The material color for our vertex (& whole object).
 uniform vec3 materialColor;
 
-// ··············· Directional light ···············|
-
-// Light direction vector
-uniform vec3 directional_lightDirection;
-// Color of the light
-uniform vec3 directional_lightColor;
-
-// ··············· Point light ···············|
-
-// Point light position
-uniform vec3 point_lightPosition;
-// Point light color
-uniform vec3 point_lightColor;
+// ··············· Instancing ···············|
 
-// ··············· Spotlight ···············|
+// True when the transform and color come from the per-instance attributes.
+uniform bool useInstancing;
+// True when the instances are grass clumps swaying with the wind.
+uniform bool swayGrass;
+// True when the color comes from the vertices (baked static geometry).
+uniform bool useVertexColor;
 
-// Spot light position
-uniform vec3 spot_lightPosition;
-// Spot light direction
-uniform vec3 spot_lightDirection;
-// Spot light color
-uniform vec3 spot_lightColor;
+// ··············· Part palette ···············|
 
-// ··············· Other ···············|
-
-// Camera position for the viewing vector.
-uniform vec3 cameraPos;
+// Maximum number of entries in the part transform palette.
+const int MAX_PARTS = 8;
+// True when the vertices are moved by the part transform palette (baked heroes).
+uniform bool usePartPalette;
+// Rigid transforms of the animated parts, entry 0 is the identity (a zero matrix hides a part).
+uniform mat4 partPalette[MAX_PARTS];
 
 
 // ------------------------ Attribute inputs ------------------------|
@@ -64,6 +83,17 @@ layout(location = 0) in vec3 vPos;
 // The normal vector of the specific vertex.
 layout(location = 1) in vec3 vertexNormal;
 
+// Model matrix of the instance (takes locations 2 to 5).
+layout(location = 2) in mat4 instanceModelMatrix;
+// Normal matrix of the instance (takes locations 6 to 8).
+layout(location = 6) in mat3 instanceNormalMatrix;
+// Material color of the instance.
+layout(location = 9) in vec3 instanceColor;
+// Material color baked into the vertex.
+layout(location = 10) in vec3 vertexColor;
+// Part palette entry moving this vertex.
+layout(location = 11) in float partIndex;
+
 // ------------------------ Varying outputs ------------------------|
 
 // Color to apply to this vertex
@@ -72,14 +102,47 @@ out vec3 color;
 
 void main() {
 
-    // Transform & output the vertex in clip space
-    gl_Position = mvpMatrix * vec4(vPos, 1.0);
+    // Object space position, normal and color of this vertex.
+    vec4 objectPosition = vec4(vPos, 1.0);
+    vec3 objectNormal = vertexNormal;
+    vec3 surfaceColor = useVertexColor ? vertexColor : materialColor;
+
+    if (usePartPalette) {
+        // Moving the vertex with its part, the transforms are rigid so they also rotate the normal.
+        mat4 partMatrix = partPalette[clamp(int(partIndex + 0.5), 0, MAX_PARTS - 1)];
+        objectPosition = partMatrix * objectPosition;
+        objectNormal = mat3(partMatrix) * objectNormal;
+    }
+
+    if (useInstancing) {
+        if (swayGrass) {
+            // Grass oscillating angle using a sine wave, shifted by the clump position.
+            float angle = radians(sin(time * 2.0 + instanceModelMatrix[3].x + instanceModelMatrix[3].z) * 5.0);
+            float c = cos(angle), s = sin(angle);
+            mat3 sway = mat3(c, s, 0.0,
+                            -s, c, 0.0,
+                            0.0, 0.0, 1.0);
+
+            // Rotating around the pivot below the blade.
+            objectPosition.xyz = sway * (objectPosition.xyz + vec3(0.0, 1.0, 0.0)) - vec3(0.0, 1.0, 0.0);
+            objectNormal = sway * objectNormal;
+        }
+
+        // Moving the vertex to its instance place.
+        objectPosition = instanceModelMatrix * objectPosition;
+        objectNormal = instanceNormalMatrix * objectNormal;
+        surfaceColor = instanceColor;
+    }
 
     // Transforming the vector position to world space.
-    vec3 worldPosition = vec3(modelMatrix * vec4(vPos, 1.0));
+    vec4 worldPosition4 = modelMatrix * objectPosition;
+    vec3 worldPosition = vec3(worldPosition4);
+
+    // Transform & output the vertex in clip space
+    gl_Position = viewProjectionMatrix * worldPosition4;
 
     // Normal and viewing vectors.
-    vec3 N = normalize(normalMatrix * vertexNormal);
+    vec3 N = normalize(normalMatrix * objectNormal);
     vec3 V = normalize(cameraPos - worldPosition);
 
     // Phong Reflectance coefficients
@@ -94,7 +157,7 @@ void main() {
 
     // Diffuse Illumination
     vec3 Ld = normalize(-directional_lightDirection);
-    vec3 diffuseD = K_diff * directional_lightColor * materialColor * max(dot(Ld, N), 0.0);
+    vec3 diffuseD = K_diff * directional_lightColor * surfaceColor * max(dot(Ld, N), 0.0);
 
     // Specular Illumination
     vec3 Rd = reflect(-Ld, N);
@@ -112,7 +175,7 @@ void main() {
     vec3 point_distanceVector = point_lightPosition - worldPosition;
     float pointDistance = length(point_distanceVector);
     vec3 Lp = point_distanceVector / pointDistance;
-    vec3 diffuseP = K_diff * materialColor * point_lightColor * max(dot(Lp, N), 0.0);
+    vec3 diffuseP = K_diff * surfaceColor * point_lightColor * max(dot(Lp, N), 0.0);
 
     // Attenuation : (c + l*d + q*d^2)
     float point_atten = 1.0 / (point_const_atten +
@@ -137,7 +200,7 @@ void main() {
     vec3 spot_distanceVector = spot_lightPosition - worldPosition;
     float spotDistance = length(spot_distanceVector);
     vec3 Ls = spot_distanceVector / spotDistance;
-    vec3 diffuseS = K_diff * materialColor * spot_lightColor * max(dot(Ls, N), 0.0);
+    vec3 diffuseS = K_diff * surfaceColor * spot_lightColor * max(dot(Ls, N), 0.0);
 
     // Attenuation : (c + l*d + q*d^2)
     float spot_atten = 1.0 / (spot_const_atten +
@@ -155,7 +218,7 @@ void main() {
 
 
     // Ambient Illumination (applied only once for all lights)
-    vec3 ambient = K_amb * materialColor;
+    vec3 ambient = K_amb * surfaceColor;
 
     // Phong Illumination Model with all lights.
     color = I_d + I_p + I_s + ambient;
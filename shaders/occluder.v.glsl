@@ -0,0 +1,10 @@
+#version 410 core
+
+// Depth-only pass of the big occluders, already baked in world space.
+layout(location = 0) in vec3 vPos;
+
+uniform mat4 viewProjectionMatrix;
+
+void main() {
+    gl_Position = viewProjectionMatrix * vec4(vPos, 1.0);
+}
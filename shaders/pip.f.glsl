@@ -0,0 +1,9 @@
+#version 410 core
+
+in vec2 vTexCoord;
+out vec4 fragColor;
+uniform sampler2D uImage;
+
+void main() {
+    fragColor = texture(uImage, vTexCoord);
+}
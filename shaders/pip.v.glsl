@@ -0,0 +1,9 @@
+#version 410 core
+
+// Quad covering the whole viewport, built from the vertex index (no vertex buffer).
+out vec2 vTexCoord;
+
+void main() {
+    vTexCoord = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    gl_Position = vec4(vTexCoord * 2.0 - 1.0, 0.0, 1.0);
+}